@@ -0,0 +1,286 @@
+// append_log.h
+// Shared append-only log writer for the producer/consumer programs.
+//
+// One fd is kept open (O_APPEND) for the whole run. Each producer gets its own
+// log_writer_t and appends records into a private buffer; a buffer reaches the
+// file in one large write() when it fills up (flush_bytes), when the background
+// flusher finds it older than flush_ms, or when the writer is closed.
+// This replaces the per-value sem_wait + fopen + fprintf + fclose + sem_post.
+// If a write() fails, the bytes it did not write stay buffered and the next
+// flush resumes from there; a record that does not fit meanwhile is refused (-1).
+//
+// Durability (sync policy):
+//   LOG_SYNC_NONE  - leave the data in the page cache
+//   LOG_SYNC_FLUSH - fdatasync() after every flush
+//   LOG_SYNC_CLOSE - fdatasync() once, when the log is closed
+//
+// Usage:
+//   append_log_t log;
+//   log_open(&log, "empty_file.txt", LOG_FLUSH_BYTES, LOG_FLUSH_MS, LOG_SYNC_POLICY);
+//   log_writer_t *w = log_writer_open(&log);     // once per producer thread
+//   log_append_int(w, value);
+//   log_writer_close(w);                          // flushes what is left: close it before
+//                                                 // telling a reader this thread is done
+//   log_close(&log);
+
+#ifndef APPEND_LOG_H
+#define APPEND_LOG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define LOG_SYNC_NONE 0
+#define LOG_SYNC_FLUSH 1
+#define LOG_SYNC_CLOSE 2
+
+// Defaults for log_open(); define any of them before the #include to override
+#ifndef LOG_FLUSH_BYTES
+#define LOG_FLUSH_BYTES 4096            // Flush a writer's buffer at this size
+#endif
+#ifndef LOG_FLUSH_MS
+#define LOG_FLUSH_MS 50                 // ...or when its oldest record is this old
+#endif
+#ifndef LOG_SYNC_POLICY
+#define LOG_SYNC_POLICY LOG_SYNC_CLOSE  // fdatasync once at shutdown
+#endif
+
+#define LOG_MAX_WRITERS 256
+
+typedef struct append_log append_log_t;
+
+// ---------------- Per-Thread Writer ----------------
+typedef struct {
+    append_log_t *log;
+    pthread_mutex_t lock;      // Owner thread vs flusher thread (almost never contended)
+    char *buf;
+    size_t len, cap;
+    struct timespec oldest;    // When the oldest buffered record was appended
+    int slot;                  // Index in log->writers
+} log_writer_t;
+
+// ---------------- Shared Log ----------------
+struct append_log {
+    int fd;
+    int sync_policy;
+    size_t flush_bytes;        // Flush a writer once its buffer holds this much
+    long flush_ms;             // Flush buffers older than this (0 = no flusher thread)
+
+    pthread_mutex_t lock;      // Protects writers[] and the flusher state
+    pthread_cond_t wake;       // Stops the flusher early on close
+    log_writer_t *writers[LOG_MAX_WRITERS];
+    int stop;
+    pthread_t flusher;
+
+    long long flushes;         // write() calls issued (stats)
+    long long bytes;           // bytes written (stats)
+};
+
+static inline long log_elapsed_ms(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+// Writes buf (write() may be partial); returns the bytes written, fewer than len
+// only if write() failed
+static inline size_t log_write(append_log_t *log, const char *buf, size_t len) {
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = write(log->fd, buf + off, len - off);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("append_log: write failed");
+            break;
+        }
+        off += (size_t)n;
+    }
+    if (off) {
+        __atomic_add_fetch(&log->flushes, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&log->bytes, (long long)off, __ATOMIC_RELAXED);
+        if (log->sync_policy == LOG_SYNC_FLUSH)
+            fdatasync(log->fd);
+    }
+    return off;
+}
+
+// Writes the whole buffer; on failure only the unwritten tail is kept, so a
+// retry does not repeat bytes already in the file. Caller holds w->lock.
+static inline int log_flush_locked(log_writer_t *w) {
+    size_t off = log_write(w->log, w->buf, w->len);
+    if (off < w->len) {
+        memmove(w->buf, w->buf + off, w->len - off);
+        w->len -= off;
+        return -1;
+    }
+    w->len = 0;
+    return 0;
+}
+
+// Background thread: flushes buffers that have been waiting longer than flush_ms
+static void *log_flusher(void *arg) {
+    append_log_t *log = arg;
+    pthread_mutex_lock(&log->lock);
+    while (!log->stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += log->flush_ms * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&log->wake, &log->lock, &deadline);
+
+        for (int i = 0; i < LOG_MAX_WRITERS && !log->stop; ++i) {
+            log_writer_t *w = log->writers[i];
+            if (!w || pthread_mutex_trylock(&w->lock) != 0)
+                continue;     // busy writers will flush on their own
+            if (w->len && log_elapsed_ms(&w->oldest) >= log->flush_ms)
+                log_flush_locked(w);
+            pthread_mutex_unlock(&w->lock);
+        }
+    }
+    pthread_mutex_unlock(&log->lock);
+    return NULL;
+}
+
+// Opens (creates if needed) the log for appending; returns 0 on success
+static inline int log_open(append_log_t *log, const char *path, size_t flush_bytes,
+                           long flush_ms, int sync_policy) {
+    memset(log, 0, sizeof(*log));
+    log->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (log->fd < 0) {
+        perror("append_log: open failed");
+        return -1;
+    }
+    log->flush_bytes = flush_bytes ? flush_bytes : 4096;
+    log->flush_ms = flush_ms;
+    log->sync_policy = sync_policy;
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_cond_init(&log->wake, NULL);
+
+    if (flush_ms > 0 && pthread_create(&log->flusher, NULL, log_flusher, log) != 0) {
+        perror("append_log: failed to start flusher");
+        log->flush_ms = 0;
+    }
+    return 0;
+}
+
+// Registers a writer for the calling thread; NULL if the table is full
+static inline log_writer_t *log_writer_open(append_log_t *log) {
+    log_writer_t *w = calloc(1, sizeof(*w));
+    if (!w)
+        return NULL;
+    w->log = log;
+    w->cap = log->flush_bytes + 64;
+    w->buf = malloc(w->cap);
+    if (!w->buf) {
+        free(w);
+        return NULL;
+    }
+    pthread_mutex_init(&w->lock, NULL);
+
+    pthread_mutex_lock(&log->lock);
+    w->slot = -1;
+    for (int i = 0; i < LOG_MAX_WRITERS; ++i) {
+        if (!log->writers[i]) {
+            log->writers[i] = w;
+            w->slot = i;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&log->lock);
+
+    if (w->slot < 0) {
+        fprintf(stderr, "append_log: too many writers\n");
+        pthread_mutex_destroy(&w->lock);
+        free(w->buf);
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+// Buffers one record; flushes when the buffer reaches flush_bytes
+static inline int log_append(log_writer_t *w, const char *rec, size_t len) {
+    int rc = 0;
+    pthread_mutex_lock(&w->lock);
+    if (w->len + len > w->cap) {
+        if (log_flush_locked(w) != 0) {
+            pthread_mutex_unlock(&w->lock);   // still full: the record is not taken
+            return -1;
+        }
+        if (len > w->cap) {
+            // Oversized record: write it straight through
+            rc = log_write(w->log, rec, len) == len ? 0 : -1;
+            pthread_mutex_unlock(&w->lock);
+            return rc;
+        }
+    }
+    if (w->len == 0)
+        clock_gettime(CLOCK_MONOTONIC, &w->oldest);
+    memcpy(w->buf + w->len, rec, len);
+    w->len += len;
+    if (w->len >= w->log->flush_bytes)
+        rc = log_flush_locked(w);
+    pthread_mutex_unlock(&w->lock);
+    return rc;
+}
+
+// Appends "<value>\n" (the record format the consumers read back)
+static inline int log_append_int(log_writer_t *w, int value) {
+    char rec[16];
+    int n = snprintf(rec, sizeof(rec), "%d\n", value);
+    return log_append(w, rec, (size_t)n);
+}
+
+// Flushes and unregisters the writer
+static inline int log_writer_close(log_writer_t *w) {
+    append_log_t *log = w->log;
+
+    pthread_mutex_lock(&log->lock);
+    log->writers[w->slot] = NULL;
+    pthread_mutex_unlock(&log->lock);
+
+    pthread_mutex_lock(&w->lock);
+    int rc = log_flush_locked(w);
+    pthread_mutex_unlock(&w->lock);
+
+    pthread_mutex_destroy(&w->lock);
+    free(w->buf);
+    free(w);
+    return rc;
+}
+
+// Stops the flusher, flushes any writers still open and closes the fd
+static inline int log_close(append_log_t *log) {
+    pthread_mutex_lock(&log->lock);
+    log->stop = 1;
+    pthread_cond_signal(&log->wake);
+    pthread_mutex_unlock(&log->lock);
+    if (log->flush_ms > 0)
+        pthread_join(log->flusher, NULL);
+
+    int rc = 0;
+    for (int i = 0; i < LOG_MAX_WRITERS; ++i) {
+        if (log->writers[i]) {
+            pthread_mutex_lock(&log->writers[i]->lock);
+            rc |= log_flush_locked(log->writers[i]);
+            pthread_mutex_unlock(&log->writers[i]->lock);
+        }
+    }
+
+    if (log->sync_policy == LOG_SYNC_CLOSE)
+        fdatasync(log->fd);
+    if (close(log->fd) != 0)
+        rc = -1;
+    pthread_mutex_destroy(&log->lock);
+    pthread_cond_destroy(&log->wake);
+    return rc;
+}
+
+#endif // APPEND_LOG_H
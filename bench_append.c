@@ -0,0 +1,125 @@
+// bench_append.c
+// Per-item cost of the ways the programs have written and printed the data file:
+//   append  shell    system("echo N >> file")       (fork + exec /bin/sh per item)
+//           stdio    fopen + fprintf + fclose per item
+//           log      append_log.h buffered appends
+//   dump    shell    system("cat file > /dev/null")
+//           stdio    fopen + fgets + fputs
+//           kernel   fio_dump() (sendfile/splice)
+// Dumps go to /dev/null so the terminal does not dominate the timing.
+//
+// Compile: gcc -O2 -pthread bench_append.c -o bench_append
+// Run:     ./bench_append [items] [shell_items]
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include "append_log.h"
+#include "fast_io.h"
+
+const char *filename = "bench_append.txt";
+long items = 1000000;
+long shell_items = 200;   // system() is slow: time fewer items
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void truncate_file(void) {
+    FILE *f = fopen(filename, "w");
+    if (f) fclose(f);
+}
+
+static void report(const char *what, const char *how, long n, double dt) {
+    printf("%-7s %-7s %10ld %12.4f %14.1f\n", what, how, n, dt, dt / n * 1e9);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) items = atol(argv[1]);
+    if (argc > 2) shell_items = atol(argv[2]);
+    if (items < 1) items = 1;
+    if (shell_items < 1) shell_items = 1;
+
+    printf("=== Append / dump cost ===\n");
+    printf("%-7s %-7s %10s %12s %14s\n", "op", "method", "items", "seconds", "ns/item");
+
+    // --- Append: one shell per item ---
+    truncate_file();
+    char command[256];
+    double t0 = now_sec();
+    for (long i = 0; i < shell_items; i++) {
+        snprintf(command, sizeof(command), "echo %ld >> %s", i % 100, filename);
+        if (system(command) != 0) {
+            perror("system");
+            break;
+        }
+    }
+    report("append", "shell", shell_items, now_sec() - t0);
+
+    // --- Append: open/close per item ---
+    truncate_file();
+    t0 = now_sec();
+    for (long i = 0; i < items; i++) {
+        FILE *f = fopen(filename, "a");
+        if (!f)
+            break;
+        fprintf(f, "%ld\n", i % 100);
+        fclose(f);
+    }
+    report("append", "stdio", items, now_sec() - t0);
+
+    // --- Append: buffered log ---
+    truncate_file();
+    append_log_t log;
+    if (log_open(&log, filename, 64 * 1024, 0, LOG_SYNC_NONE) != 0)
+        return 1;
+    t0 = now_sec();
+    log_writer_t *w = log_writer_open(&log);
+    for (long i = 0; w && i < items; i++)
+        log_append_int(w, (int)(i % 100));
+    if (w)
+        log_writer_close(w);
+    log_close(&log);
+    report("append", "log", items, now_sec() - t0);
+
+    // The file now holds 'items' lines: dump it a few times each way
+    int devnull = open("/dev/null", O_WRONLY);
+    const int dumps = 5;
+
+    snprintf(command, sizeof(command), "cat %s > /dev/null", filename);
+    t0 = now_sec();
+    for (int d = 0; d < dumps; d++)
+        if (system(command) != 0)
+            perror("system");
+    report("dump", "shell", items * dumps, now_sec() - t0);
+
+    FILE *null_stream = fdopen(dup(devnull), "w");
+    char line[64];
+    t0 = now_sec();
+    for (int d = 0; d < dumps; d++) {
+        FILE *f = fopen(filename, "r");
+        if (!f)
+            break;
+        while (fgets(line, sizeof(line), f))
+            fputs(line, null_stream);
+        fclose(f);
+    }
+    fflush(null_stream);
+    report("dump", "stdio", items * dumps, now_sec() - t0);
+
+    t0 = now_sec();
+    for (int d = 0; d < dumps; d++)
+        if (fio_dump(filename, devnull) < 0)
+            perror("fio_dump");
+    report("dump", "kernel", items * dumps, now_sec() - t0);
+
+    fclose(null_stream);
+    close(devnull);
+    unlink(filename);
+    return 0;
+}
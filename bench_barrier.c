@@ -0,0 +1,92 @@
+// bench_barrier.c
+// Barrier latency vs thread count for phase_barrier.h: every thread runs an
+// empty phase loop, so the time per phase is pure barrier cost.
+// Each configuration first runs a short checked pass (no thread may leave a
+// phase before all threads arrived), then the timed pass.
+// Thread counts go 1, 2, 4, ... up to MAX (default 64).
+//
+// Compile: gcc -O2 -pthread bench_barrier.c -o bench_barrier
+// Run:     ./bench_barrier [max_threads] [phases] [kind]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "phase_barrier.h"
+
+#define CHECK_PHASES 200
+
+int max_threads = 64;
+long phases = 20000;
+
+phase_barrier_t barrier;
+int nthreads;
+int checking;               // 1 during the checked pass
+atomic_long arrived;        // Checked pass: arrivals over all phases
+atomic_int errors;          // Checked pass: threads that left a phase early
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void *worker(void *arg) {
+    int id = (int)(intptr_t)arg;
+    long n = checking ? CHECK_PHASES : phases;
+    for (long p = 0; p < n; p++) {
+        if (checking)
+            atomic_fetch_add(&arrived, 1);
+        phase_barrier_wait(&barrier, id);
+        if (checking && atomic_load(&arrived) < (p + 1) * nthreads)
+            atomic_fetch_add(&errors, 1);
+    }
+    return NULL;
+}
+
+// Runs one pass with nthreads workers; returns the wall time
+static double run_pass(int kind) {
+    pthread_t tids[nthreads];
+    phase_barrier_init(&barrier, kind, nthreads);
+    double t0 = now_sec();
+    for (int i = 0; i < nthreads; i++)
+        pthread_create(&tids[i], NULL, worker, (void *)(intptr_t)i);
+    for (int i = 0; i < nthreads; i++)
+        pthread_join(tids[i], NULL);
+    double dt = now_sec() - t0;
+    phase_barrier_destroy(&barrier);
+    return dt;
+}
+
+int main(int argc, char **argv) {
+    int only = -1;
+    if (argc > 1) max_threads = atoi(argv[1]);
+    if (argc > 2) phases = atol(argv[2]);
+    if (argc > 3 && (only = phase_barrier_parse(argv[3])) < 0) {
+        fprintf(stderr, "Unknown barrier kind: %s\n", argv[3]);
+        return 1;
+    }
+    if (max_threads < 1) max_threads = 1;
+
+    printf("=== Barrier latency: %ld phases ===\n", phases);
+    printf("%-14s %7s %12s %14s  %s\n", "barrier", "threads", "seconds", "ns/phase", "check");
+
+    for (int kind = BARRIER_CENTRAL; kind <= BARRIER_PTHREAD; ++kind) {
+        if (only >= 0 && kind != only)
+            continue;
+        for (nthreads = 1; nthreads <= max_threads; nthreads *= 2) {
+            checking = 1;
+            atomic_store(&arrived, 0);
+            atomic_store(&errors, 0);
+            run_pass(kind);
+
+            checking = 0;
+            double dt = run_pass(kind);   // includes thread start-up, amortized over the phases
+            printf("%-14s %7d %12.4f %14.1f  %s\n", phase_barrier_names[kind], nthreads, dt,
+                   dt / phases * 1e9, atomic_load(&errors) ? "EARLY RELEASE" : "ok");
+        }
+    }
+    return 0;
+}
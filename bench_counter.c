@@ -0,0 +1,81 @@
+// bench_counter.c
+// Contention benchmark for shared_counter.h: every thread draws IDs as fast as it
+// can, like the producers do with counter++ under counter_lock.
+// Thread counts go 1, 2, 4, ... up to MAX (default 64).
+//
+// Compile: gcc -O2 -pthread bench_counter.c -o bench_counter
+// Run:     ./bench_counter [max_threads] [ids_per_thread]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include "shared_counter.h"
+
+int max_threads = 64;
+long ids_per_thread = 1000000;
+
+shared_counter_t counter;
+pthread_barrier_t start_barrier;  // Line everyone up before the clock starts
+
+typedef struct {
+    const char *name;
+    int backend;
+    long block;
+} variant_t;
+
+static const variant_t variants[] = {
+    { "mutex",      COUNTER_MUTEX,   1 },
+    { "atomic",     COUNTER_ATOMIC,  1 },
+    { "sharded/64", COUNTER_SHARDED, 64 },
+    { "sharded/1k", COUNTER_SHARDED, 1024 },
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void *worker(void *arg) {
+    int id = (int)(intptr_t)arg;
+    long sink = 0;
+    pthread_barrier_wait(&start_barrier);
+    for (long i = 0; i < ids_per_thread; i++)
+        sink += counter_next(&counter, id);
+    return (void *)(intptr_t)(sink & 1);   // keep the loop from being optimized out
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) max_threads = atoi(argv[1]);
+    if (argc > 2) ids_per_thread = atol(argv[2]);
+    if (max_threads < 1) max_threads = 1;
+
+    printf("=== Counter contention: %ld IDs per thread ===\n", ids_per_thread);
+    printf("%-11s %7s %12s %14s  %s\n", "backend", "threads", "seconds", "Mops/sec", "check");
+
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); ++v) {
+        for (int threads = 1; threads <= max_threads; threads *= 2) {
+            pthread_t tids[threads];
+            counter_init(&counter, variants[v].backend, threads, variants[v].block);
+            pthread_barrier_init(&start_barrier, NULL, threads + 1);
+
+            for (int i = 0; i < threads; i++)
+                pthread_create(&tids[i], NULL, worker, (void *)(intptr_t)i);
+            double t0 = now_sec();   // start the clock before releasing the workers
+            pthread_barrier_wait(&start_barrier);
+            for (int i = 0; i < threads; i++)
+                pthread_join(tids[i], NULL);
+            double dt = now_sec() - t0;
+
+            long total = (long)threads * ids_per_thread;
+            printf("%-11s %7d %12.4f %14.2f  %s\n", variants[v].name, threads, dt,
+                   total / dt / 1e6, counter_read(&counter) == total ? "ok" : "COUNT MISMATCH");
+
+            pthread_barrier_destroy(&start_barrier);
+            counter_destroy(&counter);
+        }
+    }
+    return 0;
+}
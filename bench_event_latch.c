@@ -0,0 +1,132 @@
+// bench_event_latch.c
+// Wake-up latency and waiter CPU cost for the consumer's "wait for fence_flag".
+// A setter thread publishes one event per round after a short pause; the waiter
+// blocks on it and records how long after the set it actually woke up.
+//   spin       event_latch_wait(EVENT_SPIN_FOREVER)  - the old busy loop
+//   spin+park  event_latch_wait(EVENT_SPIN_DEFAULT)  - spin, then futex
+//   condvar    pthread mutex + condition variable
+//
+// Compile: gcc -O2 -pthread bench_event_latch.c -o bench_event_latch
+// Run:     ./bench_event_latch [rounds] [gap_us]
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "event_latch.h"
+
+#define MODE_SPIN 0
+#define MODE_SPIN_PARK 1
+#define MODE_CONDVAR 2
+
+static const char *mode_names[] = { "spin", "spin+park", "condvar" };
+
+int rounds = 2000;
+int gap_us = 100;       // setter pause before each event (how long the waiter waits)
+
+int mode;
+event_latch_t *latches; // one latch per round, so no reset race between rounds
+pthread_mutex_t cv_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t cv = PTHREAD_COND_INITIALIZER;
+int cv_published = 0;   // rounds published so far (guarded by cv_lock)
+
+double *set_time, *latency_us;
+double waiter_cpu;      // CPU seconds the waiter thread used
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double thread_cpu_sec(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_THREAD, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec
+         + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1e-6;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+void *setter(void *arg) {
+    (void)arg;
+    for (int i = 0; i < rounds; i++) {
+        usleep(gap_us);
+        set_time[i] = now_sec();   // published by the release in set / unlock
+        if (mode == MODE_CONDVAR) {
+            pthread_mutex_lock(&cv_lock);
+            cv_published = i + 1;
+            pthread_cond_signal(&cv);
+            pthread_mutex_unlock(&cv_lock);
+        } else {
+            event_latch_set(&latches[i]);
+        }
+    }
+    return NULL;
+}
+
+void *waiter(void *arg) {
+    (void)arg;
+    double cpu0 = thread_cpu_sec();
+    for (int i = 0; i < rounds; i++) {
+        if (mode == MODE_CONDVAR) {
+            pthread_mutex_lock(&cv_lock);
+            while (cv_published <= i)
+                pthread_cond_wait(&cv, &cv_lock);
+            pthread_mutex_unlock(&cv_lock);
+        } else {
+            event_latch_wait(&latches[i], mode == MODE_SPIN ? EVENT_SPIN_FOREVER : EVENT_SPIN_DEFAULT);
+        }
+        latency_us[i] = (now_sec() - set_time[i]) * 1e6;
+    }
+    waiter_cpu = thread_cpu_sec() - cpu0;
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) rounds = atoi(argv[1]);
+    if (argc > 2) gap_us = atoi(argv[2]);
+    if (rounds < 1) rounds = 1;
+
+    latches = aligned_alloc(64, sizeof(event_latch_t) * (size_t)rounds);
+    set_time = malloc(sizeof(double) * (size_t)rounds);
+    latency_us = malloc(sizeof(double) * (size_t)rounds);
+    if (!latches || !set_time || !latency_us) {
+        perror("Failed to allocate rounds");
+        return 1;
+    }
+
+    printf("=== Event wake-up: %d rounds, %d us between events ===\n", rounds, gap_us);
+    printf("%-10s %10s %10s %10s %12s\n", "mode", "p50 us", "p99 us", "max us", "waiter CPU");
+
+    for (mode = MODE_SPIN; mode <= MODE_CONDVAR; mode++) {
+        for (int i = 0; i < rounds; i++)
+            event_latch_init(&latches[i]);
+        cv_published = 0;
+
+        pthread_t ts, tw;
+        double t0 = now_sec();
+        pthread_create(&tw, NULL, waiter, NULL);
+        pthread_create(&ts, NULL, setter, NULL);
+        pthread_join(ts, NULL);
+        pthread_join(tw, NULL);
+        double wall = now_sec() - t0;
+
+        qsort(latency_us, (size_t)rounds, sizeof(double), cmp_double);
+        printf("%-10s %10.1f %10.1f %10.1f %11.1f%%\n", mode_names[mode],
+               latency_us[rounds / 2], latency_us[(int)(rounds * 0.99)],
+               latency_us[rounds - 1], 100.0 * waiter_cpu / wall);
+    }
+
+    free(latches);
+    free(set_time);
+    free(latency_us);
+    return 0;
+}
@@ -0,0 +1,191 @@
+// bench_mpsc_ring.c
+// Producer -> consumer handoff throughput: lock-free MPSC ring vs. the
+// mutex + semaphore + file round trip the synchronization programs use.
+//
+//   ring     producers push into mpsc_ring.h, the consumer drains concurrently
+//   semaphore  in-memory bounded buffer guarded by a mutex and empty/full semaphores
+//   file     per value: sem_wait, fopen("a"), fprintf, fclose, sem_post; the
+//            consumer re-reads the file with fscanf once producers are done
+//
+// Compile: gcc -O2 -pthread bench_mpsc_ring.c -o bench_mpsc_ring
+// Run:     ./bench_mpsc_ring [producers] [items_per_producer]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <time.h>
+#include <stdatomic.h>
+#include "mpsc_ring.h"
+
+#define RING_CAPACITY 4096
+#define FILE_ITEMS_CAP 20000   // The file round trip is slow; cap its item count
+const char *filename = "bench_ring_file.txt";
+
+int num_producers = 4;
+long items_per_producer = 1000000;
+long items_this_run;
+
+// ---------------- Shared State ----------------
+mpsc_ring_t ring;
+atomic_int producers_finished;
+long long consumer_sum;
+
+// Bounded buffer for the semaphore variant
+long *buffer;
+int buf_in = 0, buf_out = 0;
+pthread_mutex_t buf_lock;
+sem_t slots_free, slots_used;
+
+sem_t file_semaphore;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ---------------- Ring ----------------
+void *ring_producer(void *arg) {
+    long base = (long)(intptr_t)arg * items_this_run;
+    for (long i = 0; i < items_this_run; i++)
+        mpsc_ring_push(&ring, base + i);
+    atomic_fetch_add_explicit(&producers_finished, 1, memory_order_release);
+    return NULL;
+}
+
+void *ring_consumer(void *arg) {
+    long v, sum = 0;
+    for (;;) {
+        if (mpsc_ring_pop(&ring, &v)) {
+            sum += v;
+            continue;
+        }
+        if (atomic_load_explicit(&producers_finished, memory_order_acquire) == num_producers) {
+            while (mpsc_ring_pop(&ring, &v))
+                sum += v;
+            break;
+        }
+        sched_yield();
+    }
+    consumer_sum = sum;
+    return NULL;
+}
+
+// ---------------- Mutex + Semaphores ----------------
+void *sem_producer(void *arg) {
+    long base = (long)(intptr_t)arg * items_this_run;
+    for (long i = 0; i < items_this_run; i++) {
+        sem_wait(&slots_free);
+        pthread_mutex_lock(&buf_lock);
+        buffer[buf_in] = base + i;
+        buf_in = (buf_in + 1) % RING_CAPACITY;
+        pthread_mutex_unlock(&buf_lock);
+        sem_post(&slots_used);
+    }
+    return NULL;
+}
+
+void *sem_consumer(void *arg) {
+    long sum = 0, total = items_this_run * num_producers;
+    for (long n = 0; n < total; n++) {
+        sem_wait(&slots_used);
+        pthread_mutex_lock(&buf_lock);
+        sum += buffer[buf_out];
+        buf_out = (buf_out + 1) % RING_CAPACITY;
+        pthread_mutex_unlock(&buf_lock);
+        sem_post(&slots_free);
+    }
+    consumer_sum = sum;
+    return NULL;
+}
+
+// ---------------- File Round Trip (current programs) ----------------
+void *file_producer(void *arg) {
+    long base = (long)(intptr_t)arg * items_this_run;
+    for (long i = 0; i < items_this_run; i++) {
+        sem_wait(&file_semaphore);
+        FILE *f = fopen(filename, "a");
+        if (f) {
+            fprintf(f, "%ld\n", base + i);
+            fclose(f);
+        }
+        sem_post(&file_semaphore);
+    }
+    return NULL;
+}
+
+void *file_consumer(void *arg) {
+    long v, sum = 0;
+    FILE *f = fopen(filename, "r");
+    if (f) {
+        while (fscanf(f, "%ld", &v) == 1)
+            sum += v;
+        fclose(f);
+    }
+    consumer_sum = sum;
+    return NULL;
+}
+
+// Runs one variant; the file consumer starts after producers, like the programs do
+double run(void *(*prod)(void *), void *(*cons)(void *), int consumer_after) {
+    pthread_t producers[num_producers], consumer;
+    atomic_store(&producers_finished, 0);
+    consumer_sum = 0;
+
+    double t0 = now_sec();
+    if (!consumer_after)
+        pthread_create(&consumer, NULL, cons, NULL);
+    for (int i = 0; i < num_producers; i++)
+        pthread_create(&producers[i], NULL, prod, (void *)(intptr_t)i);
+    for (int i = 0; i < num_producers; i++)
+        pthread_join(producers[i], NULL);
+    if (consumer_after)
+        pthread_create(&consumer, NULL, cons, NULL);
+    pthread_join(consumer, NULL);
+    return now_sec() - t0;
+}
+
+void report(const char *name, double dt) {
+    long long n = (long long)items_this_run * num_producers;
+    long long expect = n * (n - 1) / 2;
+    printf("%-10s %10lld items %9.4fs %14.0f ops/sec  %s\n", name, n, dt, n / dt,
+           consumer_sum == expect ? "ok" : "CHECKSUM MISMATCH");
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) num_producers = atoi(argv[1]);
+    if (argc > 2) items_per_producer = atol(argv[2]);
+    if (num_producers < 1) num_producers = 1;
+    if (items_per_producer < 1) items_per_producer = 1;
+
+    printf("=== Handoff benchmark: %d producers, 1 consumer ===\n", num_producers);
+
+    items_this_run = items_per_producer;
+    mpsc_ring_init(&ring, RING_CAPACITY);
+    report("ring", run(ring_producer, ring_consumer, 0));
+    mpsc_ring_destroy(&ring);
+
+    buffer = malloc(RING_CAPACITY * sizeof(long));
+    pthread_mutex_init(&buf_lock, NULL);
+    sem_init(&slots_free, 0, RING_CAPACITY);
+    sem_init(&slots_used, 0, 0);
+    report("semaphore", run(sem_producer, sem_consumer, 0));
+    sem_destroy(&slots_free);
+    sem_destroy(&slots_used);
+    pthread_mutex_destroy(&buf_lock);
+    free(buffer);
+
+    items_this_run = items_per_producer < FILE_ITEMS_CAP / num_producers
+                   ? items_per_producer : FILE_ITEMS_CAP / num_producers;
+    if (items_this_run < 1) items_this_run = 1;
+    FILE *f = fopen(filename, "w");
+    if (f) fclose(f);
+    sem_init(&file_semaphore, 0, 1);
+    report("file", run(file_producer, file_consumer, 1));
+    sem_destroy(&file_semaphore);
+    remove(filename);
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+// bench_seqlock.c
+// Snapshot read throughput under continuous updates: one writer rewrites a
+// multi-field stats struct as fast as it can while R readers copy it.
+//   seqlock  seqlock.h (readers never block the writer)
+//   mutex    pthread mutex around every read and write
+// The writer fills every field with the same version number, so a reader can
+// detect a torn copy; "torn" must stay 0 for both variants.
+// Reader counts go 1, 2, 4, ... up to MAX (default 8).
+//
+// Compile: gcc -O2 -pthread bench_seqlock.c -o bench_seqlock
+// Run:     ./bench_seqlock [max_readers] [seconds_per_run]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include "seqlock.h"
+
+#define STATS_FIELDS 16   // 128 bytes: two cache lines of counters/timestamps
+
+typedef struct {
+    uint64_t field[STATS_FIELDS];
+} stats_t;
+
+int max_readers = 8;
+double run_seconds = 0.5;
+
+int use_seqlock;
+seqlock_t sl;
+pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+stats_t shared;
+
+atomic_int stop;
+pthread_barrier_t start_barrier;
+
+typedef struct {
+    _Alignas(64) unsigned long reads;
+    unsigned long torn;
+    unsigned long retries;
+} reader_stats_t;
+
+reader_stats_t reader_stats[256];
+unsigned long writes;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void *writer(void *arg) {
+    (void)arg;
+    stats_t next;
+    unsigned long n = 0;
+    pthread_barrier_wait(&start_barrier);
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+        n++;
+        for (int i = 0; i < STATS_FIELDS; i++)
+            next.field[i] = n;
+        if (use_seqlock) {
+            seqlock_write_begin(&sl);
+            seqlock_store(&shared, &next, sizeof(next));
+            seqlock_write_end(&sl);
+        } else {
+            pthread_mutex_lock(&lock);
+            shared = next;
+            pthread_mutex_unlock(&lock);
+        }
+    }
+    writes = n;
+    return NULL;
+}
+
+void *reader(void *arg) {
+    reader_stats_t *st = &reader_stats[(intptr_t)arg];
+    stats_t copy;
+    pthread_barrier_wait(&start_barrier);
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+        if (use_seqlock) {
+            st->retries += seqlock_read(&sl, &copy, &shared, sizeof(copy));
+        } else {
+            pthread_mutex_lock(&lock);
+            copy = shared;
+            pthread_mutex_unlock(&lock);
+        }
+        for (int i = 1; i < STATS_FIELDS; i++) {
+            if (copy.field[i] != copy.field[0]) {
+                st->torn++;
+                break;
+            }
+        }
+        st->reads++;
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) max_readers = atoi(argv[1]);
+    if (argc > 2) run_seconds = atof(argv[2]);
+    if (max_readers < 1) max_readers = 1;
+    if (max_readers > 256) max_readers = 256;
+
+    printf("=== Snapshot reads under continuous writes (%d-byte struct, %.2f s per run) ===\n",
+           (int)sizeof(stats_t), run_seconds);
+    printf("%-8s %7s %14s %14s %12s %8s\n", "variant", "readers", "Mreads/sec", "Mwrites/sec",
+           "retries/read", "torn");
+
+    for (use_seqlock = 1; use_seqlock >= 0; use_seqlock--) {
+        for (int readers = 1; readers <= max_readers; readers *= 2) {
+            pthread_t wt, rts[readers];
+            seqlock_init(&sl);
+            atomic_store(&stop, 0);
+            for (int i = 0; i < STATS_FIELDS; i++)
+                shared.field[i] = 0;
+            for (int i = 0; i < readers; i++)
+                reader_stats[i] = (reader_stats_t){ 0 };
+            pthread_barrier_init(&start_barrier, NULL, readers + 2);
+
+            pthread_create(&wt, NULL, writer, NULL);
+            for (int i = 0; i < readers; i++)
+                pthread_create(&rts[i], NULL, reader, (void *)(intptr_t)i);
+            pthread_barrier_wait(&start_barrier);
+            double t0 = now_sec();
+            usleep((useconds_t)(run_seconds * 1e6));
+            atomic_store(&stop, 1);
+            pthread_join(wt, NULL);
+            for (int i = 0; i < readers; i++)
+                pthread_join(rts[i], NULL);
+            double dt = now_sec() - t0;
+
+            unsigned long reads = 0, torn = 0, retries = 0;
+            for (int i = 0; i < readers; i++) {
+                reads += reader_stats[i].reads;
+                torn += reader_stats[i].torn;
+                retries += reader_stats[i].retries;
+            }
+            printf("%-8s %7d %14.2f %14.2f %12.3f %8lu\n", use_seqlock ? "seqlock" : "mutex",
+                   readers, reads / dt / 1e6, writes / dt / 1e6,
+                   reads ? (double)retries / reads : 0.0, torn);
+            pthread_barrier_destroy(&start_barrier);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+// committed_file.h
+// Append-only data file with a published "committed" offset, so readers never
+// take the writers' lock.
+//
+// Writers serialize among themselves (the caller's file_semaphore), write whole
+// records at the tail, then publish the new end offset with a release store.
+// Readers acquire-load that offset and pread() everything before it: every byte
+// below 'committed' is complete and never rewritten, so a reader always sees a
+// consistent prefix of the file and any number of readers can stream in parallel
+// without stalling a writer.
+// Readers that have caught up spin briefly and then sleep on a futex; writers
+// only issue the wake-up syscall when a reader is actually parked.
+// Writers format records into a cf_batch_t first and append a whole batch at a
+// time: one write() and one commit (and at most one wake-up) per batch. A larger
+// batch is cheaper per record; readers see the values a batch later.
+//
+// Usage:
+//   committed_file_t cf;
+//   cf_open(&cf, "empty_file.txt");        // existing content counts as committed
+//   cf_batch_t b = { .len = 0 };
+//   cf_batch_int(&b, value);               // writers, no lock needed
+//   cf_append_batch(&cf, &b);              // writers, under their own lock
+//   cf_close_writers(&cf);                 // no more appends: readers drain and stop
+//   long long pos = 0;
+//   n = cf_read_wait(&cf, &pos, buf, sizeof(buf));   // readers; 0 = end of data
+//   cf_close(&cf);
+
+#ifndef COMMITTED_FILE_H
+#define COMMITTED_FILE_H
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include "event_latch.h"   // cpu_relax(), futex_call()
+
+#define CF_SPIN 1000       // pause rounds before a caught-up reader parks
+#define CF_BATCH_MAX 64    // records a cf_batch_t can hold
+
+typedef struct {
+    int fd;                                  // O_RDWR | O_APPEND; pread() ignores O_APPEND
+    _Alignas(64) _Atomic long long committed; // Bytes that are complete and visible to readers
+    atomic_int seq;                          // Bumped on every commit (the futex word)
+    atomic_int waiters;                      // Readers parked or about to park
+    atomic_int closed;                       // 1 once writers are done
+} committed_file_t;
+
+// Opens (creates if needed) the file; returns 0 on success
+static inline int cf_open(committed_file_t *cf, const char *path) {
+    cf->fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    off_t size = cf->fd < 0 ? -1 : lseek(cf->fd, 0, SEEK_END);
+    if (size < 0) {
+        perror("committed_file: open failed");
+        if (cf->fd >= 0)
+            close(cf->fd);
+        return -1;
+    }
+    atomic_init(&cf->committed, (long long)size);
+    atomic_init(&cf->seq, 0);
+    atomic_init(&cf->waiters, 0);
+    atomic_init(&cf->closed, 0);
+    return 0;
+}
+
+static inline void cf_wake_readers(committed_file_t *cf) {
+    // seq_cst pairs with the reader's increment of 'waiters' (see event_latch_set)
+    atomic_fetch_add(&cf->seq, 1);
+    if (atomic_load(&cf->waiters) > 0)
+        futex_call(&cf->seq, FUTEX_WAKE_PRIVATE, __INT_MAX__);
+}
+
+// Writer side (caller holds the writers' lock): appends whole records, then
+// publishes them. Returns 0, or -1 if the write failed (nothing is published).
+static inline int cf_append(committed_file_t *cf, const char *rec, size_t len) {
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = write(cf->fd, rec + off, len - off);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("committed_file: write failed");
+            return -1;
+        }
+        off += (size_t)n;
+    }
+    long long end = atomic_load_explicit(&cf->committed, memory_order_relaxed) + (long long)len;
+    atomic_store_explicit(&cf->committed, end, memory_order_release);
+    cf_wake_readers(cf);
+    return 0;
+}
+
+// Records formatted by one writer, appended and committed together
+typedef struct {
+    char buf[CF_BATCH_MAX * 12];  // "<int>\n" is at most 12 bytes
+    size_t len;
+    int count;
+} cf_batch_t;
+
+// Adds "<value>\n" (the record format the readers parse); -1 if the batch is full
+static inline int cf_batch_int(cf_batch_t *b, int value) {
+    if (b->count == CF_BATCH_MAX)
+        return -1;
+    b->len += (size_t)snprintf(b->buf + b->len, sizeof(b->buf) - b->len, "%d\n", value);
+    b->count++;
+    return 0;
+}
+
+// Writer side (caller holds the writers' lock): appends and publishes the whole
+// batch, then empties it
+static inline int cf_append_batch(committed_file_t *cf, cf_batch_t *b) {
+    int rc = b->len ? cf_append(cf, b->buf, b->len) : 0;
+    b->len = 0;
+    b->count = 0;
+    return rc;
+}
+
+// Writers are finished: readers drain what is committed and then get 0
+static inline void cf_close_writers(committed_file_t *cf) {
+    atomic_store_explicit(&cf->closed, 1, memory_order_release);
+    cf_wake_readers(cf);
+}
+
+// Reader side, lock-free: copies up to max committed bytes from *pos and advances
+// it. Blocks while the reader has caught up; returns 0 once writers are closed
+// and everything was read, -1 on a read error.
+static inline ssize_t cf_read_wait(committed_file_t *cf, long long *pos, char *buf, size_t max) {
+    int spins = 0;
+    for (;;) {
+        int seen = atomic_load(&cf->seq);
+        int closed = atomic_load_explicit(&cf->closed, memory_order_acquire);
+        long long end = atomic_load_explicit(&cf->committed, memory_order_acquire);
+        if (*pos < end) {
+            size_t want = (size_t)(end - *pos) < max ? (size_t)(end - *pos) : max;
+            ssize_t n = pread(cf->fd, buf, want, (off_t)*pos);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n > 0)
+                *pos += n;
+            return n;
+        }
+        if (closed)
+            return 0;   // 'closed' was read before 'committed': nothing can follow
+
+        if (spins++ < CF_SPIN) {
+            cpu_relax();
+            continue;
+        }
+        atomic_fetch_add(&cf->waiters, 1);
+        futex_call(&cf->seq, FUTEX_WAIT_PRIVATE, seen);   // returns at once if seq moved
+        atomic_fetch_sub(&cf->waiters, 1);
+    }
+}
+
+static inline int cf_close(committed_file_t *cf) {
+    return close(cf->fd);
+}
+
+#endif // COMMITTED_FILE_H
@@ -1,7 +1,11 @@
 #include <stdio.h>
 #include <omp.h>
+#include "perf_counters.h"
 #define N 1000
 
+// Build with -DPERF_COUNTERS to get per-thread cycles/instructions/misses (perf_counters.h)
+PERF_REGION(add_region, "element add");
+
 int main() {
     int A[N], B[N], C[N];
 
@@ -10,9 +14,15 @@ int main() {
         B[i] = N-i;
     }
 
-    #pragma omp parallel for
-    for(int i=0;i<N;i++)
-        C[i] = A[i]+B[i];
+    // Each thread counts its own share of the loop (nowait: the barrier is not measured)
+    #pragma omp parallel
+    {
+        PERF_BEGIN(add_region);
+        #pragma omp for nowait
+        for(int i=0;i<N;i++)
+            C[i] = A[i]+B[i];
+        PERF_END(add_region);
+    }
 
     printf("C[0]=%d, C[N-1]=%d\n", C[0], C[N-1]);
     return 0;
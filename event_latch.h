@@ -0,0 +1,92 @@
+// event_latch.h
+// One-shot event (latch) that spins briefly and then parks on a Linux futex.
+//
+// Replaces the consumer's
+//     while (atomic_load_explicit(&fence_flag, memory_order_acquire) == 0);
+// which burns a full core for as long as the producers run. The waiter spins
+// with a pause/yield backoff for 'spin_limit' rounds (cheap if the event is
+// about to fire), then sleeps in the kernel. The setter only makes the futex
+// syscall when someone is actually parked.
+//
+// Memory ordering: event_latch_set() is a release and event_latch_wait() an
+// acquire, so everything written before set() is visible after wait() returns.
+//
+// Usage:
+//   event_latch_t ev;
+//   event_latch_init(&ev);
+//   event_latch_set(&ev);                          // publisher
+//   event_latch_wait(&ev, EVENT_SPIN_DEFAULT);     // waiter (0 = park at once)
+
+#ifndef EVENT_LATCH_H
+#define EVENT_LATCH_H
+
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define EVENT_SPIN_DEFAULT 2000   // pause rounds before parking (~a few microseconds)
+#define EVENT_SPIN_FOREVER -1     // never park: pure spin
+
+typedef struct {
+    _Alignas(64) atomic_int state;   // 0 = not set, 1 = set (the futex word)
+    atomic_int waiters;              // threads parked or about to park
+} event_latch_t;
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static inline long futex_call(atomic_int *addr, int op, int val) {
+    return syscall(SYS_futex, (int *)addr, op, val, NULL, NULL, 0);
+}
+
+static inline void event_latch_init(event_latch_t *ev) {
+    atomic_init(&ev->state, 0);
+    atomic_init(&ev->waiters, 0);
+}
+
+// Re-arms a latch once every waiter has returned
+static inline void event_latch_reset(event_latch_t *ev) {
+    atomic_store_explicit(&ev->state, 0, memory_order_relaxed);
+}
+
+static inline int event_latch_is_set(event_latch_t *ev) {
+    return atomic_load_explicit(&ev->state, memory_order_acquire);
+}
+
+// Publishes the event and wakes any parked waiters
+static inline void event_latch_set(event_latch_t *ev) {
+    // seq_cst pairs with the waiter's increment of 'waiters': at least one side
+    // sees the other, so a waiter can never park after missing the set
+    atomic_store(&ev->state, 1);
+    if (atomic_load(&ev->waiters) > 0)
+        futex_call(&ev->state, FUTEX_WAKE_PRIVATE, __INT_MAX__);
+}
+
+// Spins up to spin_limit rounds (EVENT_SPIN_FOREVER = never park), then parks
+static inline void event_latch_wait(event_latch_t *ev, int spin_limit) {
+    // Phase 1: spin with exponential pause backoff
+    int delay = 1;
+    for (int i = 0; spin_limit < 0 || i < spin_limit; i += delay) {
+        if (atomic_load_explicit(&ev->state, memory_order_acquire))
+            return;
+        for (int p = 0; p < delay; ++p)
+            cpu_relax();
+        if (delay < 64)
+            delay <<= 1;
+    }
+
+    // Phase 2: park until the state word changes from 0
+    atomic_fetch_add(&ev->waiters, 1);
+    while (atomic_load(&ev->state) == 0)
+        futex_call(&ev->state, FUTEX_WAIT_PRIVATE, 0);   // EAGAIN/EINTR: just re-check
+    atomic_fetch_sub(&ev->waiters, 1);
+    atomic_thread_fence(memory_order_acquire);
+}
+
+#endif // EVENT_LATCH_H
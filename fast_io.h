@@ -0,0 +1,124 @@
+// fast_io.h
+// In-process replacements for the shell helpers the programs used to run:
+//   system("touch file")  ->  fio_touch(file)
+//   system("cat file")    ->  fio_dump(file, STDOUT_FILENO)
+// Each system() call forks /bin/sh and execs a binary; these are one or two
+// syscalls. Appends go through append_log.h instead of system("echo ...").
+//
+// fio_dump() copies in the kernel: sendfile() first, then splice() (stdout is a
+// pipe), then a plain read()/write() loop for anything else (e.g. a terminal on
+// old kernels). Flush stdio before calling it so earlier printf output comes first.
+// splice() needs _GNU_SOURCE defined before the first #include of the program.
+
+#ifndef FAST_IO_H
+#define FAST_IO_H
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+
+// Creates the file if it does not exist (never truncates); returns 0 on success
+static inline int fio_touch(const char *path) {
+    int fd = open(path, O_WRONLY | O_CREAT, 0644);
+    if (fd < 0)
+        return -1;
+    return close(fd);
+}
+
+// Writes all len bytes (write() may be partial); returns 0 or -1
+static inline int fio_write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t w = write(fd, buf, len);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+// Reads up to len bytes at offset off (pread() may be partial); returns the
+// bytes read (fewer only at end of file) or -1
+static inline ssize_t fio_pread_all(int fd, char *buf, size_t len, off_t off) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, buf + done, len - done, off + (off_t)done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (n == 0)
+            break;
+        done += (size_t)n;
+    }
+    return (ssize_t)done;
+}
+
+// Writes all len bytes at offset off; returns 0 or -1
+static inline int fio_pwrite_all(int fd, const char *buf, size_t len, off_t off) {
+    while (len > 0) {
+        ssize_t w = pwrite(fd, buf, len, off);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += w;
+        off += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+// Copies the whole file to out_fd; returns bytes copied or -1 on error
+static inline long long fio_dump(const char *path, int out_fd) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    long long done = 0;
+    int method = 0;   // 0 = sendfile, 1 = splice, 2 = read/write
+    char buf[65536];
+    while (done < st.st_size) {
+        ssize_t n;
+        if (method == 0) {
+            n = sendfile(out_fd, fd, NULL, (size_t)(st.st_size - done));
+        } else if (method == 1) {
+            n = splice(fd, NULL, out_fd, NULL, (size_t)(st.st_size - done), SPLICE_F_MORE);
+        } else {
+            n = read(fd, buf, sizeof(buf));
+            if (n > 0 && fio_write_all(out_fd, buf, (size_t)n) != 0)
+                n = -1;
+        }
+
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && method < 2 && (errno == EINVAL || errno == ENOSYS)) {
+            method++;   // this fd pair does not support it: try the next method
+            continue;
+        }
+        if (n <= 0) {
+            if (n == 0)
+                break;  // file shrank underneath us
+            close(fd);
+            return -1;
+        }
+        done += n;
+    }
+    close(fd);
+    return done;
+}
+
+#endif // FAST_IO_H
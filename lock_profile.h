@@ -0,0 +1,441 @@
+// lock_profile.h
+// Contention profiler for the pthread mutexes, semaphores and condition
+// variables in the synchronization programs.
+//
+// prof_mutex_t / prof_sem_t / prof_cond_t wrap the pthread primitive plus a
+// name. Built with -DLOCK_PROFILE every wrapper records, per lock:
+//   acquires / contended   how often it was taken, and how often not immediately
+//   wait histogram         time blocked before getting it (log2 ns buckets)
+//   hold histogram         time between acquire and release (mutexes and
+//                          semaphores initialized to 1)
+//   blockers               which thread held the mutex (or posted the semaphore,
+//                          or signalled the condvar) while others were waiting
+// and at exit prints a report ranking the locks by total blocked time, to
+// stderr or $LOCK_PROFILE_FILE. Without -DLOCK_PROFILE the wrappers are the
+// plain pthread calls. With -DTRACE_EVENTS the wait and hold slices also go to
+// the trace (trace.h).
+//
+// Usage:
+//   prof_mutex_t lock;  prof_mutex_init(&lock, "producer_lock");
+//   prof_mutex_lock(&lock); ... prof_mutex_unlock(&lock);
+//   prof_cond_wait(&cond, &lock);
+//   prof_sem_wait(&sem); prof_sem_post(&sem);
+// Names must be string literals (only the pointer is stored).
+//
+// Compile: gcc -O2 -pthread -DLOCK_PROFILE ...    Run: LOCK_PROFILE_FILE=locks.txt ./prog
+
+#ifndef LOCK_PROFILE_H
+#define LOCK_PROFILE_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include "trace.h"
+
+#ifdef LOCK_PROFILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define LOCK_PROF_BUCKETS 40      // bucket b: [2^b, 2^(b+1)) ns, bucket 0 also holds 0
+#define LOCK_PROF_BLOCKERS 8      // distinct blocking threads remembered per lock
+
+typedef struct lock_prof {
+    struct lock_prof *next;
+    const char *name, *kind;
+    atomic_ulong acquires, contended;
+    atomic_ullong wait_ns, hold_ns, max_wait_ns;
+    atomic_ulong wait_hist[LOCK_PROF_BUCKETS], hold_hist[LOCK_PROF_BUCKETS];
+    atomic_long owner;             // holder (mutex), last poster (sem), last signaller (cond)
+    uint64_t acquired_ns;          // when the current holder got it (written by the holder)
+
+    pthread_mutex_t blockers_lock; // contended path only
+    struct { long tid; unsigned long waits; unsigned long long wait_ns; } blockers[LOCK_PROF_BLOCKERS];
+} lock_prof_t;
+
+static _Atomic(lock_prof_t *) lock_prof_list;
+static pthread_once_t lock_prof_once = PTHREAD_ONCE_INIT;
+static __thread long lock_prof_tid;
+
+static inline uint64_t lock_prof_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline long lock_prof_self(void) {
+    if (!lock_prof_tid)
+        lock_prof_tid = syscall(SYS_gettid);
+    return lock_prof_tid;
+}
+
+static inline int lock_prof_bucket(uint64_t ns) {
+    int b = ns ? 63 - __builtin_clzll(ns) : 0;
+    return b < LOCK_PROF_BUCKETS ? b : LOCK_PROF_BUCKETS - 1;
+}
+
+// Upper edge of the bucket holding the p-th fraction of the samples
+static uint64_t lock_prof_percentile(atomic_ulong *hist, double p) {
+    unsigned long total = 0, seen = 0;
+    for (int b = 0; b < LOCK_PROF_BUCKETS; ++b)
+        total += atomic_load(&hist[b]);
+    if (!total)
+        return 0;
+    for (int b = 0; b < LOCK_PROF_BUCKETS; ++b) {
+        seen += atomic_load(&hist[b]);
+        if (seen >= p * total)
+            return b ? 2ull << b : 0;
+    }
+    return 2ull << (LOCK_PROF_BUCKETS - 1);
+}
+
+static const char *lock_prof_time(char *buf, size_t size, uint64_t ns) {
+    if (ns < 10000)
+        snprintf(buf, size, "%lluns", (unsigned long long)ns);
+    else if (ns < 10000000)
+        snprintf(buf, size, "%.1fus", ns / 1e3);
+    else
+        snprintf(buf, size, "%.1fms", ns / 1e6);
+    return buf;
+}
+
+static void lock_prof_print_time(FILE *f, uint64_t ns) {
+    char buf[32];
+    fprintf(f, " %9s", lock_prof_time(buf, sizeof(buf), ns));
+}
+
+// One line of "<upper edge:count" pairs; nothing if the histogram is empty
+static void lock_prof_print_hist(FILE *f, const char *label, atomic_ulong *hist) {
+    char buf[32];
+    int any = 0;
+    for (int b = 0; b < LOCK_PROF_BUCKETS; ++b) {
+        unsigned long n = atomic_load(&hist[b]);
+        if (!n)
+            continue;
+        if (!any++)
+            fprintf(f, "    %s:", label);
+        fprintf(f, " <%s:%lu", lock_prof_time(buf, sizeof(buf), 2ull << b), n);
+    }
+    if (any)
+        fprintf(f, "\n");
+}
+
+// Writes the report, most blocked lock first (registered with atexit)
+static void lock_prof_report(void) {
+    const char *path = getenv("LOCK_PROFILE_FILE");
+    FILE *f = path ? fopen(path, "w") : stderr;
+    if (!f) {
+        perror("lock_profile: cannot write report");
+        return;
+    }
+
+    int n = 0;
+    for (lock_prof_t *p = atomic_load(&lock_prof_list); p; p = p->next)
+        n++;
+    lock_prof_t **sorted = malloc(sizeof(*sorted) * (n ? n : 1));
+    if (!sorted) {
+        if (f != stderr)
+            fclose(f);
+        return;
+    }
+    n = 0;
+    for (lock_prof_t *p = atomic_load(&lock_prof_list); p; p = p->next)
+        if (atomic_load(&p->acquires))   // never used (e.g. another counter backend)
+            sorted[n++] = p;
+    for (int i = 1; i < n; ++i)    // insertion sort on total blocked time
+        for (int j = i; j > 0 && atomic_load(&sorted[j]->wait_ns) > atomic_load(&sorted[j - 1]->wait_ns); --j) {
+            lock_prof_t *t = sorted[j];
+            sorted[j] = sorted[j - 1];
+            sorted[j - 1] = t;
+        }
+
+    fprintf(f, "=== Lock contention (ranked by total blocked time) ===\n");
+    fprintf(f, "%-16s %-6s %9s %9s %9s %9s %9s %9s %9s %9s  %s\n", "lock", "kind", "acquires", "contended",
+            "blocked", "wait p50", "wait p99", "wait max", "hold p50", "hold p99", "top blocker");
+    for (int i = 0; i < n; ++i) {
+        lock_prof_t *p = sorted[i];
+        fprintf(f, "%-16s %-6s %9lu %9lu", p->name, p->kind, atomic_load(&p->acquires),
+                atomic_load(&p->contended));
+        lock_prof_print_time(f, atomic_load(&p->wait_ns));
+        lock_prof_print_time(f, lock_prof_percentile(p->wait_hist, 0.50));
+        lock_prof_print_time(f, lock_prof_percentile(p->wait_hist, 0.99));
+        lock_prof_print_time(f, atomic_load(&p->max_wait_ns));
+        lock_prof_print_time(f, lock_prof_percentile(p->hold_hist, 0.50));
+        lock_prof_print_time(f, lock_prof_percentile(p->hold_hist, 0.99));
+
+        int top = -1;
+        for (int k = 0; k < LOCK_PROF_BLOCKERS; ++k)
+            if (p->blockers[k].tid && (top < 0 || p->blockers[k].wait_ns > p->blockers[top].wait_ns))
+                top = k;
+        if (top >= 0)
+            fprintf(f, "  tid %ld (%lu waits)\n", p->blockers[top].tid, p->blockers[top].waits);
+        else
+            fprintf(f, "  -\n");
+    }
+    fprintf(f, "Histograms (<bucket upper edge:count):\n");
+    for (int i = 0; i < n; ++i) {
+        fprintf(f, "  %s\n", sorted[i]->name);
+        lock_prof_print_hist(f, "wait", sorted[i]->wait_hist);
+        lock_prof_print_hist(f, "hold", sorted[i]->hold_hist);
+    }
+    free(sorted);
+    if (f != stderr)
+        fclose(f);
+}
+
+static void lock_prof_start(void) {
+    atexit(lock_prof_report);
+}
+
+// Allocates and registers a profile; profiles live until exit so the report sees them
+static inline lock_prof_t *lock_prof_new(const char *name, const char *kind) {
+    pthread_once(&lock_prof_once, lock_prof_start);
+    lock_prof_t *p = calloc(1, sizeof(*p));
+    if (!p)
+        abort();
+    p->name = name;
+    p->kind = kind;
+    pthread_mutex_init(&p->blockers_lock, NULL);
+    p->next = atomic_load(&lock_prof_list);
+    while (!atomic_compare_exchange_weak(&lock_prof_list, &p->next, p))
+        ;
+    return p;
+}
+
+static inline void lock_prof_wait(lock_prof_t *p, uint64_t ns, long blocker) {
+    atomic_fetch_add_explicit(&p->acquires, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&p->wait_hist[lock_prof_bucket(ns)], 1, memory_order_relaxed);
+    if (!ns)
+        return;
+    atomic_fetch_add_explicit(&p->contended, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&p->wait_ns, ns, memory_order_relaxed);
+    unsigned long long max = atomic_load_explicit(&p->max_wait_ns, memory_order_relaxed);
+    while (ns > max && !atomic_compare_exchange_weak(&p->max_wait_ns, &max, ns))
+        ;
+    if (!blocker)
+        return;
+    pthread_mutex_lock(&p->blockers_lock);
+    int slot = -1;
+    for (int k = 0; k < LOCK_PROF_BLOCKERS; ++k) {
+        if (p->blockers[k].tid == blocker) {
+            slot = k;
+            break;
+        }
+        if (slot < 0 && !p->blockers[k].tid)
+            slot = k;
+    }
+    if (slot >= 0) {     // table full: the blocker is not attributed
+        p->blockers[slot].tid = blocker;
+        p->blockers[slot].waits++;
+        p->blockers[slot].wait_ns += ns;
+    }
+    pthread_mutex_unlock(&p->blockers_lock);
+}
+
+static inline void lock_prof_hold(lock_prof_t *p, uint64_t ns) {
+    atomic_fetch_add_explicit(&p->hold_ns, ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&p->hold_hist[lock_prof_bucket(ns)], 1, memory_order_relaxed);
+}
+
+// ---------------- Mutex ----------------
+typedef struct {
+    pthread_mutex_t m;
+    const char *name;
+    lock_prof_t *prof;
+} prof_mutex_t;
+
+static inline void prof_mutex_init(prof_mutex_t *pm, const char *name) {
+    pthread_mutex_init(&pm->m, NULL);
+    pm->name = name;
+    pm->prof = lock_prof_new(name, "mutex");
+}
+
+// Called with the mutex just acquired
+static inline void prof_mutex_acquired(prof_mutex_t *pm) {
+    atomic_store_explicit(&pm->prof->owner, lock_prof_self(), memory_order_relaxed);
+    pm->prof->acquired_ns = lock_prof_now();
+}
+
+static inline void prof_mutex_lock(prof_mutex_t *pm) {
+    if (pthread_mutex_trylock(&pm->m) == 0) {
+        lock_prof_wait(pm->prof, 0, 0);
+    } else {
+        long holder = atomic_load_explicit(&pm->prof->owner, memory_order_relaxed);
+        uint64_t t0 = lock_prof_now();
+        TRACE_WAIT_BEGIN(pm->name);
+        pthread_mutex_lock(&pm->m);
+        TRACE_WAIT_END(pm->name);
+        uint64_t ns = lock_prof_now() - t0;
+        lock_prof_wait(pm->prof, ns ? ns : 1, holder);
+    }
+    TRACE_BEGIN(pm->name);
+    prof_mutex_acquired(pm);
+}
+
+// Called while still holding the mutex
+static inline void prof_mutex_releasing(prof_mutex_t *pm) {
+    lock_prof_hold(pm->prof, lock_prof_now() - pm->prof->acquired_ns);
+    atomic_store_explicit(&pm->prof->owner, 0, memory_order_relaxed);
+}
+
+static inline void prof_mutex_unlock(prof_mutex_t *pm) {
+    prof_mutex_releasing(pm);
+    TRACE_END(pm->name);
+    pthread_mutex_unlock(&pm->m);
+}
+
+// ---------------- Condition Variable ----------------
+// Time asleep in prof_cond_wait counts as the condvar's wait, not the mutex's hold
+typedef struct {
+    pthread_cond_t c;
+    const char *name;
+    lock_prof_t *prof;
+} prof_cond_t;
+
+static inline void prof_cond_init(prof_cond_t *pc, const char *name) {
+    pthread_cond_init(&pc->c, NULL);
+    pc->name = name;
+    pc->prof = lock_prof_new(name, "cond");
+}
+
+static inline void prof_cond_wait(prof_cond_t *pc, prof_mutex_t *pm) {
+    prof_mutex_releasing(pm);
+    TRACE_END(pm->name);
+    TRACE_WAIT_BEGIN(pc->name);
+    uint64_t t0 = lock_prof_now();
+    pthread_cond_wait(&pc->c, &pm->m);
+    uint64_t ns = lock_prof_now() - t0;
+    TRACE_WAIT_END(pc->name);
+    TRACE_BEGIN(pm->name);
+    lock_prof_wait(pc->prof, ns ? ns : 1, atomic_load_explicit(&pc->prof->owner, memory_order_relaxed));
+    prof_mutex_acquired(pm);
+}
+
+static inline void prof_cond_signal(prof_cond_t *pc) {
+    atomic_store_explicit(&pc->prof->owner, lock_prof_self(), memory_order_relaxed);
+    pthread_cond_signal(&pc->c);
+}
+
+static inline void prof_cond_broadcast(prof_cond_t *pc) {
+    atomic_store_explicit(&pc->prof->owner, lock_prof_self(), memory_order_relaxed);
+    pthread_cond_broadcast(&pc->c);
+}
+
+// ---------------- Semaphore ----------------
+// A semaphore initialized to 1 is used as a lock and also gets hold times
+typedef struct {
+    sem_t s;
+    const char *name;
+    int mutual;
+    lock_prof_t *prof;
+} prof_sem_t;
+
+static inline int prof_sem_init(prof_sem_t *ps, const char *name, unsigned value) {
+    ps->name = name;
+    ps->mutual = value == 1;
+    ps->prof = lock_prof_new(name, "sem");
+    return sem_init(&ps->s, 0, value);
+}
+
+static inline void prof_sem_wait(prof_sem_t *ps) {
+    if (sem_trywait(&ps->s) == 0) {
+        lock_prof_wait(ps->prof, 0, 0);
+    } else {
+        long blocker = atomic_load_explicit(&ps->prof->owner, memory_order_relaxed);
+        uint64_t t0 = lock_prof_now();
+        TRACE_WAIT_BEGIN(ps->name);
+        sem_wait(&ps->s);
+        TRACE_WAIT_END(ps->name);
+        uint64_t ns = lock_prof_now() - t0;
+        // A lock-like semaphore was held by the thread that had it when we arrived;
+        // a signalling one was released by whoever posted last
+        if (!ps->mutual)
+            blocker = atomic_load_explicit(&ps->prof->owner, memory_order_relaxed);
+        lock_prof_wait(ps->prof, ns ? ns : 1, blocker);
+    }
+    if (ps->mutual) {
+        TRACE_BEGIN(ps->name);
+        atomic_store_explicit(&ps->prof->owner, lock_prof_self(), memory_order_relaxed);
+        ps->prof->acquired_ns = lock_prof_now();
+    }
+}
+
+static inline void prof_sem_post(prof_sem_t *ps) {
+    if (ps->mutual) {
+        lock_prof_hold(ps->prof, lock_prof_now() - ps->prof->acquired_ns);
+        atomic_store_explicit(&ps->prof->owner, 0, memory_order_relaxed);
+        TRACE_END(ps->name);
+    } else {
+        atomic_store_explicit(&ps->prof->owner, lock_prof_self(), memory_order_relaxed);
+    }
+    sem_post(&ps->s);
+}
+
+#else // !LOCK_PROFILE: the plain pthread calls (plus trace slices with -DTRACE_EVENTS)
+
+typedef struct { pthread_mutex_t m; const char *name; } prof_mutex_t;
+typedef struct { pthread_cond_t c; const char *name; } prof_cond_t;
+typedef struct { sem_t s; const char *name; int mutual; } prof_sem_t;
+
+static inline void prof_mutex_init(prof_mutex_t *pm, const char *name) {
+    pthread_mutex_init(&pm->m, NULL);
+    pm->name = name;
+}
+static inline void prof_mutex_lock(prof_mutex_t *pm) {
+    TRACE_MUTEX_LOCK(&pm->m, pm->name);
+}
+static inline void prof_mutex_unlock(prof_mutex_t *pm) {
+    TRACE_MUTEX_UNLOCK(&pm->m, pm->name);
+}
+
+static inline void prof_cond_init(prof_cond_t *pc, const char *name) {
+    pthread_cond_init(&pc->c, NULL);
+    pc->name = name;
+}
+static inline void prof_cond_wait(prof_cond_t *pc, prof_mutex_t *pm) {
+    TRACE_END(pm->name);
+    TRACE_WAIT_BEGIN(pc->name);
+    pthread_cond_wait(&pc->c, &pm->m);
+    TRACE_WAIT_END(pc->name);
+    TRACE_BEGIN(pm->name);
+}
+static inline void prof_cond_signal(prof_cond_t *pc) {
+    pthread_cond_signal(&pc->c);
+}
+static inline void prof_cond_broadcast(prof_cond_t *pc) {
+    pthread_cond_broadcast(&pc->c);
+}
+
+static inline int prof_sem_init(prof_sem_t *ps, const char *name, unsigned value) {
+    ps->name = name;
+    ps->mutual = value == 1;
+    return sem_init(&ps->s, 0, value);
+}
+static inline void prof_sem_wait(prof_sem_t *ps) {
+    if (ps->mutual) {
+        TRACE_SEM_WAIT(&ps->s, ps->name);
+    } else {
+        TRACE_WAIT_BEGIN(ps->name);
+        sem_wait(&ps->s);
+        TRACE_WAIT_END(ps->name);
+    }
+}
+static inline void prof_sem_post(prof_sem_t *ps) {
+    if (ps->mutual)
+        TRACE_SEM_POST(&ps->s, ps->name);
+    else
+        sem_post(&ps->s);
+}
+
+#endif // LOCK_PROFILE
+
+// Profiles stay registered until exit; destroy only releases the primitive
+static inline void prof_mutex_destroy(prof_mutex_t *pm) { pthread_mutex_destroy(&pm->m); }
+static inline void prof_cond_destroy(prof_cond_t *pc) { pthread_cond_destroy(&pc->c); }
+static inline void prof_sem_destroy(prof_sem_t *ps) { sem_destroy(&ps->s); }
+
+#endif // LOCK_PROFILE_H
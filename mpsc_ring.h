@@ -0,0 +1,110 @@
+// mpsc_ring.h
+// Bounded lock-free multi-producer / single-consumer ring buffer.
+//
+// Every slot carries a sequence number (Vyukov bounded queue):
+//   seq == pos      slot is free for the producer that claims position pos
+//   seq == pos + 1  slot holds the value written at pos, ready for the consumer
+// Producers claim positions with a CAS on tail; the single consumer owns head and
+// needs no atomics on it. head and tail live on separate cache lines so producers
+// and the consumer do not false-share.
+//
+// Usage:
+//   mpsc_ring_t ring;
+//   mpsc_ring_init(&ring, 1024);          // capacity rounded up to a power of two
+//   mpsc_ring_push(&ring, value);         // producers (spins while full)
+//   if (mpsc_ring_pop(&ring, &value))     // consumer (non-blocking)
+//   mpsc_ring_destroy(&ring);
+
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sched.h>
+
+#define MPSC_CACHE_LINE 64
+
+typedef struct {
+    atomic_size_t seq;
+    long value;
+} mpsc_slot_t;
+
+typedef struct {
+    _Alignas(MPSC_CACHE_LINE) atomic_size_t tail;   // Next position producers claim
+    _Alignas(MPSC_CACHE_LINE) size_t head;          // Next position the consumer reads
+    _Alignas(MPSC_CACHE_LINE) size_t mask;          // capacity - 1 (read-only after init)
+    mpsc_slot_t *slots;
+} mpsc_ring_t;
+
+// Returns 0 on success, -1 if the slots cannot be allocated
+static inline int mpsc_ring_init(mpsc_ring_t *r, size_t capacity) {
+    size_t cap = 2;
+    while (cap < capacity)
+        cap <<= 1;
+    r->slots = aligned_alloc(MPSC_CACHE_LINE,
+                             (cap * sizeof(mpsc_slot_t) + MPSC_CACHE_LINE - 1) / MPSC_CACHE_LINE * MPSC_CACHE_LINE);
+    if (!r->slots)
+        return -1;
+    for (size_t i = 0; i < cap; ++i)
+        atomic_init(&r->slots[i].seq, i);
+    r->mask = cap - 1;
+    r->head = 0;
+    atomic_init(&r->tail, 0);
+    return 0;
+}
+
+static inline void mpsc_ring_destroy(mpsc_ring_t *r) {
+    free(r->slots);
+    r->slots = NULL;
+}
+
+// Producer side: returns 1 if queued, 0 if the ring is full
+static inline int mpsc_ring_try_push(mpsc_ring_t *r, long value) {
+    size_t pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    mpsc_slot_t *slot;
+    for (;;) {
+        slot = &r->slots[pos & r->mask];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            // Slot is free at our position: claim it (pos is reloaded on failure)
+            if (atomic_compare_exchange_weak_explicit(&r->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return 0;   // consumer has not freed this slot yet: full
+        } else {
+            pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+        }
+    }
+    slot->value = value;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);  // publish
+    return 1;
+}
+
+// Producer side: spins (yielding) until there is room
+static inline void mpsc_ring_push(mpsc_ring_t *r, long value) {
+    int spins = 0;
+    while (!mpsc_ring_try_push(r, value)) {
+        if (++spins > 64) {
+            sched_yield();
+            spins = 0;
+        }
+    }
+}
+
+// Consumer side: returns 1 and stores the oldest value, 0 if the ring is empty
+static inline int mpsc_ring_pop(mpsc_ring_t *r, long *value) {
+    mpsc_slot_t *slot = &r->slots[r->head & r->mask];
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (seq != r->head + 1)
+        return 0;
+    *value = slot->value;
+    // Hand the slot back to producers one lap ahead
+    atomic_store_explicit(&slot->seq, r->head + r->mask + 1, memory_order_release);
+    r->head++;
+    return 1;
+}
+
+#endif // MPSC_RING_H
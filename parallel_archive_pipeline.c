@@ -0,0 +1,498 @@
+// parallel_archive_pipeline.c
+// Single-pass archive pipeline: every chunk is read once, RLE-compressed,
+// encrypted with a per-chunk nonce and written in order, instead of running
+// parallel_file_compressor and parallel_file_encryption back to back (two full
+// passes and an intermediate file). Extraction runs the same chain backwards:
+// read record -> decrypt + decompress -> write at the chunk's offset.
+//
+// Each chunk is three OpenMP tasks chained with 'depend' on its buffer slot:
+//   read (pread at i * chunk)  ->  seal (compress, then encrypt in place)  ->  write
+// Writers are also chained on write_order so records land in chunk order. A
+// slot is reused MAX_INFLIGHT chunks later: the next read of a slot depends on
+// the previous write of it, which bounds memory to MAX_INFLIGHT chunks.
+//
+// The cipher is the XOR demo's idea made per chunk: a keystream of splitmix64
+// blocks keyed by the passphrase and a nonce derived from the archive nonce and
+// the chunk index, so no two chunks (or archives) reuse keystream. It is a
+// placeholder, not a vetted cipher; there is no authentication. Each record
+// carries a CRC32C of its raw bytes seeded from the key and the chunk nonce, so
+// a wrong passphrase or corrupt data fails extraction, stored chunks included.
+//
+// Archive layout (native byte order):
+//   archive_header_t, then per chunk: record_header_t + stored_len payload bytes
+//
+// Compile: gcc -O2 -fopenmp parallel_archive_pipeline.c -o parallel_archive_pipeline
+// Run:     ./parallel_archive_pipeline                       demo: archive, extract, compare
+//          ./parallel_archive_pipeline c <input> <archive> [passphrase]
+//          ./parallel_archive_pipeline x <archive> <output> [passphrase]
+
+#define _GNU_SOURCE     // splice() in fast_io.h
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <omp.h>
+#include "crc32c.h"
+#include "fast_io.h"
+#include "trace.h"
+
+#define CHUNK_SIZE (256 * 1024)   // raw bytes per chunk
+#define MAX_INFLIGHT 16           // chunk buffers in the pipeline at once
+#define ARCHIVE_MAGIC "PAE2"
+#define DEFAULT_PASSPHRASE "demo-key"
+
+#define METHOD_STORED 0           // compressed form was not smaller
+#define METHOD_RLE 1
+
+typedef struct {
+    char magic[4];
+    uint32_t chunk_size;
+    uint64_t chunks;
+    uint64_t raw_size;
+    uint64_t nonce;               // archive nonce; chunk i uses chunk_nonce(nonce, i)
+} archive_header_t;
+
+typedef struct {
+    uint32_t raw_len;             // bytes after decompression
+    uint32_t stored_len;          // payload bytes that follow
+    uint8_t method;
+    uint8_t pad[3];
+    uint32_t check;               // chunk_check() of the raw bytes
+} record_header_t;
+
+// One pipeline slot: raw chunk and its sealed (compressed + encrypted) form
+typedef struct {
+    char *raw;
+    char *sealed;
+    record_header_t rec;
+} slot_t;
+
+atomic_int failed;                // set by any task that hits an error
+
+// Task dependence addresses (only their addresses matter)
+char slot_dep[MAX_INFLIGHT];      // one per slot: read -> seal/open -> write
+char write_order, read_order;     // serialize archive writes / extract reads
+
+// ---------------- RLE ----------------
+// (char, run) pairs; runs longer than 255 are split
+size_t rle_compress(const char *in, size_t inlen, char *out) {
+    size_t oi = 0;
+    for (size_t i = 0; i < inlen; ) {
+        char c = in[i];
+        size_t j = i;
+        while (j < inlen && in[j] == c && j - i < 255) j++;
+        out[oi++] = c;
+        out[oi++] = (char)(j - i);
+        i = j;
+    }
+    return oi;
+}
+
+// Returns the decompressed length, or (size_t)-1 if it would exceed outcap
+size_t rle_decompress(const char *in, size_t inlen, char *out, size_t outcap) {
+    size_t oi = 0;
+    for (size_t i = 0; i + 1 < inlen; i += 2) {
+        size_t run = (unsigned char)in[i + 1];
+        if (run > outcap - oi)
+            return (size_t)-1;
+        memset(out + oi, in[i], run);
+        oi += run;
+    }
+    return oi;
+}
+
+// ---------------- Cipher ----------------
+static inline uint64_t mix64(uint64_t z) {
+    z += 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static uint64_t passphrase_key(const char *s) {
+    uint64_t h = 0xcbf29ce484222325ull;   // FNV-1a
+    for (; *s; ++s)
+        h = (h ^ (unsigned char)*s) * 0x100000001b3ull;
+    return mix64(h);
+}
+
+static inline uint64_t chunk_nonce(uint64_t archive_nonce, uint64_t chunk) {
+    return mix64(archive_nonce ^ mix64(chunk));
+}
+
+// XORs buf with the chunk's keystream (same call encrypts and decrypts)
+static void chunk_crypt(char *buf, size_t len, uint64_t key, uint64_t nonce) {
+    size_t i = 0;
+    for (uint64_t block = 0; i + 8 <= len; i += 8, ++block) {
+        uint64_t ks = mix64(key ^ (nonce + block)), w;
+        memcpy(&w, buf + i, 8);
+        w ^= ks;
+        memcpy(buf + i, &w, 8);
+    }
+    uint64_t ks = mix64(key ^ (nonce + len / 8));
+    for (; i < len; ++i, ks >>= 8)
+        buf[i] ^= (char)ks;
+}
+
+// Keyed check of a chunk's raw bytes: depends on the passphrase, so a wrong one
+// is caught even for stored chunks, whose bytes would decrypt to garbage unnoticed
+static inline uint32_t chunk_check(const char *raw, size_t len, uint64_t key, uint64_t nonce) {
+    return crc32c((uint32_t)mix64(key ^ ~nonce), raw, len);
+}
+
+// ---------------- Helpers ----------------
+static uint64_t random_nonce(void) {
+    uint64_t n = 0;
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd >= 0) {
+        if (read(fd, &n, sizeof(n)) != (ssize_t)sizeof(n))
+            n = 0;
+        close(fd);
+    }
+    return mix64(n ^ (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32));
+}
+
+static int slots_alloc(slot_t *slots) {
+    for (int s = 0; s < MAX_INFLIGHT; ++s) {
+        slots[s].raw = malloc(CHUNK_SIZE);
+        slots[s].sealed = malloc(CHUNK_SIZE * 2);   // RLE worst case doubles
+        if (!slots[s].raw || !slots[s].sealed)
+            return -1;
+    }
+    return 0;
+}
+
+static void slots_free(slot_t *slots) {
+    for (int s = 0; s < MAX_INFLIGHT; ++s) {
+        free(slots[s].raw);
+        free(slots[s].sealed);
+    }
+}
+
+static void fail(const char *what) {
+    if (!atomic_exchange(&failed, 1))
+        perror(what);
+}
+
+// ---------------- Archive ----------------
+// Returns 0 on success; *out_bytes gets the archive size
+static int archive_file(const char *in_path, const char *out_path, uint64_t key, long long *out_bytes) {
+    int in_fd = open(in_path, O_RDONLY);
+    if (in_fd < 0) {
+        perror("open input");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(in_fd, &st) != 0) {
+        perror("stat input");
+        close(in_fd);
+        return -1;
+    }
+    int out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0) {
+        perror("open archive");
+        close(in_fd);
+        return -1;
+    }
+
+    archive_header_t hdr;
+    memcpy(hdr.magic, ARCHIVE_MAGIC, 4);
+    hdr.chunk_size = CHUNK_SIZE;
+    hdr.raw_size = (uint64_t)st.st_size;
+    hdr.chunks = (hdr.raw_size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    hdr.nonce = random_nonce();
+
+    slot_t slots[MAX_INFLIGHT];
+    memset(slots, 0, sizeof(slots));
+    long long written = sizeof(hdr);
+    atomic_store(&failed, 0);
+
+    if (slots_alloc(slots) != 0 || fio_write_all(out_fd, (const char *)&hdr, sizeof(hdr)) != 0) {
+        perror("archive setup");
+        atomic_store(&failed, 1);
+    }
+
+    #pragma omp parallel if (!atomic_load(&failed))
+    {
+        #pragma omp single
+        {
+            for (uint64_t i = 0; i < hdr.chunks && !atomic_load(&failed); ++i) {
+                slot_t *c = &slots[i % MAX_INFLIGHT];
+                int s = (int)(i % MAX_INFLIGHT);
+
+                // read: the only pass over the input
+                #pragma omp task firstprivate(i, c) depend(out: slot_dep[s])
+                {
+                    TRACE_BEGIN("read chunk");
+                    ssize_t n = fio_pread_all(in_fd, c->raw, CHUNK_SIZE, (off_t)(i * CHUNK_SIZE));
+                    if (n < 0)
+                        fail("read input");
+                    c->rec.raw_len = n < 0 ? 0 : (uint32_t)n;
+                    TRACE_END("read chunk");
+                }
+
+                // seal: compress, then encrypt the compressed bytes while they are cache-hot
+                #pragma omp task firstprivate(i, c) depend(inout: slot_dep[s])
+                {
+                    TRACE_BEGIN("seal");
+                    c->rec.check = chunk_check(c->raw, c->rec.raw_len, key, chunk_nonce(hdr.nonce, i));
+                    size_t len = rle_compress(c->raw, c->rec.raw_len, c->sealed);
+                    c->rec.method = METHOD_RLE;
+                    if (len >= c->rec.raw_len) {
+                        memcpy(c->sealed, c->raw, c->rec.raw_len);
+                        len = c->rec.raw_len;
+                        c->rec.method = METHOD_STORED;
+                    }
+                    c->rec.stored_len = (uint32_t)len;
+                    chunk_crypt(c->sealed, len, key, chunk_nonce(hdr.nonce, i));
+                    TRACE_COUNTER("sealed bytes", len);
+                    TRACE_END("seal");
+                }
+
+                // write: in chunk order
+                #pragma omp task firstprivate(c) depend(in: slot_dep[s]) depend(inout: write_order)
+                {
+                    TRACE_BEGIN("write record");
+                    if (!atomic_load(&failed)) {
+                        if (fio_write_all(out_fd, (const char *)&c->rec, sizeof(c->rec)) != 0 ||
+                            fio_write_all(out_fd, c->sealed, c->rec.stored_len) != 0)
+                            fail("write archive");
+                        written += (long long)(sizeof(c->rec) + c->rec.stored_len);
+                    }
+                    TRACE_END("write record");
+                }
+            }
+            #pragma omp taskwait
+        }
+    }
+
+    slots_free(slots);
+    close(in_fd);
+    if (close(out_fd) != 0)
+        fail("close archive");
+    *out_bytes = written;
+    return atomic_load(&failed) ? -1 : 0;
+}
+
+// ---------------- Extract ----------------
+// Returns 0 on success; *out_bytes gets the extracted size
+static int extract_file(const char *in_path, const char *out_path, uint64_t key, long long *out_bytes) {
+    int in_fd = open(in_path, O_RDONLY);
+    if (in_fd < 0) {
+        perror("open archive");
+        return -1;
+    }
+    archive_header_t hdr;
+    struct stat st;
+    if (fstat(in_fd, &st) != 0 || fio_pread_all(in_fd, (char *)&hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+        memcmp(hdr.magic, ARCHIVE_MAGIC, 4) != 0 || hdr.chunk_size != CHUNK_SIZE) {
+        fprintf(stderr, "%s: not a %s archive with %d-byte chunks\n", in_path, ARCHIVE_MAGIC, CHUNK_SIZE);
+        close(in_fd);
+        return -1;
+    }
+    // every chunk but the last is full, so the chunk count follows from the size
+    if (hdr.chunks != hdr.raw_size / CHUNK_SIZE + (hdr.raw_size % CHUNK_SIZE != 0)) {
+        fprintf(stderr, "%s: corrupt header\n", in_path);
+        close(in_fd);
+        return -1;
+    }
+    int out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0) {
+        perror("open output");
+        close(in_fd);
+        return -1;
+    }
+
+    slot_t slots[MAX_INFLIGHT];
+    memset(slots, 0, sizeof(slots));
+    off_t in_off = sizeof(hdr);    // records are variable-length: read them in order
+    uint64_t raw_total = 0;        // raw_len of the records read (read_order)
+    atomic_llong written = 0;      // bytes actually written to the output
+    atomic_store(&failed, 0);
+    if (slots_alloc(slots) != 0) {
+        perror("extract setup");
+        atomic_store(&failed, 1);
+    }
+
+    #pragma omp parallel if (!atomic_load(&failed))
+    {
+        #pragma omp single
+        {
+            for (uint64_t i = 0; i < hdr.chunks && !atomic_load(&failed); ++i) {
+                slot_t *c = &slots[i % MAX_INFLIGHT];
+                int s = (int)(i % MAX_INFLIGHT);
+
+                // read the next record (sequential: its offset depends on the previous one)
+                #pragma omp task firstprivate(i, c) depend(out: slot_dep[s]) depend(inout: read_order)
+                {
+                    TRACE_BEGIN("read record");
+                    if (!atomic_load(&failed)) {
+                        uint64_t expect = i + 1 < hdr.chunks ? CHUNK_SIZE : hdr.raw_size - i * CHUNK_SIZE;
+                        if (fio_pread_all(in_fd, (char *)&c->rec, sizeof(c->rec), in_off) != (ssize_t)sizeof(c->rec) ||
+                            c->rec.raw_len != expect || c->rec.stored_len > 2 * CHUNK_SIZE ||
+                            (c->rec.method != METHOD_RLE &&
+                             (c->rec.method != METHOD_STORED || c->rec.stored_len != c->rec.raw_len)) ||
+                            fio_pread_all(in_fd, c->sealed, c->rec.stored_len, in_off + (off_t)sizeof(c->rec)) !=
+                                (ssize_t)c->rec.stored_len) {
+                            fprintf(stderr, "%s: truncated or corrupt record\n", in_path);
+                            atomic_store(&failed, 1);
+                        }
+                        in_off += (off_t)(sizeof(c->rec) + c->rec.stored_len);
+                        raw_total += c->rec.raw_len;
+                    }
+                    TRACE_END("read record");
+                }
+
+                // open: decrypt in place, then decompress into the raw buffer
+                #pragma omp task firstprivate(i, c) depend(inout: slot_dep[s])
+                {
+                    TRACE_BEGIN("open");
+                    if (!atomic_load(&failed)) {
+                        chunk_crypt(c->sealed, c->rec.stored_len, key, chunk_nonce(hdr.nonce, i));
+                        size_t len = c->rec.stored_len;
+                        if (c->rec.method == METHOD_STORED)
+                            memcpy(c->raw, c->sealed, len);
+                        else
+                            len = rle_decompress(c->sealed, c->rec.stored_len, c->raw, CHUNK_SIZE);
+                        if (len != c->rec.raw_len ||
+                            chunk_check(c->raw, len, key, chunk_nonce(hdr.nonce, i)) != c->rec.check) {
+                            fprintf(stderr, "chunk %llu: wrong passphrase or corrupt data\n", (unsigned long long)i);
+                            atomic_store(&failed, 1);
+                        }
+                    }
+                    TRACE_END("open");
+                }
+
+                // write: every chunk has a fixed offset, so writers run in parallel
+                #pragma omp task firstprivate(i, c) depend(in: slot_dep[s])
+                {
+                    TRACE_BEGIN("write chunk");
+                    if (!atomic_load(&failed)) {
+                        if (fio_pwrite_all(out_fd, c->raw, c->rec.raw_len, (off_t)(i * CHUNK_SIZE)) != 0)
+                            fail("write output");
+                        else
+                            atomic_fetch_add(&written, c->rec.raw_len);
+                    }
+                    TRACE_END("write chunk");
+                }
+            }
+            #pragma omp taskwait
+        }
+    }
+
+    // the records must account for the whole archive and the whole output
+    if (!atomic_load(&failed) && (raw_total != hdr.raw_size || (uint64_t)in_off != (uint64_t)st.st_size)) {
+        fprintf(stderr, "%s: records do not match the header\n", in_path);
+        atomic_store(&failed, 1);
+    }
+    slots_free(slots);
+    close(in_fd);
+    if (close(out_fd) != 0)
+        fail("close output");
+    *out_bytes = atomic_load(&written);
+    return atomic_load(&failed) ? -1 : 0;
+}
+
+// ---------------- Demo ----------------
+static int make_sample(const char *path, long long bytes) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+    static const char *lines[] = { "AAAAABBBBCCCCDDDDDEEEE\n", "AABBCC\n", "AAAA\n",
+                                   "timestamp,sensor,value\n", "                                \n" };
+    char buf[4096];
+    size_t len = 0;
+    unsigned seed = 1;
+    int rc = 0;
+    for (long long done = 0; done < bytes; ) {
+        const char *l = lines[rand_r(&seed) % 5];
+        size_t n = strlen(l);
+        if (len + n > sizeof(buf)) {
+            if ((rc = fio_write_all(fd, buf, len)) != 0)
+                break;
+            done += (long long)len;
+            len = 0;
+        }
+        memcpy(buf + len, l, n);
+        len += n;
+    }
+    if (rc == 0 && len)
+        rc = fio_write_all(fd, buf, len);
+    if (close(fd) != 0)
+        rc = -1;
+    return rc;
+}
+
+static int same_contents(const char *a, const char *b) {
+    FILE *fa = fopen(a, "rb"), *fb = fopen(b, "rb");
+    int same = fa && fb;
+    while (same) {
+        int ca = fgetc(fa), cb = fgetc(fb);
+        same = ca == cb;
+        if (ca == EOF)
+            break;
+    }
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return same;
+}
+
+// ---------------- Main ----------------
+int main(int argc, char **argv) {
+    const char *mode = argc > 1 ? argv[1] : "demo";
+    const char *pass = argc > 4 ? argv[4] : DEFAULT_PASSPHRASE;
+    uint64_t key = passphrase_key(pass);
+    long long in_bytes = 0, out_bytes = 0;
+    struct stat st;
+
+    if ((!strcmp(mode, "c") || !strcmp(mode, "x")) && argc >= 4) {
+        double t0 = omp_get_wtime();
+        int rc = mode[0] == 'c' ? archive_file(argv[2], argv[3], key, &out_bytes)
+                                : extract_file(argv[2], argv[3], key, &out_bytes);
+        double dt = omp_get_wtime() - t0;
+        if (rc != 0)
+            return 1;
+        in_bytes = stat(argv[2], &st) == 0 ? (long long)st.st_size : 0;
+        printf("%s: %lld -> %lld bytes in %.3f s (%.1f MB/s of input, %d threads)\n",
+               mode[0] == 'c' ? "archived" : "extracted", in_bytes, out_bytes, dt,
+               dt > 0 ? in_bytes / dt / 1e6 : 0.0, omp_get_max_threads());
+        return 0;
+    }
+    if (strcmp(mode, "demo") != 0) {
+        fprintf(stderr, "Usage: %s [c <input> <archive> | x <archive> <output>] [passphrase]\n", argv[0]);
+        return 1;
+    }
+
+    const char *infile = "demo_input.txt", *archive = "demo_output.pae", *restored = "demo_restored.txt";
+    omp_set_dynamic(0);
+    if (make_sample(infile, 8LL * 1024 * 1024) != 0) {
+        perror("create sample input");
+        return 1;
+    }
+    in_bytes = stat(infile, &st) == 0 ? (long long)st.st_size : 0;
+
+    double t0 = omp_get_wtime();
+    if (archive_file(infile, archive, key, &out_bytes) != 0)
+        return 1;
+    double t1 = omp_get_wtime();
+    long long restored_bytes = 0;
+    if (extract_file(archive, restored, key, &restored_bytes) != 0)
+        return 1;
+    double t2 = omp_get_wtime();
+
+    printf("Input      %lld bytes, %d-byte chunks, %d threads\n", in_bytes, CHUNK_SIZE, omp_get_max_threads());
+    printf("Archive    %lld bytes (%.1f%%) in %.3f s\n", out_bytes, in_bytes ? 100.0 * out_bytes / in_bytes : 0.0,
+           t1 - t0);
+    printf("Extract    %lld bytes in %.3f s\n", restored_bytes, t2 - t1);
+    // Two-pass route: read input, write .rle, read .rle, write encrypted file
+    printf("Disk I/O   fused %lld bytes vs. two passes ~%lld bytes\n", in_bytes + out_bytes,
+           in_bytes + 3 * out_bytes);
+    int ok = same_contents(infile, restored);
+    printf(ok ? "Round trip OK.\n" : "Round trip MISMATCH.\n");
+    return ok ? 0 : 1;
+}
@@ -1,35 +1,96 @@
 // ttt_limit_27.c
 // Implements parallel Tic-Tac-Toe game tree exploration using OpenMP tasks.
 // Dynamically prunes the search space once 27 unique (canonical) terminal games are found.
+// Tasks are only spawned for the first CUTOFF plies; deeper subtrees are searched
+// by a plain recursive loop on a single board, so each task carries real work.
 //
 // Compile: gcc -O2 -fopenmp ttt_limit_27.c -o ttt_limit_27
-// Run:     ./ttt_limit_27
+// Run:     ./ttt_limit_27 [cutoff] [task|taskloop|final] [--deterministic]
+//          ./ttt_limit_27 --bench [--deterministic]
+//          add --trace to print every discovery (buffered per thread, shown at the end)
+//          build with -DTRACE_EVENTS to write a Chrome trace of the tasks (trace.h)
+//          build with -DPERF_COUNTERS for per-thread hardware counters of the search (perf_counters.h)
+//          TASK_RUNTIME=ws runs the tasks on the work-stealing runtime (ws_runtime.h) instead of
+//          libgomp (or build with -DUSE_WS_RUNTIME); it supports the task strategy only
+//
+// --deterministic: the 27 games are the first 27 canonical games in lexicographic
+// move order (what a 1-thread run finds), independent of thread count and timing.
+// Pruning uses the rank of the 27th best game found so far as a moving bound.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
 #include <limits.h>
+#include <stdint.h>
 #include <omp.h>
 #include <stdatomic.h>
+#include "perf_counters.h"
+#include "trace.h"
+#include "ws_runtime.h"
 
 #define EMPTY 0
 #define X 1
 #define O 2
 #define TARGET_COUNT 27
-
-// --- Global Atomic Counters for Results and Control ---
-atomic_int found_count = 0;       // Total unique canonical games found
+#define MAX_THREADS 256
+
+// --- Task Strategies ---
+#define STRATEGY_TASK 0       // one task per move above the cutoff
+#define STRATEGY_TASKLOOP 1   // one taskloop over the moves above the cutoff
+#define STRATEGY_FINAL 2      // tasks become final()/mergeable at the cutoff
+
+int cutoff_depth = 3;             // plies from the root that spawn tasks
+int strategy = STRATEGY_TASK;
+int target_count = TARGET_COUNT;  // 0 = no pruning (explore the full tree)
+int deterministic = 0;            // 1 = rank-ordered target set (see header)
+int trace_enabled = 0;            // 1 = buffer a line per discovery (--trace)
+int task_runtime = TASK_RUNTIME_OMP;   // TASK_RUNTIME_WS = ws_runtime.h (see header)
+ws_pool_t *ws_pool;               // Workers of the last ws run (kept for its statistics)
+
+// --- Search Control ---
+int found_count = 0;              // Total unique canonical games found (history_lock)
 atomic_int stop_search = 0;       // Global flag for dynamic pruning/early stop
 
-atomic_int x_win_count = 0;       // Count of canonical X wins
-atomic_int o_win_count = 0;       // Count of canonical O wins
-atomic_int draw_count = 0;        // Count of canonical Draws
+// --- Per-Thread Statistics ---
+// One cache-line-aligned block per thread, so the hot path never shares a line
+// with another thread. Blocks are merged into 'totals' once the search is over.
+typedef struct {
+    _Alignas(64) long long nodes; // Boards visited
+    long long terminals;          // Finished games reached
+    long long duplicates;         // Finished games whose canonical key was already known
+    long long pruned;             // Subtrees skipped by the stop flag / rank bound
+    long long tasks;              // play_game_task calls (one per task)
+    int x_wins, o_wins, draws;    // New canonical games by outcome
+    char *trace;                  // Buffered trace lines, printed after the search
+    size_t trace_len, trace_cap;
+} thread_stats_t;
+
+thread_stats_t stats[MAX_THREADS];
+thread_stats_t totals;
 
 // --- Shared Data for Canonical History ---
 // Stores canonical integer representations of boards already found.
 int canonical_history[1000];
 omp_lock_t history_lock;          // Lock to protect shared history array
 
+// --- Deterministic Mode State (protected by history_lock) ---
+// A game's rank is its move sequence read as a base-10 number (cell+1 per ply,
+// padded with zeros), so ranks order games lexicographically by moves.
+#define NUM_KEYS 19683                       // 3^9 canonical key space
+#define NO_RANK UINT64_MAX
+uint64_t best_rank[NUM_KEYS];                // Smallest rank seen per canonical key
+int key_winner[NUM_KEYS];                    // Outcome of each canonical board
+uint64_t top_rank[TARGET_COUNT];             // Best target_count ranks, ascending
+int top_key[TARGET_COUNT];
+int top_size = 0;
+_Atomic uint64_t rank_bound = NO_RANK;       // Subtrees ranked above this are pruned
+
+static const uint64_t POW10[10] = {
+    100000000ULL, 10000000ULL, 1000000ULL, 100000ULL, 10000ULL,
+    1000ULL, 100ULL, 10ULL, 1ULL, 0ULL
+};
+
 // --- Game Logic Constants ---
 static const int WIN[8][3] = {
     {0,1,2},{3,4,5},{6,7,8},
@@ -101,129 +162,512 @@ int get_canonical_key(int b[9]) {
     return min_key;
 }
 
-// --- Main Parallel Task Function ---
-
-void play_game_task(int board[9], int player) {
+// --- Buffered Trace ---
 
-    // 1. DYNAMIC PRUNING CHECK 
-    if(atomic_load(&stop_search))
+// Appends one formatted line to the calling thread's trace buffer (no stdio lock)
+void trace_printf(thread_stats_t *st, const char *fmt, ...) {
+    char line[128];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if(n < 0)
         return;
+    if((size_t)n >= sizeof(line))
+        n = sizeof(line) - 1;
 
-    int winner = check_win(board);
-    int full = is_full(board);
+    if(st->trace_len + n + 1 > st->trace_cap) {
+        size_t cap = st->trace_cap ? st->trace_cap * 2 : 4096;
+        char *p = realloc(st->trace, cap);
+        if(!p)
+            return;
+        st->trace = p;
+        st->trace_cap = cap;
+    }
+    memcpy(st->trace + st->trace_len, line, n + 1);
+    st->trace_len += n;
+}
+
+// --- Terminal State Processing ---
+
+// Keeps the target_count canonical keys with the smallest ranks.
+// Returns 0 if the key was already known with an equal or better rank.
+int record_ranked(int key, int winner, uint64_t rank) {
+    int improved = 0;
+    omp_set_lock(&history_lock);
+
+    if(rank < best_rank[key]) {
+        improved = best_rank[key] == NO_RANK ? 2 : 1;
+        best_rank[key] = rank;
+        key_winner[key] = winner;
+
+        // Find the key in the top list, or a free/evictable slot for it
+        int pos = -1;
+        for(int i = 0; i < top_size; ++i)
+            if(top_key[i] == key)
+                pos = i;
+        if(pos < 0 && top_size < target_count)
+            pos = top_size++;
+        else if(pos < 0 && rank < top_rank[top_size - 1])
+            pos = top_size - 1;
+
+        if(pos >= 0) {
+            // Insertion step: move the improved entry towards the front
+            while(pos > 0 && top_rank[pos - 1] > rank) {
+                top_rank[pos] = top_rank[pos - 1];
+                top_key[pos] = top_key[pos - 1];
+                --pos;
+            }
+            top_rank[pos] = rank;
+            top_key[pos] = key;
+
+            if(top_size == target_count)
+                atomic_store(&rank_bound, top_rank[top_size - 1]);
+        }
+    }
 
-    // 2. TERMINAL STATE PROCESSING
-    if(winner || full) {
-        int key = get_canonical_key(board);
-        int is_new = 0;
+    omp_unset_lock(&history_lock);
+    return improved;
+}
 
-        // Use lock for safe access and modification of shared history/counters
-        omp_set_lock(&history_lock);
+// Records a finished game if its canonical key has not been seen yet
+void record_terminal(thread_stats_t *st, int board[9], int winner, uint64_t rank) {
+    int key = get_canonical_key(board);
+    int is_new = 0;
+
+    st->terminals++;
+
+    if(deterministic) {
+        // Outcomes are tallied from the final ranked set, not per discovery
+        int improved = record_ranked(key, winner, rank);
+        if(improved != 2)
+            st->duplicates++;
+        if(improved && trace_enabled)
+            trace_printf(st, "[Thread %d] Candidate key %d  moves %09llu  Winner: %c\n",
+                         (int)(st - stats), key, (unsigned long long)rank,
+                         winner==X?'X':winner==O?'O':'D');
+        return;
+    }
 
-        if(!atomic_load(&stop_search)) {
-            int exists = 0;
-            int current_cnt = atomic_load(&found_count);
+    // Use lock for safe access and modification of shared history
+    omp_set_lock(&history_lock);
 
-            // Check if this canonical key has already been stored
-            for(int i = 0; i < current_cnt; ++i) {
-                if(canonical_history[i] == key) {
-                    exists = 1;
-                    break;
-                }
-            }
+    int current_cnt = found_count;
+    if(!atomic_load(&stop_search)) {
+        int exists = 0;
 
-            if(!exists) {
-                canonical_history[current_cnt] = key;
-                atomic_fetch_add(&found_count, 1);
-                is_new = 1;
-
-                // Update final results count
-                if(winner == X)
-                    atomic_fetch_add(&x_win_count, 1);
-                else if(winner == O)
-                    atomic_fetch_add(&o_win_count, 1);
-                else
-                    atomic_fetch_add(&draw_count, 1);
-
-                // Check for TARGET and set PRUNING flag
-                if(atomic_load(&found_count) >= TARGET_COUNT)
-                    atomic_store(&stop_search, 1);
+        // Check if this canonical key has already been stored
+        for(int i = 0; i < current_cnt; ++i) {
+            if(canonical_history[i] == key) {
+                exists = 1;
+                break;
             }
         }
 
-        omp_unset_lock(&history_lock);
+        if(!exists) {
+            canonical_history[current_cnt] = key;
+            found_count = current_cnt + 1;
+            is_new = 1;
 
-        if(is_new) {
-            printf("[Thread %d] Unique #%d  Winner: %c\n",
-                   omp_get_thread_num(),
-                   atomic_load(&found_count),
-                   winner==X?'X':winner==O?'O':'D');
+            // Check for TARGET and set PRUNING flag
+            if(target_count > 0 && found_count >= target_count)
+                atomic_store(&stop_search, 1);
+        } else {
+            st->duplicates++;
         }
+    }
 
+    omp_unset_lock(&history_lock);
+
+    // Outcome counts stay in this thread's block until the final merge
+    if(is_new) {
+        if(winner == X)
+            st->x_wins++;
+        else if(winner == O)
+            st->o_wins++;
+        else
+            st->draws++;
+
+        if(trace_enabled)
+            trace_printf(st, "[Thread %d] Unique #%d  Winner: %c\n",
+                         (int)(st - stats), current_cnt + 1,
+                         winner==X?'X':winner==O?'O':'D');
+    }
+}
+
+// --- Sequential Search Below the Cutoff ---
+
+// Checks both pruning rules: the target was reached, or (deterministic mode)
+// every game below this prefix ranks after the current target set
+static int pruned(uint64_t rank) {
+    if(deterministic)
+        return rank > atomic_load_explicit(&rank_bound, memory_order_relaxed);
+    return atomic_load_explicit(&stop_search, memory_order_relaxed);
+}
+
+// Plain recursion on one board (make/unmake), counting into the caller's block
+void play_game_seq(thread_stats_t *st, int board[9], int player, int depth, uint64_t rank) {
+    if(pruned(rank)) {
+        st->pruned++;
+        return;
+    }
+
+    st->nodes++;
+
+    int winner = check_win(board);
+    if(winner || is_full(board)) {
+        record_terminal(st, board, winner, rank);
         return;
     }
 
-    // 3. SPAWN TASKS FOR EACH MOVE 
     for(int i = 0; i < 9; ++i) {
+        if(board[i] == EMPTY) {
+            board[i] = player;
+            play_game_seq(st, board, player==X?O:X, depth + 1, rank + (i + 1) * POW10[depth]);
+            board[i] = EMPTY;
+        }
+    }
+}
+
+// --- Main Parallel Task Function ---
+
+void play_game_task(int board[9], int player, int depth, uint64_t rank);
+
+// Index of the calling thread's stats block under either runtime
+static inline int worker_num(void) {
+    return task_runtime == TASK_RUNTIME_WS ? ws_worker_id() : omp_get_thread_num();
+}
+
+// Arguments of one child task on the ws runtime (copied into the task)
+typedef struct {
+    int board[9];
+    int player, depth;
+    uint64_t rank;
+} node_args_t;
+
+static void play_game_ws(void *p) {
+    node_args_t *a = p;
+    play_game_task(a->board, a->player, a->depth, a->rank);
+}
+
+// One node of the task-parallel search (play_game_task wraps it in a trace slice)
+void play_game_node(int board[9], int player, int depth, uint64_t rank) {
+    thread_stats_t *st = &stats[worker_num()];
+
+    // 1. DYNAMIC PRUNING CHECK 
+    if(pruned(rank)) {
+        st->pruned++;
+        return;
+    }
+
+    // 2. GRANULARITY CUTOFF: the rest of this subtree is one sequential unit. Under
+    // STRATEGY_FINAL a final task also stops here; the depth test still covers the
+    // root, which is never a final task (cutoff 0 = fully sequential for every strategy).
+    int sequential = depth >= cutoff_depth ||
+                     (strategy == STRATEGY_FINAL && task_runtime == TASK_RUNTIME_OMP && omp_in_final());
+    if(sequential) {
+        play_game_seq(st, board, player, depth, rank);
+        return;
+    }
+
+    st->nodes++;
+
+    // 3. TERMINAL STATE PROCESSING
+    int winner = check_win(board);
+    if(winner || is_full(board)) {
+        record_terminal(st, board, winner, rank);
+        return;
+    }
+
+    // 4. SPAWN TASKS FOR EACH MOVE 
+    if(strategy == STRATEGY_TASKLOOP && task_runtime == TASK_RUNTIME_OMP) {
+        int moves[9], n = 0;
+        for(int i = 0; i < 9; ++i)
+            if(board[i] == EMPTY)
+                moves[n++] = i;
+
+        // taskloop carries an implicit taskgroup, so no taskwait is needed
+        #pragma omp taskloop grainsize(1) firstprivate(board, moves, player, depth, rank) default(none) \
+        shared(POW10)
+        for(int j = 0; j < n; ++j) {
+            int next_board[9];
+            memcpy(next_board, board, 9 * sizeof(int));
+            next_board[moves[j]] = player;
+            play_game_task(next_board, player==X?O:X, depth + 1, rank + (moves[j] + 1) * POW10[depth]);
+        }
+        return;
+    }
+
+    ws_frame_t frame;
+    ws_frame_init(&frame);
+    for(int i = 0; i < 9; ++i) {
+        uint64_t next_rank = rank + (i + 1) * POW10[depth];
+
         // Re-check stop flag before spawning the next move's task
-        if(atomic_load(&stop_search))
-            return;
+        if(pruned(next_rank)) {
+            st->pruned++;
+            break;
+        }
 
         if(board[i] == EMPTY) {
             int next_board[9];
             memcpy(next_board, board, 9 * sizeof(int));
             next_board[i] = player;
 
-            // FIX: 'player' added to firstprivate list to satisfy default(none)
-            #pragma omp task firstprivate(next_board, player) \
-            shared(stop_search, history_lock, found_count, canonical_history, x_win_count, o_win_count, draw_count) \
-            default(none)
-            {
-                // Recursive call, switching player (X plays O, O plays X)
-                play_game_task(next_board, player==X?O:X);
+            if(task_runtime == TASK_RUNTIME_WS) {
+                node_args_t a = { .player = player==X?O:X, .depth = depth + 1, .rank = next_rank };
+                memcpy(a.board, next_board, sizeof(a.board));
+                ws_spawn(&frame, play_game_ws, &a, sizeof(a));
+            } else if(strategy == STRATEGY_FINAL) {
+                // Tasks at the cutoff are final: their descendants run inline, and
+                // mergeable lets the runtime reuse the parent's data environment
+                #pragma omp task firstprivate(next_board, player, depth, next_rank) default(none) \
+                final(depth + 1 >= cutoff_depth) mergeable
+                play_game_task(next_board, player==X?O:X, depth + 1, next_rank);
+            } else {
+                #pragma omp task firstprivate(next_board, player, depth, next_rank) default(none)
+                play_game_task(next_board, player==X?O:X, depth + 1, next_rank);
             }
         }
     }
 
     // Wait for all child tasks (moves) from this board state to complete
-    #pragma omp taskwait
+    if(task_runtime == TASK_RUNTIME_WS)
+        ws_sync(&frame);
+    else {
+        #pragma omp taskwait
+    }
 }
 
-// --- Main Execution ---
+// Counted once per thread per outermost task: nested tasks run at a taskwait are included
+PERF_REGION(search_region, "play_game_task");
+
+void play_game_task(int board[9], int player, int depth, uint64_t rank) {
+    stats[worker_num()].tasks++;
+    TRACE_BEGIN("play_game_task");
+    PERF_BEGIN(search_region);
+    play_game_node(board, player, depth, rank);
+    PERF_END(search_region);
+    TRACE_END("play_game_task");
+}
 
-int main() {
+// --- Search Driver ---
+
+// Sums the per-thread blocks into 'totals'; outcomes come from the ranked set
+// in deterministic mode
+void merge_stats(void) {
+    memset(&totals, 0, sizeof(totals));
+    for(int t = 0; t < MAX_THREADS; ++t) {
+        totals.nodes += stats[t].nodes;
+        totals.terminals += stats[t].terminals;
+        totals.duplicates += stats[t].duplicates;
+        totals.pruned += stats[t].pruned;
+        totals.tasks += stats[t].tasks;
+        totals.x_wins += stats[t].x_wins;
+        totals.o_wins += stats[t].o_wins;
+        totals.draws += stats[t].draws;
+    }
+
+    if(deterministic) {
+        found_count = top_size;
+        for(int i = 0; i < top_size; ++i) {
+            int winner = key_winner[top_key[i]];
+            if(winner == X)
+                totals.x_wins++;
+            else if(winner == O)
+                totals.o_wins++;
+            else
+                totals.draws++;
+        }
+    }
+}
+
+// Root task on the ws runtime: the empty board, X to move
+static void search_root_ws(void *board) {
+    play_game_task(board, X, 0, 0);
+}
+
+// Resets shared state and runs one exploration, returns the elapsed seconds
+double run_search(int threads) {
     int root_board[9] = {0};
 
+    if(threads > MAX_THREADS)
+        threads = MAX_THREADS;
+
+    found_count = 0;
+    atomic_store(&stop_search, 0);
+
+    for(int t = 0; t < MAX_THREADS; ++t) {
+        char *trace = stats[t].trace;
+        size_t cap = stats[t].trace_cap;
+        memset(&stats[t], 0, sizeof(stats[t]));
+        stats[t].trace = trace;
+        stats[t].trace_cap = cap;
+    }
+
+    for(int k = 0; k < NUM_KEYS; ++k)
+        best_rank[k] = NO_RANK;
+    top_size = 0;
+    atomic_store(&rank_bound, NO_RANK);
+
+    if(task_runtime == TASK_RUNTIME_WS) {
+        // Workers are started outside the timed region, as libgomp's are after the first run
+        if(ws_pool && ws_pool->nworkers != threads) {
+            ws_pool_destroy(ws_pool);
+            ws_pool = NULL;
+        }
+        if(!ws_pool && !(ws_pool = ws_pool_create(threads))) {
+            perror("ws_pool_create");
+            exit(1);
+        }
+        ws_pool_reset_stats(ws_pool);
+    }
+
+    double t0 = omp_get_wtime();
+    if(task_runtime == TASK_RUNTIME_WS) {
+        ws_run(ws_pool, search_root_ws, root_board);
+    } else {
+        #pragma omp parallel num_threads(threads) shared(root_board) default(none)
+        {
+            #pragma omp single
+            {
+                // Begin the search from the empty board with player X starting
+                play_game_task(root_board, X, 0, 0);
+            }
+        }
+    }
+    double dt = omp_get_wtime() - t0;
+
+    merge_stats();
+    return dt;
+}
+
+// Exploration over cutoff depths, strategies and thread counts: the full tree
+// (no pruning), or the pruned search in deterministic mode. The last strategy
+// is the task strategy on the ws runtime, for a head-to-head with libgomp.
+void run_benchmark(void) {
+    static const char *names[] = { "task", "taskloop", "final", "ws-task" };
+    int max_threads = omp_get_max_threads();
+    int saved_runtime = task_runtime;
+    if(!deterministic)
+        target_count = 0;
+
+    printf("=== Benchmark: %s, nodes/sec ===\n", deterministic ? "deterministic pruned search" : "full tree");
+    printf("(steals and idle time are not observable under libgomp)\n");
+    printf("%-9s %6s %7s %12s %10s %14s %12s %9s %6s %10s\n", "strategy", "cutoff", "threads", "nodes", "seconds",
+           "nodes/sec", "tasks/sec", "steals", "idle%", "X/O/D");
+    for(int s = STRATEGY_TASK; s <= STRATEGY_FINAL + 1; ++s) {
+        task_runtime = s > STRATEGY_FINAL ? TASK_RUNTIME_WS : TASK_RUNTIME_OMP;
+        for(int cutoff = 0; cutoff <= 9; ++cutoff) {
+            for(int threads = 1; threads <= max_threads; threads *= 2) {
+                strategy = s > STRATEGY_FINAL ? STRATEGY_TASK : s;
+                cutoff_depth = cutoff;
+                double dt = run_search(threads);
+                long long nodes = totals.nodes;
+                char steals[24] = "-", idle[16] = "-";
+                if(task_runtime == TASK_RUNTIME_WS) {
+                    ws_stats_t ws;
+                    ws_pool_stats(ws_pool, &ws);
+                    snprintf(steals, sizeof(steals), "%lld", ws.steals);
+                    snprintf(idle, sizeof(idle), "%.1f", ws.run_s > 0 ? 100.0 * ws.idle_s / (ws.run_s * ws.workers) : 0.0);
+                }
+                printf("%-9s %6d %7d %12lld %10.4f %14.0f %12.0f %9s %6s %4d/%d/%d\n",
+                       names[s], cutoff, threads, nodes, dt, dt > 0 ? nodes / dt : 0.0,
+                       dt > 0 ? totals.tasks / dt : 0.0, steals, idle,
+                       totals.x_wins, totals.o_wins, totals.draws);
+            }
+        }
+    }
+    task_runtime = saved_runtime;
+}
+
+// --- Main Execution ---
+
+int main(int argc, char **argv) {
     omp_init_lock(&history_lock);
-    omp_set_nested(1); // Allow tasks to spawn more tasks
+    task_runtime = ws_select_runtime();
+
+    int bench = 0;
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--bench") == 0)
+            bench = 1;
+        else if(strcmp(argv[i], "--deterministic") == 0)
+            deterministic = 1;
+        else if(strcmp(argv[i], "--trace") == 0)
+            trace_enabled = 1;
+        else if(strcmp(argv[i], "taskloop") == 0)
+            strategy = STRATEGY_TASKLOOP;
+        else if(strcmp(argv[i], "final") == 0)
+            strategy = STRATEGY_FINAL;
+        else if(strcmp(argv[i], "task") == 0)
+            strategy = STRATEGY_TASK;
+        else
+            cutoff_depth = atoi(argv[i]);
+    }
+
+    if(bench) {
+        run_benchmark();
+        ws_pool_destroy(ws_pool);
+        omp_destroy_lock(&history_lock);
+        return 0;
+    }
+    if(task_runtime == TASK_RUNTIME_WS && strategy != STRATEGY_TASK) {
+        printf("The ws runtime supports the task strategy only; using it.\n");
+        strategy = STRATEGY_TASK;
+    }
 
     printf("=== Starting Parallel Tic-Tac-Toe Exploration ===\n");
     printf("Targeting %d unique (canonical) terminal games.\n", TARGET_COUNT);
+    printf("Sequential cutoff at depth %d.%s\n", cutoff_depth,
+           deterministic ? " Deterministic (lexicographic move order)." : "");
 
-    #pragma omp parallel
-    {
-        #pragma omp single
-        {
-            // Begin the search from the empty board with player X starting
-            play_game_task(root_board, X);
-        }
+    int threads = omp_get_max_threads();
+    double dt = run_search(threads);
+
+    // --- Buffered Trace (printed outside the search) ---
+    if(trace_enabled) {
+        for(int t = 0; t < MAX_THREADS; ++t)
+            if(stats[t].trace_len)
+                fwrite(stats[t].trace, 1, stats[t].trace_len, stdout);
     }
 
     // --- Final Results ---
     printf("\n=== Finished Exploration ===\n");
-    printf("Total Unique Canonical Games Found: %d\n", atomic_load(&found_count));
+    printf("Total Unique Canonical Games Found: %d\n", found_count);
     printf("----------------------------------------\n");
-    printf("X Wins: %d\n", atomic_load(&x_win_count));
-    printf("O Wins: %d\n", atomic_load(&o_win_count));
-    printf("Draws: %d\n", atomic_load(&draw_count));
+    printf("X Wins: %d\n", totals.x_wins);
+    printf("O Wins: %d\n", totals.o_wins);
+    printf("Draws: %d\n", totals.draws);
     printf("----------------------------------------\n");
+    printf("Boards visited: %lld (%.0f nodes/sec)\n",
+           totals.nodes, dt > 0 ? totals.nodes / dt : 0.0);
+    printf("Terminals: %lld  Duplicates: %lld  Pruned subtrees: %lld\n",
+           totals.terminals, totals.duplicates, totals.pruned);
+    printf("Tasks: %lld (%.0f tasks/sec) on %s\n", totals.tasks, dt > 0 ? totals.tasks / dt : 0.0,
+           task_runtime == TASK_RUNTIME_WS ? "the ws runtime" : "libgomp (steals and idle time not observable)");
+    if(task_runtime == TASK_RUNTIME_WS)
+        ws_pool_report(ws_pool, stdout);
+    for(int t = 0; t < threads && t < MAX_THREADS; ++t)
+        printf("  [Thread %d] nodes %lld  terminals %lld  duplicates %lld  pruned %lld\n",
+               t, stats[t].nodes, stats[t].terminals, stats[t].duplicates, stats[t].pruned);
+
+    if(deterministic) {
+        // The ranked set itself is reproducible, so list it for comparison across runs
+        for(int i = 0; i < top_size; ++i) {
+            int winner = key_winner[top_key[i]];
+            printf("#%-2d key %5d  moves %09llu  Winner: %c\n", i + 1, top_key[i],
+                   (unsigned long long)top_rank[i], winner==X?'X':winner==O?'O':'D');
+        }
+    }
 
-
-    if(atomic_load(&stop_search))
+    if(atomic_load(&stop_search) || atomic_load(&rank_bound) != NO_RANK)
         printf("Search successfully PRUNED early because the target count was reached.\n");
     else
         printf("Search completed fully.\n"); // Note: This should not happen if target=27
 
+    for(int t = 0; t < MAX_THREADS; ++t)
+        free(stats[t].trace);
+    ws_pool_destroy(ws_pool);
     omp_destroy_lock(&history_lock);
     return 0;
 }
\ No newline at end of file
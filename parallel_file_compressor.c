@@ -1,103 +1,1577 @@
+// parallel_file_compressor.c
+// RLE compressor with content-defined chunking and deduplication, for a single
+// file (.rle) or a whole directory tree (.rla archive).
+//
+// Chunk boundaries come from a gear rolling hash instead of fixed offsets, so
+// an insertion only changes the chunks around it and repeated regions split
+// into identical chunks. Each chunk gets a fingerprint; a chunk already seen
+// earlier in the input is written as a reference to it instead of being
+// compressed again.
+//
+// The input is one stream: the file, or every regular file of the tree
+// concatenated in path order. It is cut into units, the first level of
+// scheduling:
+//   - consecutive small files are packed into one unit of up to PACK_SIZE
+//     bytes, so a million 1 KiB files are a few hundred tasks, not a million
+//   - a large file starts a unit of its own and is split every UNIT_MAX_SIZE
+//     bytes, so one huge file still spreads over all cores
+// Units are processed BATCH_SIZE bytes at a time, which bounds memory however
+// large the tree is. Per batch (tasks, on libgomp or the ws runtime):
+//   1. unit tasks        read the unit, then spawn the second level inside it:
+//                        - cut candidates, one task per CDC_SEGMENT bytes; the
+//                          gear hash only depends on the last 64 bytes, so each
+//                          task warms up on the 64 bytes before its segment and
+//                          finds exactly the candidates a sequential scan would
+//                        - select cuts (sequential over the sparse candidates,
+//                          applying CDC_MIN_SIZE / CDC_MAX_SIZE)
+//                        - fingerprints and the CRC32C of every chunk, one task
+//                          per FP_GRAIN chunks, while the bytes are in cache
+//   2. dedup index       sequential, in stream order, across the whole stream:
+//                        the first occurrence is the literal one; matches in
+//                        the current batch are confirmed with memcmp
+//   3. compress/write    compress tasks for literal chunks; a match against an
+//                        earlier batch gets a verify task instead, which decodes
+//                        the literal's record back from the output and compares
+//                        (on a mismatch the chunk becomes a literal itself);
+//                        writer tasks chained on write_order so records come out
+//                        in order
+// Decompression (-d) keeps only the record index in memory: literal chunks are
+// decoded in parallel straight from the file (pread), checked against their
+// CRC32C and written at their offset (pwrite); a reference reads its bytes back
+// from the output once the literal it points to is written (task depend), then
+// checks the CRC32C of its own bytes.
+// Extraction (-x) reads only the central directory, then decodes every chunk it
+// needs independently (a reference re-reads its literal record), writing each
+// piece straight into the files the chunk overlaps.
+//
+// .rle layout (native byte order):
+//   rle_header_t, then per chunk a chunk_record_t followed by stored_len
+//   payload bytes (none for references)
+// .rla layout:
+//   archive_header_t, the same chunk records, then the central directory at
+//   dir_off: dir_chunk_t[chunks], dir_file_t[files], then the file names
+//   (sorted, '/'-separated, not NUL-terminated)
+//
+// Compile: gcc -O2 -fopenmp parallel_file_compressor.c -o parallel_file_compressor
+// Run:     ./parallel_file_compressor [-v] [input [output.rle]]    (default: demo input)
+//          ./parallel_file_compressor -d <input.rle> <output>
+//          ./parallel_file_compressor [-v] -a <dir> <archive.rla>
+//          ./parallel_file_compressor -l <archive.rla>
+//          ./parallel_file_compressor -x <archive.rla> <outdir> [path]   (all files, or one)
+//          TASK_RUNTIME=ws runs the task graph on ws_runtime.h instead of libgomp (or build
+//          with -DUSE_WS_RUNTIME); either way the run ends with a task count and rate, plus
+//          steals and idle time for ws (per worker with -v). -x uses 'omp for' on both.
+
+#define _GNU_SOURCE     // nftw()
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <limits.h>
+#include <ftw.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <omp.h>
+#include "crc32c.h"
+#include "fast_io.h"
+#include "perf_counters.h"
+#include "trace.h"
+#include "ws_runtime.h"
+
+// ---------------- Config ----------------
+#define CDC_MIN_SIZE 2048        // no cut before this many bytes
+#define CDC_MAX_SIZE 65536       // forced cut after this many bytes
+#define CDC_MASK_BITS 13         // candidate when the top bits are zero: ~8 KiB apart
+#define CDC_SEGMENT (1 << 20)    // bytes scanned per candidate task
+#define CDC_WINDOW 64            // bytes that influence the gear hash
+
+#define PACK_SIZE (4 << 20)      // files smaller than this are packed together, up to this size
+#define UNIT_MAX_SIZE (16 << 20) // larger files are split into units of this size
+#define BATCH_SIZE (128 << 20)   // input bytes in memory at once (plus up to 2x for RLE output)
+#define FP_GRAIN 64              // chunks per fingerprint task
+
+#define RLE_MAGIC "RLE3"
+#define ARCHIVE_MAGIC "RLA1"
+#define RECORD_LITERAL UINT32_MAX
+
+PERF_REGION(rle_region, "rle_compress");   // -DPERF_COUNTERS: hardware counters per thread
+
+typedef struct {
+    char magic[4];
+    uint32_t reserved;
+    uint64_t chunks;
+    uint64_t raw_size;
+} rle_header_t;
+
+typedef struct {
+    char magic[4];
+    uint32_t reserved;
+    uint64_t chunks;
+    uint64_t raw_size;
+    uint64_t files;
+    uint64_t dir_off;            // central directory position
+} archive_header_t;
+
+typedef struct {
+    uint32_t raw_len;
+    uint32_t stored_len;         // RLE payload bytes that follow (0 for a reference)
+    uint32_t ref;                // RECORD_LITERAL, or the earlier chunk with the same bytes
+    uint32_t crc;                // CRC32C of the raw_len decompressed bytes
+} chunk_record_t;
+
+typedef struct {
+    uint64_t rec_off;            // chunk_record_t position in the archive
+    uint64_t raw_off;            // position in the stream (raw_len runs to the next chunk)
+} dir_chunk_t;
+
+typedef struct {
+    uint64_t stream_off;         // the file is bytes [stream_off, stream_off + size)
+    uint64_t size;
+    uint64_t name_off;           // into the name block
+    uint32_t name_len;
+    uint32_t mode;               // permission bits
+} dir_file_t;
+
+typedef struct {
+    const unsigned char *p;      // bytes (while their batch is in memory)
+    size_t len;
+    uint64_t raw_off;            // position in the stream
+    uint64_t fp[2];              // 128-bit fingerprint
+    uint32_t ref;                // RECORD_LITERAL or index of the first identical chunk
+    uint32_t crc;                // CRC32C of the raw bytes (taken with the fingerprint)
+    uint64_t rec_off;            // where its record was written
+    char *comp;                  // compressed bytes (literal chunks, until written)
+    size_t complen;
+    double rle_s, crc_s;         // time spent compressing / checksumming it
+} chunk_t;
+
+typedef struct {
+    size_t *pos;
+    size_t count, cap;
+} cut_list_t;
+
+typedef struct {
+    char *path;                  // name in the archive (points into src)
+    char *src;                   // where it is read from
+    uint64_t size;
+    uint64_t stream_off;
+    uint32_t mode;
+} input_file_t;
+
+typedef struct {
+    uint64_t stream_off;         // the unit is bytes [stream_off, stream_off + size)
+    size_t size;
+    size_t first_file;           // first file overlapping it
+    unsigned char *data;
+    chunk_t *chunks;
+    long nchunks;
+} unit_t;
+
+typedef struct {
+    size_t *slot;                // chunk index + 1; 0 = empty
+    size_t cap, used;
+} dedup_index_t;
+
+typedef struct {
+    FILE *f;
+    uint64_t pos;                // bytes written so far
+    chunk_t *chunks;             // every chunk of the stream, in order
+    size_t nchunks, cap;
+    dedup_index_t index;
+    uint64_t raw_size, dup_bytes;
+    size_t literal, units, packs, batches;
+    double load_s, index_s, write_s, rle_s, crc_s;
+} stream_t;
+
+int verbose;
+atomic_int failed;
+char write_order;                // task dependence address: records in chunk order
+
+int task_runtime;                // TASK_RUNTIME_OMP or TASK_RUNTIME_WS ($TASK_RUNTIME)
+ws_pool_t *ws_pool;
+atomic_long omp_tasks;           // tasks run under libgomp (the ws runtime counts its own)
+double task_s;                   // wall time in task-parallel regions
 
-#define CHUNK_SIZE 64   // smaller chunk for testing
-#define MAX_CHUNKS 4    // fewer chunks for demonstration
+static inline int worker_num(void) {
+    return task_runtime == TASK_RUNTIME_WS ? ws_worker_id() : omp_get_thread_num();
+}
 
-// Simple RLE compression placeholder: returns new length
+// ---------------- RLE ----------------
+// (char, run) pairs; runs longer than 255 are split
 size_t rle_compress(const char *in, size_t inlen, char *out) {
     size_t oi = 0;
     for (size_t i = 0; i < inlen; ) {
         char c = in[i];
         size_t j = i;
-        while (j < inlen && in[j] == c) j++;
-        size_t run = j - i;
+        while (j < inlen && in[j] == c && j - i < 255) j++;
         out[oi++] = c;
-        out[oi++] = (char)(run > 255 ? 255 : run);
+        out[oi++] = (char)(j - i);
         i = j;
     }
     return oi;
 }
 
-int main(void) {
-    const char *infile = "demo_input.txt";
-    const char *outfile = "demo_output.rle";
+// Returns the decompressed length, or (size_t)-1 if it would exceed outcap
+size_t rle_decompress(const char *in, size_t inlen, char *out, size_t outcap) {
+    size_t oi = 0;
+    for (size_t i = 0; i + 1 < inlen; i += 2) {
+        size_t run = (unsigned char)in[i + 1];
+        if (run > outcap - oi)
+            return (size_t)-1;
+        memset(out + oi, in[i], run);
+        oi += run;
+    }
+    return oi;
+}
+
+// ---------------- Content-Defined Chunking ----------------
+static uint64_t gear[256];
+
+static inline uint64_t mix64(uint64_t z) {
+    z += 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static void gear_init(void) {
+    for (int i = 0; i < 256; ++i)
+        gear[i] = mix64((uint64_t)i * 0x2545f4914f6cdd1dull);
+}
 
-    // create small sample input
-    FILE *fin = fopen(infile, "w");
-    fprintf(fin, "AAAAABBBBCCCCDDDDDEEEE\nAABBCC\nAAAA\n");
-    fclose(fin);
+static int cut_push(cut_list_t *l, size_t pos) {
+    if (l->count == l->cap) {
+        size_t cap = l->cap ? l->cap * 2 : 64;
+        size_t *p = realloc(l->pos, cap * sizeof(*p));
+        if (!p)
+            return -1;
+        l->pos = p;
+        l->cap = cap;
+    }
+    l->pos[l->count++] = pos;
+    return 0;
+}
 
-    // buffers and lengths
-    char *bufs[MAX_CHUNKS];
-    char *compbufs[MAX_CHUNKS];
-    size_t buflen[MAX_CHUNKS];
-    size_t complen[MAX_CHUNKS];
-    for (int i = 0; i < MAX_CHUNKS; ++i) { bufs[i] = compbufs[i] = NULL; buflen[i] = complen[i] = 0; }
+// Boundaries b in (start, end] where the hash of the bytes before b has its top bits
+// clear (the top bits mix all 64 bytes of the window; low bits only the last few)
+static int cdc_candidates(const unsigned char *data, size_t start, size_t end, cut_list_t *out) {
+    const uint64_t mask = ~0ull << (64 - CDC_MASK_BITS);
+    uint64_t h = 0;
+    for (size_t i = start > CDC_WINDOW ? start - CDC_WINDOW : 0; i < start; ++i)
+        h = (h << 1) + gear[data[i]];   // warm-up: older bytes have shifted out
+    for (size_t i = start; i < end; ++i) {
+        h = (h << 1) + gear[data[i]];
+        if (!(h & mask) && cut_push(out, i + 1) != 0)
+            return -1;
+    }
+    return 0;
+}
 
-    int chunk_count = 0;
+typedef struct {
+    const unsigned char *data;
+    size_t n, s;
+    cut_list_t *seg;
+} segment_args_t;
 
-    fin = fopen(infile, "r");
-    if (!fin) { perror("open input"); return 1; }
+static void segment_task(void *p) {
+    segment_args_t *a = p;
+    TRACE_BEGIN("cdc segment");
+    size_t end = (a->s + 1) * CDC_SEGMENT < a->n ? (a->s + 1) * CDC_SEGMENT : a->n;
+    if (cdc_candidates(a->data, a->s * CDC_SEGMENT, end, &a->seg[a->s]) != 0)
+        atomic_store(&failed, 1);
+    TRACE_END("cdc segment");
+}
 
-    omp_set_dynamic(0);
+// Splits data (stream bytes from base on) into chunks; returns the chunk count or -1.
+// Spawns its segment tasks from the calling task.
+static long cdc_chunk(const unsigned char *data, size_t n, uint64_t base, chunk_t **chunks_out) {
+    size_t nseg = (n + CDC_SEGMENT - 1) / CDC_SEGMENT;
+    cut_list_t *seg = calloc(nseg ? nseg : 1, sizeof(*seg));
+    if (!seg)
+        return -1;
+
+    // 1. candidates, in parallel over segments
+    if (task_runtime == TASK_RUNTIME_WS) {
+        ws_frame_t fr;
+        ws_frame_init(&fr);
+        for (size_t s = 0; s < nseg; ++s) {
+            segment_args_t a = { data, n, s, seg };
+            ws_spawn(&fr, segment_task, &a, sizeof(a));
+        }
+        ws_sync(&fr);
+    } else {
+        #pragma omp taskgroup
+        {
+            for (size_t s = 0; s < nseg; ++s) {
+                #pragma omp task firstprivate(s)
+                {
+                    segment_args_t a = { data, n, s, seg };
+                    atomic_fetch_add_explicit(&omp_tasks, 1, memory_order_relaxed);
+                    segment_task(&a);
+                }
+            }
+        }
+    }
+
+    // 2. cuts: candidates in order, respecting the minimum and maximum chunk size
+    cut_list_t cuts = { 0 };
+    size_t last = 0;
+    for (size_t s = 0; s < nseg && !atomic_load(&failed); ++s) {
+        for (size_t k = 0; k < seg[s].count; ++k) {
+            size_t c = seg[s].pos[k];
+            while (c - last > CDC_MAX_SIZE) {
+                last += CDC_MAX_SIZE;
+                if (cut_push(&cuts, last) != 0)
+                    atomic_store(&failed, 1);
+            }
+            if (c - last >= CDC_MIN_SIZE) {
+                last = c;
+                if (cut_push(&cuts, last) != 0)
+                    atomic_store(&failed, 1);
+            }
+        }
+    }
+    for (size_t s = 0; s < nseg; ++s)
+        free(seg[s].pos);
+    free(seg);
+    while (!atomic_load(&failed) && n - last > CDC_MAX_SIZE) {
+        last += CDC_MAX_SIZE;
+        if (cut_push(&cuts, last) != 0)
+            atomic_store(&failed, 1);
+    }
+    if (!atomic_load(&failed) && n > last && cut_push(&cuts, n) != 0)
+        atomic_store(&failed, 1);
+
+    chunk_t *chunks = calloc(cuts.count ? cuts.count : 1, sizeof(*chunks));
+    if (atomic_load(&failed) || !chunks) {
+        free(cuts.pos);
+        free(chunks);
+        return -1;
+    }
+    size_t prev = 0;
+    for (size_t i = 0; i < cuts.count; ++i) {
+        chunks[i].p = data + prev;
+        chunks[i].len = cuts.pos[i] - prev;
+        chunks[i].raw_off = base + prev;
+        chunks[i].ref = RECORD_LITERAL;
+        prev = cuts.pos[i];
+    }
+    free(cuts.pos);
+    *chunks_out = chunks;
+    return (long)cuts.count;
+}
+
+// ---------------- Fingerprint Index ----------------
+// Two mixed 64-bit lanes. They select candidates only: a fingerprint is not
+// collision resistant, so every match is confirmed on the bytes (memcmp within
+// the batch, verify_task against the output for earlier batches).
+static void fingerprint(const unsigned char *p, size_t len, uint64_t fp[2]) {
+    uint64_t a = mix64(len), b = mix64(~(uint64_t)len), w;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        memcpy(&w, p + i, 8);
+        a = mix64(a ^ w);
+        b = mix64((b ^ w) * 0x9fb21c651e98df25ull);
+    }
+    w = 0;
+    memcpy(&w, p + i, len - i);
+    fp[0] = mix64(a ^ w);
+    fp[1] = mix64((b ^ w) * 0x9fb21c651e98df25ull);
+}
+
+static int dedup_grow(dedup_index_t *ix, const chunk_t *chunks) {
+    size_t cap = ix->cap ? ix->cap * 2 : 1024;
+    size_t *slot = calloc(cap, sizeof(*slot));
+    if (!slot)
+        return -1;
+    for (size_t k = 0; k < ix->cap; ++k) {
+        if (!ix->slot[k])
+            continue;
+        size_t h = chunks[ix->slot[k] - 1].fp[0] & (cap - 1);
+        while (slot[h])
+            h = (h + 1) & (cap - 1);
+        slot[h] = ix->slot[k];
+    }
+    free(ix->slot);
+    ix->slot = slot;
+    ix->cap = cap;
+    return 0;
+}
+
+// Marks chunk i as a duplicate if its bytes already appeared in an earlier chunk,
+// otherwise indexes it. Open addressing on the fingerprint; chunks from resident on
+// are still in memory, so matches among them are confirmed with memcmp. A match
+// below resident is only a candidate until verify_task has compared it.
+static int dedup_add(dedup_index_t *ix, chunk_t *chunks, size_t i, size_t resident) {
+    if (ix->used * 2 >= ix->cap && dedup_grow(ix, chunks) != 0)
+        return -1;
+    chunk_t *c = &chunks[i];
+    for (size_t h = c->fp[0] & (ix->cap - 1);; h = (h + 1) & (ix->cap - 1)) {
+        if (!ix->slot[h]) {
+            ix->slot[h] = i + 1;
+            ix->used++;
+            return 0;
+        }
+        size_t j = ix->slot[h] - 1;
+        chunk_t *o = &chunks[j];
+        if (o->fp[0] == c->fp[0] && o->fp[1] == c->fp[1] && o->len == c->len &&
+            (j < resident || !memcmp(o->p, c->p, c->len))) {
+            c->ref = (uint32_t)j;
+            return 0;
+        }
+    }
+}
+
+// ---------------- Units ----------------
+// Reads the unit's range of the stream from the files it overlaps
+static int unit_load(unit_t *u, const input_file_t *files, size_t nfiles) {
+    u->data = malloc(u->size ? u->size : 1);
+    if (!u->data)
+        return -1;
+    uint64_t pos = u->stream_off, end = u->stream_off + u->size;
+    for (size_t f = u->first_file; f < nfiles && pos < end; ++f) {
+        const input_file_t *in = &files[f];
+        if (in->stream_off + in->size <= pos)
+            continue;   // empty file
+        uint64_t stop = in->stream_off + in->size < end ? in->stream_off + in->size : end;
+        size_t take = (size_t)(stop - pos);
+        FILE *fin = fopen(in->src, "rb");
+        if (!fin) {
+            perror(in->src);
+            return -1;
+        }
+        int ok = fseeko(fin, (off_t)(pos - in->stream_off), SEEK_SET) == 0 &&
+                 fread(u->data + (pos - u->stream_off), 1, take, fin) == take;
+        fclose(fin);
+        if (!ok) {
+            fprintf(stderr, "%s: read failed or file shrank\n", in->src);
+            return -1;
+        }
+        pos = stop;
+    }
+    return 0;
+}
+
+static int unit_push(unit_t **v, size_t *count, size_t *cap, uint64_t off, uint64_t size, size_t first) {
+    if (!size)
+        return 0;
+    if (*count == *cap) {
+        size_t ncap = *cap ? *cap * 2 : 64;
+        unit_t *p = realloc(*v, ncap * sizeof(*p));
+        if (!p)
+            return -1;
+        *v = p;
+        *cap = ncap;
+    }
+    (*v)[(*count)++] = (unit_t){ .stream_off = off, .size = (size_t)size, .first_file = first };
+    return 0;
+}
+
+// Small files are packed up to PACK_SIZE; a large file gets units of its own, so
+// identical large files dedup completely whatever precedes them
+static unit_t *plan_units(const input_file_t *files, size_t nfiles, size_t *nunits, size_t *npacks) {
+    unit_t *v = NULL;
+    size_t count = 0, cap = 0, packs = 0, pack_first = 0;
+    uint64_t pack_start = 0, end = 0;
+    int pack_open = 0, bad = 0;
+    for (size_t f = 0; f < nfiles && !bad; ++f) {
+        uint64_t s = files[f].stream_off, n = files[f].size;
+        end = s + n;
+        if (n < PACK_SIZE) {
+            if (pack_open && s + n - pack_start > PACK_SIZE) {
+                bad |= unit_push(&v, &count, &cap, pack_start, s - pack_start, pack_first);
+                packs += s > pack_start;
+                pack_open = 0;
+            }
+            if (!pack_open) {
+                pack_open = 1;
+                pack_start = s;
+                pack_first = f;
+            }
+            continue;
+        }
+        if (pack_open) {
+            bad |= unit_push(&v, &count, &cap, pack_start, s - pack_start, pack_first);
+            packs += s > pack_start;
+            pack_open = 0;
+        }
+        for (uint64_t o = 0; o < n && !bad; o += UNIT_MAX_SIZE)
+            bad |= unit_push(&v, &count, &cap, s + o, n - o < UNIT_MAX_SIZE ? n - o : UNIT_MAX_SIZE, f);
+    }
+    if (pack_open && !bad) {
+        bad |= unit_push(&v, &count, &cap, pack_start, end - pack_start, pack_first);
+        packs += end > pack_start;
+    }
+    if (bad) {
+        free(v);
+        return NULL;
+    }
+    *nunits = count;
+    *npacks = packs;
+    return v ? v : calloc(1, sizeof(*v));
+}
+
+// ---------------- Compress ----------------
+typedef struct {
+    stream_t *st;
+    size_t i;
+} chunk_args_t;
+
+// Compressor task body: literal chunks only
+static void compress_task(void *p) {
+    chunk_args_t *a = p;
+    chunk_t *c = &a->st->chunks[a->i];
+    TRACE_BEGIN("compress");
+    c->comp = malloc(c->len * 2);   // RLE worst case doubles
+    if (!c->comp) {
+        atomic_store(&failed, 1);
+    } else {
+        double ts = omp_get_wtime();
+        PERF_BEGIN(rle_region);
+        c->complen = rle_compress((const char *)c->p, c->len, c->comp);
+        PERF_END(rle_region);
+        c->rle_s = omp_get_wtime() - ts;
+    }
+    if (verbose)
+        printf("[compress] chunk %zu: %zu -> %zu bytes on thread %d\n",
+               a->i, c->len, c->complen, worker_num());
+    TRACE_COUNTER("compressed bytes", c->complen);
+    TRACE_END("compress");
+}
+
+// Verify task body: a match against a chunk of an earlier batch, which is no
+// longer in memory. Decodes the literal's record back from the output and compares;
+// if the bytes differ, the chunk is compressed as a literal instead.
+static void verify_task(void *p) {
+    chunk_args_t *a = p;
+    stream_t *st = a->st;
+    chunk_t *c = &st->chunks[a->i];
+    const chunk_t *lit = &st->chunks[c->ref];
+    TRACE_BEGIN("verify");
+    chunk_record_t rec;
+    char *payload = malloc(lit->complen ? lit->complen : 1), *raw = malloc(c->len);
+    int same = 0;
+    if (!payload || !raw ||
+        fio_pread_all(fileno(st->f), payload, lit->complen, (off_t)(lit->rec_off + sizeof(rec))) !=
+            (ssize_t)lit->complen) {
+        perror("verify duplicate");
+        atomic_store(&failed, 1);
+    } else {
+        same = rle_decompress(payload, lit->complen, raw, c->len) == c->len && !memcmp(raw, c->p, c->len);
+    }
+    free(payload);
+    free(raw);
+    TRACE_END("verify");
+    if (!same && !atomic_load(&failed)) {
+        if (verbose)
+            printf("[verify] chunk %zu: fingerprint matches chunk %u, bytes differ\n", a->i, c->ref);
+        c->ref = RECORD_LITERAL;
+        compress_task(p);
+    }
+}
+
+// Writer task body: every record, in chunk order
+static void write_task(void *p) {
+    chunk_args_t *a = p;
+    stream_t *st = a->st;
+    chunk_t *c = &st->chunks[a->i];
+    TRACE_BEGIN("writer");
+    chunk_record_t rec = { (uint32_t)c->len, (uint32_t)c->complen, c->ref, c->crc };
+    if (fwrite(&rec, sizeof(rec), 1, st->f) != 1 ||
+        (c->complen && fwrite(c->comp, 1, c->complen, st->f) != c->complen))
+        atomic_store(&failed, 1);
+    c->rec_off = st->pos;
+    st->pos += sizeof(rec) + c->complen;
+    st->rle_s += c->rle_s;
+    st->crc_s += c->crc_s;
+    if (c->ref == RECORD_LITERAL) {
+        st->literal++;
+    } else {
+        st->dup_bytes += c->len;
+        if (verbose)
+            printf("[writer] chunk %zu: duplicate of chunk %u\n", a->i, c->ref);
+    }
+    free(c->comp);
+    c->comp = NULL;
+    TRACE_END("writer");
+}
+
+// ws runtime: the same chain with task handles in place of 'depend'
+static void stream_write_ws(void *p) {
+    chunk_args_t *range = p;   // chunks from range->i on
+    stream_t *st = range->st;
+    ws_frame_t fr;
+    ws_frame_init(&fr);
+    ws_task_t *prev_writer = NULL;
+    for (size_t i = range->i; i < st->nchunks; ++i) {
+        chunk_args_t a = { st, i };
+        ws_task_t *comp = NULL;
+        if (st->chunks[i].ref == RECORD_LITERAL)
+            comp = ws_submit(&fr, compress_task, &a, sizeof(a), NULL, 0);
+        else if (st->chunks[i].ref < range->i)
+            comp = ws_submit(&fr, verify_task, &a, sizeof(a), NULL, 0);
+        ws_task_t *deps[2] = { comp, prev_writer };
+        ws_task_t *writer = ws_submit(&fr, write_task, &a, sizeof(a), deps, 2);
+        ws_release(comp);
+        ws_release(prev_writer);
+        prev_writer = writer;
+    }
+    ws_release(prev_writer);
+    ws_sync(&fr);
+}
+
+// Compress tasks for the literal chunks from first on, verify tasks for matches
+// against earlier batches, and writer tasks that emit every record in chunk order
+static void stream_write(stream_t *st, size_t first) {
+    if (fflush(st->f) != 0) {   // verify tasks read earlier records back
+        atomic_store(&failed, 1);
+        return;
+    }
+    if (task_runtime == TASK_RUNTIME_WS) {
+        chunk_args_t range = { st, first };
+        ws_run(ws_pool, stream_write_ws, &range);
+        return;
+    }
+    chunk_t *chunks = st->chunks;
+    size_t count = st->nchunks;
     #pragma omp parallel
     {
         #pragma omp single
         {
-            while (!feof(fin) && chunk_count < MAX_CHUNKS) {
-                bufs[chunk_count] = malloc(CHUNK_SIZE);
-                size_t rd = fread(bufs[chunk_count], 1, CHUNK_SIZE, fin);
-                buflen[chunk_count] = rd;
-
-                // reader task
-                #pragma omp task firstprivate(chunk_count) depend(out: bufs[chunk_count])
+            for (size_t i = first; i < count; ++i) {
+                chunk_args_t a = { st, i };
+                if (chunks[i].ref == RECORD_LITERAL) {
+                    #pragma omp task firstprivate(a) depend(out: chunks[i])
+                    {
+                        atomic_fetch_add_explicit(&omp_tasks, 1, memory_order_relaxed);
+                        compress_task(&a);
+                    }
+                } else if (chunks[i].ref < first) {
+                    #pragma omp task firstprivate(a) depend(out: chunks[i])
+                    {
+                        atomic_fetch_add_explicit(&omp_tasks, 1, memory_order_relaxed);
+                        verify_task(&a);
+                    }
+                }
+                #pragma omp task firstprivate(a) depend(in: chunks[i]) depend(inout: write_order)
                 {
-                    printf("[reader] chunk %d read (%zu bytes) on thread %d\n",
-                           chunk_count, buflen[chunk_count], omp_get_thread_num());
-                    printf("[reader] data: ");
-                    fwrite(bufs[chunk_count], 1, buflen[chunk_count], stdout);
-                    printf("\n");
+                    atomic_fetch_add_explicit(&omp_tasks, 1, memory_order_relaxed);
+                    write_task(&a);
                 }
+            }
+            #pragma omp taskwait
+        }
+    }
+}
+
+typedef struct {
+    unit_t *units;
+    size_t nunits;
+    const input_file_t *files;
+    size_t nfiles;
+} batch_t;
+
+typedef struct {
+    chunk_t *chunks;
+    long first, end;
+} fp_args_t;
+
+// Fingerprint and CRC32C of each chunk: every record carries the CRC of its own
+// bytes, duplicates included, so restore checks them all
+static void fingerprint_task(void *p) {
+    fp_args_t *a = p;
+    TRACE_BEGIN("fingerprint");
+    for (long i = a->first; i < a->end; ++i) {
+        chunk_t *c = &a->chunks[i];
+        fingerprint(c->p, c->len, c->fp);
+        double tc = omp_get_wtime();
+        c->crc = crc32c(0, c->p, c->len);   // input still hot
+        c->crc_s = omp_get_wtime() - tc;
+    }
+    TRACE_END("fingerprint");
+}
 
-                // compressor task
-                compbufs[chunk_count] = malloc(CHUNK_SIZE * 2);
-                #pragma omp task firstprivate(chunk_count) depend(in: bufs[chunk_count]) depend(out: compbufs[chunk_count])
+// Unit task body: read, chunk, then fingerprint the chunks FP_GRAIN at a time
+static void unit_task(const batch_t *b, size_t k) {
+    TRACE_BEGIN("unit");
+    unit_t *u = &b->units[k];
+    if (unit_load(u, b->files, b->nfiles) != 0 ||
+        (u->nchunks = cdc_chunk(u->data, u->size, u->stream_off, &u->chunks)) < 0) {
+        atomic_store(&failed, 1);
+    } else {
+        if (task_runtime == TASK_RUNTIME_WS) {
+            ws_frame_t fr;
+            ws_frame_init(&fr);
+            for (long i = 0; i < u->nchunks; i += FP_GRAIN) {
+                fp_args_t a = { u->chunks, i, i + FP_GRAIN < u->nchunks ? i + FP_GRAIN : u->nchunks };
+                ws_spawn(&fr, fingerprint_task, &a, sizeof(a));
+            }
+            ws_sync(&fr);
+        } else {
+            for (long i = 0; i < u->nchunks; i += FP_GRAIN) {
+                fp_args_t a = { u->chunks, i, i + FP_GRAIN < u->nchunks ? i + FP_GRAIN : u->nchunks };
+                #pragma omp task firstprivate(a)
                 {
-                    printf("[compress] chunk %d compressing on thread %d\n", chunk_count, omp_get_thread_num());
-                    complen[chunk_count] = rle_compress(bufs[chunk_count], buflen[chunk_count], compbufs[chunk_count]);
-                    printf("[compress] chunk %d compressed (%zu bytes): ", chunk_count, complen[chunk_count]);
-                    for (size_t i = 0; i < complen[chunk_count]; ++i) {
-                        printf("%c%u ", compbufs[chunk_count][i], (unsigned char)compbufs[chunk_count][++i]);
+                    atomic_fetch_add_explicit(&omp_tasks, 1, memory_order_relaxed);
+                    fingerprint_task(&a);
+                }
+            }
+            #pragma omp taskwait
+        }
+        if (verbose)
+            printf("[unit] %llu+%zu: %ld chunks on thread %d\n",
+                   (unsigned long long)u->stream_off, u->size, u->nchunks, worker_num());
+    }
+    TRACE_END("unit");
+}
+
+typedef struct {
+    const batch_t *b;
+    size_t k;
+} unit_args_t;
+
+static void unit_task_ws(void *p) {
+    unit_args_t *a = p;
+    unit_task(a->b, a->k);
+}
+
+static void batch_units_ws(void *p) {
+    const batch_t *b = p;
+    ws_frame_t fr;
+    ws_frame_init(&fr);
+    for (size_t k = 0; k < b->nunits; ++k) {
+        unit_args_t a = { b, k };
+        ws_spawn(&fr, unit_task_ws, &a, sizeof(a));
+    }
+    ws_sync(&fr);
+}
+
+static int stream_batch(stream_t *st, unit_t *units, size_t nunits, const input_file_t *files, size_t nfiles) {
+    double t0 = omp_get_wtime();
+
+    // 1. units in parallel; chunking and fingerprints in parallel inside each
+    batch_t b = { units, nunits, files, nfiles };
+    if (task_runtime == TASK_RUNTIME_WS) {
+        ws_run(ws_pool, batch_units_ws, &b);
+    } else {
+        #pragma omp parallel
+        {
+            #pragma omp single
+            {
+                for (size_t k = 0; k < nunits; ++k) {
+                    #pragma omp task firstprivate(k)
+                    {
+                        atomic_fetch_add_explicit(&omp_tasks, 1, memory_order_relaxed);
+                        unit_task(&b, k);
                     }
-                    printf("\n");
                 }
+            }
+        }
+    }
+    double t1 = omp_get_wtime();
 
-                // writer task
-                #pragma omp task firstprivate(chunk_count) depend(in: compbufs[chunk_count])
-                {
-                    printf("[writer] chunk %d writing on thread %d\n", chunk_count, omp_get_thread_num());
-                    FILE *fout = fopen(outfile, "ab");
-                    if (fout) {
-                        fwrite(&complen[chunk_count], sizeof(size_t), 1, fout);
-                        fwrite(compbufs[chunk_count], 1, complen[chunk_count], fout);
-                        fclose(fout);
-                        printf("[writer] chunk %d written (%zu bytes)\n", chunk_count, complen[chunk_count]);
-                    } else perror("writer open");
+    // 2. append in stream order and index
+    size_t first = st->nchunks;
+    for (size_t k = 0; k < nunits && !atomic_load(&failed); ++k) {
+        unit_t *u = &units[k];
+        if (st->nchunks + (size_t)u->nchunks >= RECORD_LITERAL) {
+            fprintf(stderr, "too many chunks\n");
+            atomic_store(&failed, 1);
+            break;
+        }
+        while (st->nchunks + (size_t)u->nchunks > st->cap) {
+            size_t cap = st->cap ? st->cap * 2 : 1024;
+            chunk_t *p = realloc(st->chunks, cap * sizeof(*p));
+            if (!p) {
+                atomic_store(&failed, 1);
+                break;
+            }
+            st->chunks = p;
+            st->cap = cap;
+        }
+        for (long i = 0; i < u->nchunks && !atomic_load(&failed); ++i) {
+            st->chunks[st->nchunks] = u->chunks[i];
+            if (dedup_add(&st->index, st->chunks, st->nchunks, first) != 0)
+                atomic_store(&failed, 1);
+            st->nchunks++;
+        }
+    }
+    double t2 = omp_get_wtime();
+
+    // 3. compress and write
+    if (!atomic_load(&failed))
+        stream_write(st, first);
+    double t3 = omp_get_wtime();
+
+    for (size_t k = 0; k < nunits; ++k) {
+        st->raw_size += units[k].size;
+        free(units[k].chunks);
+        free(units[k].data);
+    }
+    st->batches++;
+    st->load_s += t1 - t0;
+    st->index_s += t2 - t1;
+    st->write_s += t3 - t2;
+    task_s += (t1 - t0) + (t3 - t2);
+    return atomic_load(&failed) ? -1 : 0;
+}
+
+// Chunks, dedups and writes the records of the concatenated files
+static int stream_compress(stream_t *st, const input_file_t *files, size_t nfiles) {
+    size_t nunits = 0;
+    unit_t *units = plan_units(files, nfiles, &nunits, &st->packs);
+    if (!units) {
+        perror("plan units");
+        return -1;
+    }
+    st->units = nunits;
+    int rc = 0;
+    for (size_t k = 0; k < nunits && rc == 0; ) {
+        size_t n = 1, bytes = units[k].size;
+        while (k + n < nunits && bytes + units[k + n].size <= BATCH_SIZE)
+            bytes += units[k + n++].size;
+        rc = stream_batch(st, units + k, n, files, nfiles);
+        k += n;
+    }
+    free(units);
+    return rc;
+}
+
+// Task count and rate over the task-parallel regions, plus what only the ws
+// runtime can observe
+static void runtime_report(void) {
+    if (task_runtime == TASK_RUNTIME_WS) {
+        ws_stats_t ws;
+        ws_pool_stats(ws_pool, &ws);
+        printf("Runtime    ws: %lld tasks in %.3f s (%.0f tasks/s), %lld steals (%lld failed), idle %.1f%% of %d workers\n",
+               ws.tasks, task_s, task_s > 0 ? ws.tasks / task_s : 0.0, ws.steals, ws.steal_fails,
+               ws.run_s > 0 ? 100.0 * ws.idle_s / (ws.run_s * ws.workers) : 0.0, ws.workers);
+        if (verbose)
+            ws_pool_report(ws_pool, stdout);
+    } else {
+        long tasks = atomic_load(&omp_tasks);
+        printf("Runtime    libgomp: %ld tasks in %.3f s (%.0f tasks/s); steals and idle time not observable\n",
+               tasks, task_s, task_s > 0 ? tasks / task_s : 0.0);
+    }
+}
+
+static void stream_report(const stream_t *st, size_t nfiles, const char *outfile) {
+    printf("Input      %llu bytes in %zu file%s -> %zu units (%zu packs of small files), %zu batches\n",
+           (unsigned long long)st->raw_size, nfiles, nfiles == 1 ? "" : "s", st->units, st->packs,
+           st->batches);
+    printf("Chunks     %zu (avg %.0f bytes)\n", st->nchunks,
+           st->nchunks ? (double)st->raw_size / st->nchunks : 0.0);
+    printf("Dedup      %zu literal, %zu duplicate (%llu bytes not recompressed)\n", st->literal,
+           st->nchunks - st->literal, (unsigned long long)st->dup_bytes);
+    printf("Output     %llu bytes (%.1f%%) -> %s\n", (unsigned long long)st->pos,
+           st->raw_size ? 100.0 * st->pos / st->raw_size : 0.0, outfile);
+    printf("Time       read+chunk+fingerprint %.3f s, index %.3f s, compress+write %.3f s (%d threads)\n",
+           st->load_s, st->index_s, st->write_s, omp_get_max_threads());
+    printf("Integrity  CRC32C (%s) per chunk: %.2f ms, %.1f%% on top of %.2f ms of RLE\n", crc32c_impl(),
+           st->crc_s * 1e3, st->rle_s > 0 ? 100.0 * st->crc_s / st->rle_s : 0.0, st->rle_s * 1e3);
+    runtime_report();
+}
+
+static int compress_file(const char *infile, const char *outfile) {
+    struct stat sb;
+    if (stat(infile, &sb) != 0) { perror("open input"); return 1; }
+    input_file_t in = { (char *)infile, (char *)infile, (uint64_t)sb.st_size, 0, sb.st_mode & 07777 };
+
+    FILE *fout = fopen(outfile, "w+b");   // read back by verify_task
+    if (!fout) { perror("open output"); return 1; }
+    rle_header_t hdr = { 0 };
+    memcpy(hdr.magic, RLE_MAGIC, 4);
+    if (fwrite(&hdr, sizeof(hdr), 1, fout) != 1)   // rewritten once the counts are known
+        atomic_store(&failed, 1);
+
+    stream_t st = { .f = fout, .pos = sizeof(hdr) };
+    int rc = stream_compress(&st, &in, 1);
+    hdr.chunks = st.nchunks;
+    hdr.raw_size = st.raw_size;
+    if (rc == 0 && (fseek(fout, 0, SEEK_SET) != 0 || fwrite(&hdr, sizeof(hdr), 1, fout) != 1))
+        rc = -1;
+    if (fclose(fout) != 0 || atomic_load(&failed))
+        rc = -1;
+    if (rc != 0)
+        perror("write output");
+    else
+        stream_report(&st, 1, outfile);
+    free(st.chunks);
+    free(st.index.slot);
+    return rc != 0;
+}
+
+// ---------------- Archive ----------------
+static struct {
+    input_file_t *v;
+    size_t count, cap;
+    size_t root_len;
+} walk;
+
+static int walk_visit(const char *fpath, const struct stat *sb, int type, struct FTW *ftw) {
+    (void)ftw;
+    if (type != FTW_F || !S_ISREG(sb->st_mode))
+        return 0;   // directories are implied by the names; links and devices are skipped
+    if (walk.count == walk.cap) {
+        size_t cap = walk.cap ? walk.cap * 2 : 1024;
+        input_file_t *p = realloc(walk.v, cap * sizeof(*p));
+        if (!p)
+            return -1;
+        walk.v = p;
+        walk.cap = cap;
+    }
+    input_file_t *f = &walk.v[walk.count];
+    if (!(f->src = strdup(fpath)))
+        return -1;
+    f->path = f->src + walk.root_len;
+    while (*f->path == '/')
+        f->path++;
+    f->size = (uint64_t)sb->st_size;
+    f->mode = sb->st_mode & 07777;
+    walk.count++;
+    return 0;
+}
+
+static int path_cmp(const void *a, const void *b) {
+    return strcmp(((const input_file_t *)a)->path, ((const input_file_t *)b)->path);
+}
+
+static int archive_dir(const char *dir, const char *outfile) {
+    struct stat sb;
+    if (stat(dir, &sb) != 0 || !S_ISDIR(sb.st_mode)) {
+        fprintf(stderr, "%s: not a directory\n", dir);
+        return 1;
+    }
+    double t0 = omp_get_wtime();
+    walk.root_len = strlen(dir);
+    if (nftw(dir, walk_visit, 64, FTW_PHYS) != 0) {
+        perror("walk directory");
+        return 1;
+    }
+    // path order: similar files end up next to each other, and -x can binary-search
+    qsort(walk.v, walk.count, sizeof(*walk.v), path_cmp);
+    uint64_t raw = 0;
+    for (size_t f = 0; f < walk.count; ++f) {
+        walk.v[f].stream_off = raw;
+        raw += walk.v[f].size;
+    }
+    double t1 = omp_get_wtime();
+
+    FILE *fout = fopen(outfile, "w+b");   // read back by verify_task
+    if (!fout) { perror("open output"); return 1; }
+    archive_header_t hdr = { 0 };
+    memcpy(hdr.magic, ARCHIVE_MAGIC, 4);
+    if (fwrite(&hdr, sizeof(hdr), 1, fout) != 1)   // rewritten once the directory is written
+        atomic_store(&failed, 1);
+
+    stream_t st = { .f = fout, .pos = sizeof(hdr) };
+    int rc = stream_compress(&st, walk.v, walk.count);
+
+    // central directory
+    uint64_t dir_bytes = 0;
+    if (rc == 0) {
+        hdr.chunks = st.nchunks;
+        hdr.raw_size = st.raw_size;
+        hdr.files = walk.count;
+        hdr.dir_off = st.pos;
+        for (size_t i = 0; i < st.nchunks && rc == 0; ++i) {
+            dir_chunk_t d = { st.chunks[i].rec_off, st.chunks[i].raw_off };
+            rc = fwrite(&d, sizeof(d), 1, fout) == 1 ? 0 : -1;
+        }
+        uint64_t name_off = 0;
+        for (size_t f = 0; f < walk.count && rc == 0; ++f) {
+            const input_file_t *in = &walk.v[f];
+            dir_file_t e = { in->stream_off, in->size, name_off, (uint32_t)strlen(in->path), in->mode };
+            name_off += e.name_len;
+            rc = fwrite(&e, sizeof(e), 1, fout) == 1 ? 0 : -1;
+        }
+        for (size_t f = 0; f < walk.count && rc == 0; ++f)
+            rc = fputs(walk.v[f].path, fout) >= 0 ? 0 : -1;
+        dir_bytes = st.nchunks * sizeof(dir_chunk_t) + walk.count * sizeof(dir_file_t) + name_off;
+        if (rc == 0 && (fseek(fout, 0, SEEK_SET) != 0 || fwrite(&hdr, sizeof(hdr), 1, fout) != 1))
+            rc = -1;
+    }
+    if (fclose(fout) != 0 || atomic_load(&failed))
+        rc = -1;
+    if (rc != 0) {
+        perror("write archive");
+    } else {
+        st.pos += dir_bytes;
+        printf("Walk       %zu files under %s in %.3f s\n", walk.count, dir, t1 - t0);
+        stream_report(&st, walk.count, outfile);
+        printf("Directory  %llu bytes at offset %llu\n", (unsigned long long)dir_bytes,
+               (unsigned long long)hdr.dir_off);
+    }
+    for (size_t f = 0; f < walk.count; ++f)
+        free(walk.v[f].src);
+    free(walk.v);
+    free(st.chunks);
+    free(st.index.slot);
+    return rc != 0;
+}
+
+// ---------------- Decompress ----------------
+// Memory stays bounded whatever the file size: only the record index is kept.
+// Each task preads its payload and pwrites its chunk at its offset in the output;
+// a reference reads its literal's bytes back from the output.
+typedef struct {
+    int in_fd, out_fd;
+    const chunk_record_t *rec;
+    const uint64_t *payload, *raw_off;
+    size_t nrec;
+    ws_task_t **lit;             // ws runtime: each literal's task, for its duplicates
+} restore_t;
+
+typedef struct {
+    restore_t *r;
+    size_t i;
+} restore_args_t;
+
+// Decodes a literal chunk, checks its CRC32C and writes it out
+static void decode_task(void *p) {
+    restore_args_t *a = p;
+    const restore_t *r = a->r;
+    const chunk_record_t *rec = &r->rec[a->i];
+    TRACE_BEGIN("decompress");
+    char *payload = malloc((size_t)rec->stored_len + rec->raw_len + 1);
+    if (!payload ||
+        fio_pread_all(r->in_fd, payload, rec->stored_len, (off_t)r->payload[a->i]) != (ssize_t)rec->stored_len) {
+        perror("read input");
+        atomic_store(&failed, 1);
+    } else {
+        char *raw = payload + rec->stored_len;
+        size_t len = rle_decompress(payload, rec->stored_len, raw, rec->raw_len);
+        if (len != rec->raw_len || crc32c(0, raw, len) != rec->crc) {
+            fprintf(stderr, "chunk %zu: checksum mismatch\n", a->i);
+            atomic_store(&failed, 1);
+        } else if (fio_pwrite_all(r->out_fd, raw, len, (off_t)r->raw_off[a->i]) != 0) {
+            perror("write output");
+            atomic_store(&failed, 1);
+        }
+    }
+    free(payload);
+    TRACE_END("decompress");
+}
+
+// Copies a duplicate from its literal (already written out) and checks the copy's CRC32C
+static void copy_task(void *p) {
+    restore_args_t *a = p;
+    const restore_t *r = a->r;
+    const chunk_record_t *rec = &r->rec[a->i];
+    TRACE_BEGIN("copy duplicate");
+    char *raw = malloc(rec->raw_len + 1);
+    if (!raw || fio_pread_all(r->out_fd, raw, rec->raw_len, (off_t)r->raw_off[rec->ref]) != (ssize_t)rec->raw_len) {
+        perror("read output");
+        atomic_store(&failed, 1);
+    } else if (crc32c(0, raw, rec->raw_len) != rec->crc) {
+        fprintf(stderr, "chunk %zu: checksum mismatch\n", a->i);
+        atomic_store(&failed, 1);
+    } else if (fio_pwrite_all(r->out_fd, raw, rec->raw_len, (off_t)r->raw_off[a->i]) != 0) {
+        perror("write output");
+        atomic_store(&failed, 1);
+    }
+    free(raw);
+    TRACE_END("copy duplicate");
+}
+
+static void restore_ws(void *p) {
+    restore_t *r = p;
+    ws_frame_t fr;
+    ws_frame_init(&fr);
+    for (size_t i = 0; i < r->nrec; ++i) {
+        restore_args_t a = { r, i };
+        if (r->rec[i].ref == RECORD_LITERAL)
+            r->lit[i] = ws_submit(&fr, decode_task, &a, sizeof(a), NULL, 0);
+        else
+            ws_release(ws_submit(&fr, copy_task, &a, sizeof(a), &r->lit[r->rec[i].ref], 1));
+    }
+    ws_sync(&fr);
+    for (size_t i = 0; i < r->nrec; ++i)
+        ws_release(r->lit[i]);
+}
+
+static int decompress_file(const char *infile, const char *outfile) {
+    struct stat sb;
+    int in_fd = open(infile, O_RDONLY);
+    if (in_fd < 0 || fstat(in_fd, &sb) != 0) {
+        perror("open input");
+        if (in_fd >= 0)
+            close(in_fd);
+        return 1;
+    }
+    uint64_t size = (uint64_t)sb.st_size;
+    rle_header_t hdr;
+    if (fio_pread_all(in_fd, (char *)&hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+        memcmp(hdr.magic, RLE_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s: not an %s file\n", infile, RLE_MAGIC);
+        close(in_fd);
+        return 1;
+    }
+
+    // Index the records (sequential: they are variable-length); payloads stay on disk
+    size_t nrec = hdr.chunks <= size / sizeof(chunk_record_t) ? (size_t)hdr.chunks : 0;
+    chunk_record_t *rec = malloc((nrec ? nrec : 1) * sizeof(*rec));
+    uint64_t *payload = malloc((nrec ? nrec : 1) * sizeof(*payload));
+    uint64_t *raw_off = malloc((nrec ? nrec : 1) * sizeof(*raw_off));
+    char *done = malloc(nrec ? nrec : 1);   // task dependence addresses
+    int bad = nrec != hdr.chunks || !rec || !payload || !raw_off || !done;
+    uint64_t pos = sizeof(hdr), raw = 0;
+    for (size_t i = 0; i < nrec && !bad; ++i) {
+        if (fio_pread_all(in_fd, (char *)&rec[i], sizeof(rec[i]), (off_t)pos) != (ssize_t)sizeof(rec[i])) {
+            bad = 1;
+            break;
+        }
+        payload[i] = pos + sizeof(chunk_record_t);
+        raw_off[i] = raw;
+        pos = payload[i] + rec[i].stored_len;
+        raw += rec[i].raw_len;
+        bad = pos > size || raw > hdr.raw_size || rec[i].raw_len > CDC_MAX_SIZE ||
+              rec[i].stored_len > 2 * CDC_MAX_SIZE ||
+              (rec[i].ref != RECORD_LITERAL && (rec[i].ref >= i || rec[rec[i].ref].ref != RECORD_LITERAL ||
+                                                rec[i].raw_len != rec[rec[i].ref].raw_len));
+    }
+    if (bad || raw != hdr.raw_size || pos != size) {
+        fprintf(stderr, "%s: truncated or corrupt\n", infile);
+        free(rec); free(payload); free(raw_off); free(done);
+        close(in_fd);
+        return 1;
+    }
+
+    // read back by copy_task; sized up front, every chunk lands at its offset
+    int out_fd = open(outfile, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0 || ftruncate(out_fd, (off_t)raw) != 0) {
+        perror("open output");
+        if (out_fd >= 0)
+            close(out_fd);
+        free(rec); free(payload); free(raw_off); free(done);
+        close(in_fd);
+        return 1;
+    }
+
+    restore_t r = { in_fd, out_fd, rec, payload, raw_off, nrec, NULL };
+    double t0 = omp_get_wtime();
+    if (task_runtime == TASK_RUNTIME_WS) {
+        if (!(r.lit = calloc(nrec ? nrec : 1, sizeof(*r.lit)))) {
+            perror("decompress");
+            atomic_store(&failed, 1);
+        } else {
+            ws_run(ws_pool, restore_ws, &r);
+        }
+        free(r.lit);
+    } else {
+        #pragma omp parallel
+        {
+            #pragma omp single
+            {
+                for (size_t i = 0; i < nrec; ++i) {
+                    restore_args_t a = { &r, i };
+                    if (rec[i].ref == RECORD_LITERAL) {
+                        #pragma omp task firstprivate(a) depend(out: done[i])
+                        {
+                            atomic_fetch_add_explicit(&omp_tasks, 1, memory_order_relaxed);
+                            decode_task(&a);
+                        }
+                    } else {
+                        uint32_t ref = rec[i].ref;
+                        #pragma omp task firstprivate(a) depend(in: done[ref])
+                        {
+                            atomic_fetch_add_explicit(&omp_tasks, 1, memory_order_relaxed);
+                            copy_task(&a);
+                        }
+                    }
                 }
+                #pragma omp taskwait
+            }
+        }
+    }
+    double t1 = omp_get_wtime();
+    task_s += t1 - t0;
+
+    int rc = 0;
+    if (close(out_fd) != 0 && !atomic_load(&failed)) {
+        perror("write output");
+        rc = 1;
+    }
+    if (atomic_load(&failed)) {
+        fprintf(stderr, "%s: corrupt chunk data\n", infile);
+        rc = 1;
+    }
+    if (rc != 0) {
+        unlink(outfile);   // no partially restored file
+    } else {
+        printf("Restored   %llu bytes from %zu chunks in %.3f s -> %s\n", (unsigned long long)raw, nrec, t1 - t0,
+               outfile);
+        runtime_report();
+    }
+    free(rec); free(payload); free(raw_off); free(done);
+    close(in_fd);
+    return rc;
+}
+
+// ---------------- Extract ----------------
+typedef struct {
+    int fd;
+    archive_header_t hdr;
+    char *dir;                   // the central directory, as read
+    const dir_chunk_t *chunk;
+    const dir_file_t *file;
+    const char *names;
+} archive_t;
+
+static size_t chunk_raw_len(const archive_t *a, size_t i) {
+    uint64_t end = i + 1 < a->hdr.chunks ? a->chunk[i + 1].raw_off : a->hdr.raw_size;
+    return (size_t)(end - a->chunk[i].raw_off);
+}
 
-                ++chunk_count;
+// Last chunk / file starting at or before off
+static size_t chunk_at(const archive_t *a, uint64_t off) {
+    size_t lo = 0, hi = a->hdr.chunks;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (a->chunk[mid].raw_off <= off) lo = mid; else hi = mid;
+    }
+    return lo;
+}
+
+static size_t file_at(const archive_t *a, uint64_t off) {
+    size_t lo = 0, hi = a->hdr.files;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (a->file[mid].stream_off <= off) lo = mid; else hi = mid;
+    }
+    return lo;
+}
+
+// Names are extracted below outdir only: no absolute paths, no ".." components
+static int name_ok(const char *name, uint32_t len) {
+    if (!len || len >= PATH_MAX / 2 || name[0] == '/' || memchr(name, 0, len))
+        return 0;
+    for (uint32_t i = 0; i < len; ) {
+        uint32_t j = i;
+        while (j < len && name[j] != '/')
+            j++;
+        if (j - i == 2 && name[i] == '.' && name[i + 1] == '.')
+            return 0;
+        i = j + 1;
+    }
+    return 1;
+}
+
+// Reads and checks the header and central directory; no chunk records are touched
+static int archive_open(archive_t *a, const char *path) {
+    memset(a, 0, sizeof(*a));
+    struct stat sb;
+    if ((a->fd = open(path, O_RDONLY)) < 0 || fstat(a->fd, &sb) != 0) {
+        perror(path);
+        if (a->fd >= 0)
+            close(a->fd);
+        return -1;
+    }
+    uint64_t size = (uint64_t)sb.st_size;
+    if (fio_pread_all(a->fd, (char *)&a->hdr, sizeof(a->hdr), 0) != (ssize_t)sizeof(a->hdr) ||
+        memcmp(a->hdr.magic, ARCHIVE_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s: not an %s archive\n", path, ARCHIVE_MAGIC);
+        close(a->fd);
+        return -1;
+    }
+    const archive_header_t *h = &a->hdr;
+    uint64_t dir_len = h->dir_off <= size ? size - h->dir_off : 0;
+    int bad = h->dir_off < sizeof(*h) || h->dir_off > size || h->chunks > dir_len / sizeof(dir_chunk_t) ||
+              h->files > dir_len / sizeof(dir_file_t) ||
+              h->chunks * sizeof(dir_chunk_t) + h->files * sizeof(dir_file_t) > dir_len;
+    if (!bad) {
+        a->dir = malloc(dir_len ? (size_t)dir_len : 1);
+        bad = !a->dir || fio_pread_all(a->fd, a->dir, (size_t)dir_len, (off_t)h->dir_off) != (ssize_t)dir_len;
+    }
+    if (!bad) {
+        a->chunk = (const dir_chunk_t *)a->dir;
+        a->file = (const dir_file_t *)(a->dir + h->chunks * sizeof(dir_chunk_t));
+        a->names = (const char *)(a->file + h->files);
+        uint64_t names_len = dir_len - (uint64_t)(a->names - a->dir);
+        for (uint64_t i = 0; i < h->chunks && !bad; ++i)
+            bad = a->chunk[i].rec_off + sizeof(chunk_record_t) > h->dir_off ||
+                  a->chunk[i].raw_off >= h->raw_size || (i && a->chunk[i].raw_off <= a->chunk[i - 1].raw_off) ||
+                  (!i && a->chunk[i].raw_off != 0);
+        // no chunk is longer than the cut limit: extraction decodes into CDC_MAX_SIZE buffers
+        for (uint64_t i = 0; i < h->chunks && !bad; ++i)
+            bad = chunk_raw_len(a, i) > CDC_MAX_SIZE;
+        for (uint64_t f = 0; f < h->files && !bad; ++f) {
+            const dir_file_t *e = &a->file[f];
+            bad = e->size > h->raw_size || e->stream_off > h->raw_size - e->size ||
+                  (f && e->stream_off != a->file[f - 1].stream_off + a->file[f - 1].size) ||
+                  e->name_off > names_len || e->name_len > names_len - e->name_off ||
+                  !name_ok(a->names + e->name_off, e->name_len);
+        }
+        bad = bad || (h->raw_size && !h->chunks);
+    }
+    if (bad) {
+        fprintf(stderr, "%s: truncated or corrupt directory\n", path);
+        free(a->dir);
+        close(a->fd);
+        return -1;
+    }
+    return 0;
+}
+
+static void archive_close(archive_t *a) {
+    free(a->dir);
+    close(a->fd);
+}
+
+static int out_path(char *buf, const char *outdir, const archive_t *a, size_t f) {
+    const dir_file_t *e = &a->file[f];
+    int n = snprintf(buf, PATH_MAX, "%s/%.*s", outdir, (int)e->name_len, a->names + e->name_off);
+    return n > 0 && n < PATH_MAX ? 0 : -1;
+}
+
+// mkdir -p of everything before the last '/'
+static int make_parents(char *path) {
+    for (char *p = strchr(path + 1, '/'); p; p = strchr(p + 1, '/')) {
+        *p = 0;
+        int rc = mkdir(path, 0755);
+        *p = '/';
+        if (rc != 0 && errno != EEXIST)
+            return -1;
+    }
+    return 0;
+}
+
+// Decodes chunk i (from its literal's record) and writes its bytes into the
+// selected files [f_first, f_end) it overlaps
+static int extract_chunk(const archive_t *a, size_t i, size_t f_first, size_t f_end, const char *outdir,
+                         char *raw, char *payload) {
+    uint64_t raw_off = a->chunk[i].raw_off;
+    size_t raw_len = chunk_raw_len(a, i), lit_index = i;
+    chunk_record_t rec, lit;
+    if (fio_pread_all(a->fd, (char *)&rec, sizeof(rec), (off_t)a->chunk[i].rec_off) != (ssize_t)sizeof(rec) ||
+        rec.raw_len != raw_len || rec.raw_len > CDC_MAX_SIZE)
+        return -1;
+    lit = rec;
+    if (rec.ref != RECORD_LITERAL) {
+        lit_index = rec.ref;
+        if (rec.ref >= i ||
+            fio_pread_all(a->fd, (char *)&lit, sizeof(lit), (off_t)a->chunk[lit_index].rec_off) !=
+                (ssize_t)sizeof(lit) ||
+            lit.ref != RECORD_LITERAL || lit.raw_len != rec.raw_len)
+            return -1;
+    }
+    if (lit.stored_len > 2 * CDC_MAX_SIZE ||
+        fio_pread_all(a->fd, payload, lit.stored_len, (off_t)(a->chunk[lit_index].rec_off + sizeof(lit))) !=
+            (ssize_t)lit.stored_len)
+        return -1;
+    TRACE_BEGIN("decompress");
+    size_t len = rle_decompress(payload, lit.stored_len, raw, raw_len);
+    int ok = len == raw_len && crc32c(0, raw, len) == rec.crc;   // this chunk's own CRC
+    TRACE_END("decompress");
+    if (!ok) {
+        fprintf(stderr, "chunk %zu: checksum mismatch\n", i);
+        return -1;
+    }
+
+    size_t f = file_at(a, raw_off);
+    for (f = f < f_first ? f_first : f; f < f_end && a->file[f].stream_off < raw_off + raw_len; ++f) {
+        uint64_t fs = a->file[f].stream_off, fe = fs + a->file[f].size;
+        if (fe <= raw_off)
+            continue;
+        uint64_t lo = fs > raw_off ? fs : raw_off, hi = fe < raw_off + raw_len ? fe : raw_off + raw_len;
+        char path[PATH_MAX];
+        int fd;
+        if (out_path(path, outdir, a, f) != 0 || (fd = open(path, O_WRONLY)) < 0) {
+            perror(path);
+            return -1;
+        }
+        int rc = fio_pwrite_all(fd, raw + (lo - raw_off), (size_t)(hi - lo), (off_t)(lo - fs));
+        if (close(fd) != 0 || rc != 0) {
+            perror(path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Extracts every file, or only the one named only, below outdir
+static int extract_archive(const char *infile, const char *outdir, const char *only) {
+    archive_t a;
+    if (archive_open(&a, infile) != 0)
+        return 1;
+    size_t f_first = 0, f_end = a.hdr.files;
+    if (only) {
+        // names are sorted: binary search
+        size_t lo = 0, hi = a.hdr.files, olen = strlen(only);
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            const dir_file_t *e = &a.file[mid];
+            size_t n = e->name_len < olen ? e->name_len : olen;
+            int c = memcmp(a.names + e->name_off, only, n);
+            if (c < 0 || (c == 0 && e->name_len < olen)) lo = mid + 1; else hi = mid;
+        }
+        if (lo == a.hdr.files || a.file[lo].name_len != olen || memcmp(a.names + a.file[lo].name_off, only, olen)) {
+            fprintf(stderr, "%s: no file named %s\n", infile, only);
+            archive_close(&a);
+            return 1;
+        }
+        f_first = lo;
+        f_end = lo + 1;
+    }
+    double t0 = omp_get_wtime();
+
+    // 1. create the selected files (empty ones have no chunks)
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (size_t f = f_first; f < f_end; ++f) {
+        char path[PATH_MAX];
+        int fd = -1;
+        if (out_path(path, outdir, &a, f) != 0 || make_parents(path) != 0 ||
+            (fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0 || close(fd) != 0) {
+            perror(path);
+            atomic_store(&failed, 1);
+        }
+    }
+
+    // 2. the chunks overlapping them, each decoded on its own
+    uint64_t lo = f_first < f_end ? a.file[f_first].stream_off : 0;
+    uint64_t hi = f_first < f_end ? a.file[f_end - 1].stream_off + a.file[f_end - 1].size : 0;
+    size_t c_first = hi > lo ? chunk_at(&a, lo) : 0;
+    size_t c_end = hi > lo ? chunk_at(&a, hi - 1) + 1 : 0;
+    if (!atomic_load(&failed)) {
+        #pragma omp parallel
+        {
+            char *raw = malloc(CDC_MAX_SIZE);
+            char *payload = malloc(2 * CDC_MAX_SIZE);
+            #pragma omp for schedule(dynamic, 16)
+            for (size_t i = c_first; i < c_end; ++i) {
+                if (!raw || !payload || extract_chunk(&a, i, f_first, f_end, outdir, raw, payload) != 0)
+                    atomic_store(&failed, 1);
             }
-            #pragma omp taskwait
+            free(raw);
+            free(payload);
         }
     }
 
-    // cleanup
-    for (int i = 0; i < chunk_count; ++i) { free(bufs[i]); free(compbufs[i]); }
-    fclose(fin);
+    // 3. permissions last, so read-only files could still be written
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (size_t f = f_first; f < f_end; ++f) {
+        char path[PATH_MAX];
+        if (out_path(path, outdir, &a, f) == 0 && a.file[f].mode)
+            chmod(path, a.file[f].mode & 07777);
+    }
+    double t1 = omp_get_wtime();
+
+    int rc = 0;
+    if (atomic_load(&failed)) {
+        fprintf(stderr, "%s: extraction failed\n", infile);
+        rc = 1;
+    } else {
+        printf("Extracted  %zu file%s, %llu bytes from %zu chunks in %.3f s -> %s\n", f_end - f_first,
+               f_end - f_first == 1 ? "" : "s", (unsigned long long)(hi - lo), c_end - c_first, t1 - t0, outdir);
+    }
+    archive_close(&a);
+    return rc;
+}
 
-    printf("\nPipeline finished. chunks=%d\n", chunk_count);
+static int list_archive(const char *infile) {
+    archive_t a;
+    if (archive_open(&a, infile) != 0)
+        return 1;
+    for (size_t f = 0; f < a.hdr.files; ++f)
+        printf("%12llu  %04o  %.*s\n", (unsigned long long)a.file[f].size, (unsigned)a.file[f].mode,
+               (int)a.file[f].name_len, a.names + a.file[f].name_off);
+    printf("%llu files, %llu bytes in %llu chunks\n", (unsigned long long)a.hdr.files,
+           (unsigned long long)a.hdr.raw_size, (unsigned long long)a.hdr.chunks);
+    archive_close(&a);
     return 0;
 }
+
+// ---------------- Demo Input ----------------
+// A "backup set": the same base blocks several times, with small edits that
+// shift everything after them (fixed-size chunking would lose sync there)
+static int make_demo_input(const char *path) {
+    static const char *lines[] = { "AAAAABBBBCCCCDDDDDEEEE\n", "AABBCC\n", "AAAA\n",
+                                   "timestamp,sensor,value\n", "id=%u status=ok\n" };
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return -1;
+    char *base = malloc(256 * 1024);
+    if (!base) {
+        fclose(f);
+        return -1;
+    }
+    size_t len = 0;
+    unsigned seed = 1;
+    while (len < 256 * 1024 - 64) {
+        unsigned k = (unsigned)rand_r(&seed) % 5;
+        len += (size_t)snprintf(base + len, 64, lines[k], (unsigned)rand_r(&seed) % 1000);
+    }
+    for (int copy = 0; copy < 4; ++copy) {
+        size_t edit = len / 5 * (size_t)(copy + 1);
+        fwrite(base, 1, edit, f);
+        fprintf(f, "edit %d\n", copy);
+        fwrite(base + edit, 1, len - edit, f);
+    }
+    free(base);
+    return fclose(f);
+}
+
+// ---------------- Main ----------------
+static int run(int argc, char **argv) {
+    int argi = 1;
+    if (argi < argc && !strcmp(argv[argi], "-v")) {
+        verbose = 1;
+        argi++;
+    }
+    gear_init();
+    omp_set_dynamic(0);
+    task_runtime = ws_select_runtime();
+    if (task_runtime == TASK_RUNTIME_WS && !(ws_pool = ws_pool_create(omp_get_max_threads()))) {
+        perror("ws_pool_create");
+        return 1;
+    }
+
+    if (argi < argc && !strcmp(argv[argi], "-d")) {
+        if (argc - argi < 3) {
+            fprintf(stderr, "Usage: %s -d <input.rle> <output>\n", argv[0]);
+            return 1;
+        }
+        return decompress_file(argv[argi + 1], argv[argi + 2]);
+    }
+    if (argi < argc && !strcmp(argv[argi], "-a")) {
+        if (argc - argi < 3) {
+            fprintf(stderr, "Usage: %s [-v] -a <dir> <archive.rla>\n", argv[0]);
+            return 1;
+        }
+        return archive_dir(argv[argi + 1], argv[argi + 2]);
+    }
+    if (argi < argc && !strcmp(argv[argi], "-l")) {
+        if (argc - argi < 2) {
+            fprintf(stderr, "Usage: %s -l <archive.rla>\n", argv[0]);
+            return 1;
+        }
+        return list_archive(argv[argi + 1]);
+    }
+    if (argi < argc && !strcmp(argv[argi], "-x")) {
+        if (argc - argi < 3) {
+            fprintf(stderr, "Usage: %s -x <archive.rla> <outdir> [path]\n", argv[0]);
+            return 1;
+        }
+        return extract_archive(argv[argi + 1], argv[argi + 2], argc - argi > 3 ? argv[argi + 3] : NULL);
+    }
+
+    const char *infile = argi < argc ? argv[argi] : "demo_input.txt";
+    const char *outfile = argi + 1 < argc ? argv[argi + 1] : "demo_output.rle";
+    if (argi >= argc && make_demo_input(infile) != 0) {
+        perror("create demo input");
+        return 1;
+    }
+    int rc = compress_file(infile, outfile);
+    if (rc == 0)
+        printf("\nPipeline finished.\n");
+    return rc;
+}
+
+int main(int argc, char **argv) {
+    int rc = run(argc, argv);
+    ws_pool_destroy(ws_pool);
+    return rc;
+}
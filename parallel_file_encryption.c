@@ -1,6 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <omp.h>
+#include "perf_counters.h"
+
+// Build with -DPERF_COUNTERS to get per-thread cycles/instructions/misses (perf_counters.h)
+PERF_REGION(encrypt_region, "encrypt (omp for)");
+PERF_REGION(decrypt_region, "decrypt (serial)");
 
 int main() {
     size_t N = 1000000;
@@ -12,12 +17,19 @@ int main() {
     // Initialize data
     for(size_t i=0;i<N;i++) data[i] = i%256;
 
-    #pragma omp parallel for
-    for(size_t i=0;i<N;i++)
-        encrypted[i] = data[i]^key;
+    #pragma omp parallel
+    {
+        PERF_BEGIN(encrypt_region);
+        #pragma omp for nowait
+        for(size_t i=0;i<N;i++)
+            encrypted[i] = data[i]^key;
+        PERF_END(encrypt_region);
+    }
 
+    PERF_BEGIN(decrypt_region);
     for(size_t i=0;i<N;i++)
         decrypted[i] = encrypted[i] ^ key;
+    PERF_END(decrypt_region);
     // Check
     printf("Original[0] = %x\n", data[0]);
     printf("Encrypted[0] = %x\n", encrypted[0]);
@@ -0,0 +1,560 @@
+// parallel_mnk_game.c
+// Generalized m,n,k-game engine (m x n board, k in a row) using OpenMP tasks.
+// Covers tic-tac-toe (3,3,3), 4x4 variants, gomoku-style 5x5 boards and
+// Connect-style boards where pieces drop to the lowest empty row (-g).
+//
+// Two modes:
+//   enum  - parallel enumeration of every game sequence (optionally depth-limited)
+//   solve - game-theoretic value via parallel alpha-beta:
+//             * Young Brothers Wait: the first move at a node is searched before
+//               its siblings are spawned as tasks that share the node's alpha
+//             * move ordering: winning move, hash move, then cells on most lines
+//             * iterative deepening (shallow results order the deeper passes)
+//             * shared lockless transposition table (key XOR data entries)
+//
+// Compile: gcc -O2 -fopenmp parallel_mnk_game.c -o parallel_mnk_game
+// Run:     ./parallel_mnk_game solve 4 4 4
+//          ./parallel_mnk_game enum 3 3 3
+//          ./parallel_mnk_game solve 6 7 4 -g     (Connect-style, gravity on)
+//
+// Options: -g        gravity (moves drop to the lowest empty cell in a column)
+//          -d DEPTH  enum: stop counting at DEPTH plies
+//          -t BITS   solve: transposition table size (2^BITS entries, default 22)
+//          -p DEPTH  minimum remaining depth at which a node is split into tasks
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <omp.h>
+#include <stdatomic.h>
+
+#define EMPTY 0
+#define X 1
+#define O 2
+
+#define MAX_CELLS 64
+#define MAX_LINES (4 * MAX_CELLS)
+#define MAX_THREADS 256
+
+// Scores are from the side to move. Heuristic values always stay below WIN_BOUND.
+#define WIN 1000000
+#define WIN_BOUND (WIN / 2)
+#define INF (WIN + 1)
+#define EVAL_MAX_SHIFT 20   // 1 << 20 > WIN_BOUND: longer runs saturate instead of overflowing
+
+// --- Game Parameters ---
+typedef struct {
+    int m, n, k;        // rows, columns, run length needed to win
+    int cells;          // m * n
+    int gravity;        // 1 = Connect-style moves
+} game_t;
+
+static game_t G;
+
+typedef struct {
+    signed char b[MAX_CELLS];
+    int moves;          // pieces on the board
+    int player;         // side to move
+    uint64_t hash;      // Zobrist hash of b[] and player
+} pos_t;
+
+static const int DIRS[4][2] = { {0,1}, {1,0}, {1,1}, {1,-1} };
+
+static uint64_t zobrist[MAX_CELLS][3];
+static uint64_t zobrist_side;
+
+static int lines[MAX_LINES][MAX_CELLS]; // every k-cell winning line
+static int line_count = 0;
+static int cell_order[MAX_CELLS];       // cells sorted by how many lines pass through them
+
+// --- Per-Thread Node Counters (padded to avoid false sharing) ---
+typedef struct {
+    long long nodes;
+    char pad[64 - sizeof(long long)];
+} thread_count_t;
+
+static thread_count_t node_count[MAX_THREADS];
+
+// --- Board Setup ---
+
+static uint64_t splitmix64(uint64_t *s) {
+    uint64_t z = (*s += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Builds the line table, Zobrist keys and the static move ordering for G
+void init_game(void) {
+    uint64_t seed = 0x1234567ULL;
+    for (int c = 0; c < G.cells; ++c) {
+        zobrist[c][EMPTY] = 0;
+        zobrist[c][X] = splitmix64(&seed);
+        zobrist[c][O] = splitmix64(&seed);
+    }
+    zobrist_side = splitmix64(&seed);
+
+    int through[MAX_CELLS] = {0};
+    line_count = 0;
+    for (int r = 0; r < G.m; ++r) {
+        for (int c = 0; c < G.n; ++c) {
+            for (int d = 0; d < 4; ++d) {
+                int er = r + (G.k - 1) * DIRS[d][0];
+                int ec = c + (G.k - 1) * DIRS[d][1];
+                if (er < 0 || er >= G.m || ec < 0 || ec >= G.n)
+                    continue;
+                for (int i = 0; i < G.k; ++i) {
+                    int cell = (r + i * DIRS[d][0]) * G.n + (c + i * DIRS[d][1]);
+                    lines[line_count][i] = cell;
+                    through[cell]++;
+                }
+                line_count++;
+            }
+        }
+    }
+
+    // Insertion sort: most lines first, ties broken towards the board centre
+    for (int i = 0; i < G.cells; ++i)
+        cell_order[i] = i;
+    for (int i = 1; i < G.cells; ++i) {
+        int c = cell_order[i], j = i - 1;
+        while (j >= 0 && through[cell_order[j]] < through[c])
+            cell_order[j + 1] = cell_order[j], --j;
+        cell_order[j + 1] = c;
+    }
+}
+
+static void init_pos(pos_t *p) {
+    memset(p->b, EMPTY, sizeof(p->b));
+    p->moves = 0;
+    p->player = X;
+    p->hash = 0;
+}
+
+static void make_move(pos_t *p, int cell) {
+    p->b[cell] = (signed char)p->player;
+    p->hash ^= zobrist[cell][p->player] ^ zobrist_side;
+    p->moves++;
+    p->player = p->player == X ? O : X;
+}
+
+// Checks if placing 'who' on 'cell' completes k in a row (only lines through cell)
+static int makes_line(const signed char *b, int cell, int who) {
+    int r = cell / G.n, c = cell % G.n;
+    for (int d = 0; d < 4; ++d) {
+        int run = 1;
+        for (int s = -1; s <= 1; s += 2) {
+            int rr = r + s * DIRS[d][0], cc = c + s * DIRS[d][1];
+            while (rr >= 0 && rr < G.m && cc >= 0 && cc < G.n && b[rr * G.n + cc] == who) {
+                ++run;
+                rr += s * DIRS[d][0];
+                cc += s * DIRS[d][1];
+            }
+        }
+        if (run >= G.k)
+            return 1;
+    }
+    return 0;
+}
+
+// Fills mv[] with legal moves in static order, returns the count
+static int gen_moves(const pos_t *p, int mv[MAX_CELLS]) {
+    int cnt = 0;
+    if (G.gravity) {
+        // Connect-style: one move per column, the lowest empty row (row m-1 is the bottom)
+        for (int i = 0; i < G.cells; ++i) {
+            int cell = cell_order[i];
+            int below = cell + G.n;
+            if (p->b[cell] == EMPTY && (below >= G.cells || p->b[below] != EMPTY))
+                mv[cnt++] = cell;
+        }
+    } else {
+        for (int i = 0; i < G.cells; ++i)
+            if (p->b[cell_order[i]] == EMPTY)
+                mv[cnt++] = cell_order[i];
+    }
+    return cnt;
+}
+
+// Horizon estimate: open lines weighted by how full they are, from side to move
+static int evaluate(const pos_t *p) {
+    int score = 0;
+    for (int l = 0; l < line_count; ++l) {
+        int nx = 0, no = 0;
+        for (int i = 0; i < G.k; ++i) {
+            int v = p->b[lines[l][i]];
+            nx += v == X;
+            no += v == O;
+        }
+        // 4^n per open line, capped: k can be as large as MAX_CELLS
+        if (nx && !no) score += 1 << (2 * nx < EVAL_MAX_SHIFT ? 2 * nx : EVAL_MAX_SHIFT);
+        else if (no && !nx) score -= 1 << (2 * no < EVAL_MAX_SHIFT ? 2 * no : EVAL_MAX_SHIFT);
+    }
+    if (score >= WIN_BOUND) score = WIN_BOUND - 1;
+    if (score <= -WIN_BOUND) score = -WIN_BOUND + 1;
+    return p->player == X ? score : -score;
+}
+
+// --- Shared Lockless Transposition Table ---
+// Each entry stores (key ^ data, data); a torn write fails the key check on probe.
+
+#define TT_EXACT 0
+#define TT_LOWER 1
+#define TT_UPPER 2
+#define DEPTH_EXACT 255   // subtree searched to the end of the game
+
+typedef struct {
+    _Atomic uint64_t check;
+    _Atomic uint64_t data;
+} tt_entry_t;
+
+static tt_entry_t *tt = NULL;
+static uint64_t tt_mask = 0;
+
+static uint64_t tt_pack(int score, int depth, int flag, int move) {
+    return (uint64_t)(uint32_t)score
+         | (uint64_t)(depth & 0xFF) << 32
+         | (uint64_t)(flag & 0x3) << 40
+         | (uint64_t)(move & 0xFF) << 48;
+}
+
+static void tt_store(uint64_t key, int score, int depth, int flag, int move) {
+    tt_entry_t *e = &tt[key & tt_mask];
+    uint64_t data = tt_pack(score, depth, flag, move);
+    atomic_store_explicit(&e->data, data, memory_order_relaxed);
+    atomic_store_explicit(&e->check, key ^ data, memory_order_relaxed);
+}
+
+// Returns 1 on hit and unpacks the entry
+static int tt_probe(uint64_t key, int *score, int *depth, int *flag, int *move) {
+    tt_entry_t *e = &tt[key & tt_mask];
+    uint64_t data = atomic_load_explicit(&e->data, memory_order_relaxed);
+    uint64_t check = atomic_load_explicit(&e->check, memory_order_relaxed);
+    if ((check ^ data) != key)
+        return 0;
+    *score = (int32_t)(uint32_t)(data & 0xFFFFFFFFu);
+    *depth = (int)(data >> 32 & 0xFF);
+    *flag = (int)(data >> 40 & 0x3);
+    *move = (int)(data >> 48 & 0xFF);
+    return 1;
+}
+
+// --- Parallel Alpha-Beta (Young Brothers Wait) ---
+
+// One split point: the node whose younger brothers run as tasks
+typedef struct split {
+    struct split *parent;
+    atomic_int stop;        // set on beta cutoff; aborts every task below
+    atomic_int alpha;       // best lower bound found so far, read by new tasks
+    omp_lock_t lock;        // protects best / best_move
+    int best, best_move;
+} split_t;
+
+static int split_min_depth = 4;  // don't split nodes with less remaining depth
+
+static int aborted(const split_t *sp) {
+    for (; sp; sp = sp->parent)
+        if (atomic_load_explicit(&sp->stop, memory_order_relaxed))
+            return 1;
+    return 0;
+}
+
+static int search(const pos_t *p, int depth, int alpha, int beta, split_t *sp);
+
+// Searches one child; a full board after the move is a draw
+static int search_child(const pos_t *p, int cell, int depth, int alpha, int beta, split_t *sp) {
+    pos_t c = *p;
+    make_move(&c, cell);
+    if (c.moves == G.cells)
+        return 0;
+    return -search(&c, depth - 1, -beta, -alpha, sp);
+}
+
+static int search(const pos_t *p, int depth, int alpha, int beta, split_t *sp) {
+    node_count[omp_get_thread_num()].nodes++;
+
+    if (aborted(sp))
+        return 0;
+    if (depth <= 0)
+        return evaluate(p);
+
+    int empties = G.cells - p->moves;
+    int alpha0 = alpha;
+    int hash_move = -1;
+    int ts, td, tf, tm;
+    if (tt_probe(p->hash, &ts, &td, &tf, &tm)) {
+        hash_move = tm;
+        if (td >= depth || td == DEPTH_EXACT) {
+            if (tf == TT_EXACT) return ts;
+            if (tf == TT_LOWER && ts > alpha) alpha = ts;
+            if (tf == TT_UPPER && ts < beta) beta = ts;
+            if (alpha >= beta) return ts;
+        }
+    }
+
+    int mv[MAX_CELLS];
+    int cnt = gen_moves(p, mv);
+
+    // Move ordering 1: an immediate win ends the search
+    for (int i = 0; i < cnt; ++i) {
+        if (makes_line(p->b, mv[i], p->player)) {
+            tt_store(p->hash, WIN, DEPTH_EXACT, TT_EXACT, mv[i]);
+            return WIN;
+        }
+    }
+
+    // Move ordering 2: hash move from a previous iteration goes first
+    for (int i = 1; i < cnt; ++i) {
+        if (mv[i] == hash_move) {
+            memmove(&mv[1], &mv[0], i * sizeof(int));
+            mv[0] = hash_move;
+            break;
+        }
+    }
+
+    // Eldest brother is searched sequentially
+    int best = search_child(p, mv[0], depth, alpha, beta, sp);
+    int best_move = mv[0];
+    if (best > alpha)
+        alpha = best;
+
+    if (alpha < beta && cnt > 1) {
+        if (depth >= split_min_depth) {
+            // Young brothers: spawn the rest as tasks sharing this node's alpha
+            split_t s;
+            s.parent = sp;
+            atomic_init(&s.stop, 0);
+            atomic_init(&s.alpha, alpha);
+            omp_init_lock(&s.lock);
+            s.best = best;
+            s.best_move = best_move;
+
+            for (int i = 1; i < cnt; ++i) {
+                int cell = mv[i];
+                #pragma omp task firstprivate(cell, depth, beta) shared(s) default(none) \
+                    firstprivate(p)
+                {
+                    if (!aborted(&s)) {
+                        int a = atomic_load_explicit(&s.alpha, memory_order_relaxed);
+                        int v = search_child(p, cell, depth, a, beta, &s);
+                        if (!aborted(&s)) {
+                            omp_set_lock(&s.lock);
+                            if (v > s.best) {
+                                s.best = v;
+                                s.best_move = cell;
+                                if (v > atomic_load(&s.alpha))
+                                    atomic_store(&s.alpha, v);
+                                if (v >= beta)
+                                    atomic_store(&s.stop, 1);  // cutoff: cancel siblings
+                            }
+                            omp_unset_lock(&s.lock);
+                        }
+                    }
+                }
+            }
+            #pragma omp taskwait
+
+            best = s.best;
+            best_move = s.best_move;
+            omp_destroy_lock(&s.lock);
+        } else {
+            for (int i = 1; i < cnt && alpha < beta; ++i) {
+                int v = search_child(p, mv[i], depth, alpha, beta, sp);
+                if (v > best) {
+                    best = v;
+                    best_move = mv[i];
+                    if (v > alpha)
+                        alpha = v;
+                }
+            }
+        }
+    }
+
+    // An aborted subtree returns garbage; never let it reach the table
+    if (aborted(sp))
+        return 0;
+
+    int flag = best <= alpha0 ? TT_UPPER : best >= beta ? TT_LOWER : TT_EXACT;
+    tt_store(p->hash, best, depth >= empties ? DEPTH_EXACT : depth, flag, best_move);
+    return best;
+}
+
+static long long total_nodes(void) {
+    long long sum = 0;
+    for (int i = 0; i < MAX_THREADS; ++i)
+        sum += node_count[i].nodes;
+    return sum;
+}
+
+static void print_move(int cell) {
+    printf("(row %d, col %d)", cell / G.n, cell % G.n);
+}
+
+// Iterative deepening driver; stops early once a forced win/loss is proven
+void solve(int tt_bits) {
+    tt = calloc((size_t)1 << tt_bits, sizeof(tt_entry_t));
+    if (!tt) { perror("tt alloc"); exit(1); }
+    tt_mask = ((uint64_t)1 << tt_bits) - 1;
+
+    pos_t root;
+    init_pos(&root);
+
+    int value = 0;
+    double t0 = omp_get_wtime();
+
+    for (int depth = 1; depth <= G.cells; ++depth) {
+        #pragma omp parallel shared(root, value, depth) default(none)
+        {
+            #pragma omp single
+            value = search(&root, depth, -INF, INF, NULL);
+        }
+
+        int ts, td, tf, tm = -1;
+        tt_probe(root.hash, &ts, &td, &tf, &tm);
+        double dt = omp_get_wtime() - t0;
+        printf("depth %2d  value %8d  best ", depth, value);
+        if (tm >= 0 && tm < G.cells)   // the root entry may have been overwritten
+            print_move(tm);
+        else
+            printf("(unknown)");
+        printf("  nodes %lld  %.2fs  (%.0f nodes/s)\n",
+               total_nodes(), dt, dt > 0 ? total_nodes() / dt : 0.0);
+
+        if (value >= WIN_BOUND || value <= -WIN_BOUND)
+            break;
+    }
+
+    printf("\n=== Game Value (%d x %d, k=%d%s) ===\n", G.m, G.n, G.k, G.gravity ? ", gravity" : "");
+    if (value >= WIN_BOUND) printf("First player (X) wins.\n");
+    else if (value <= -WIN_BOUND) printf("Second player (O) wins.\n");
+    else printf("Draw with perfect play.\n");
+
+    free(tt);
+}
+
+// --- Parallel Enumeration ---
+
+static long long x_wins = 0, o_wins = 0, draws = 0, cut = 0;
+static int enum_task_depth = 4;   // plies near the root that become tasks
+
+static void enumerate_seq(const pos_t *p, int depth_left, long long cnt[4]) {
+    int mv[MAX_CELLS];
+    int n = gen_moves(p, mv);
+    for (int i = 0; i < n; ++i) {
+        if (makes_line(p->b, mv[i], p->player)) {
+            cnt[p->player == X ? 0 : 1]++;
+            continue;
+        }
+        pos_t c = *p;
+        make_move(&c, mv[i]);
+        if (c.moves == G.cells) cnt[2]++;
+        else if (depth_left <= 1) cnt[3]++;
+        else enumerate_seq(&c, depth_left - 1, cnt);
+    }
+}
+
+static void enumerate_task(const pos_t *p, int depth_left) {
+    if (p->moves >= enum_task_depth || depth_left <= 1) {
+        long long cnt[4] = {0};
+        enumerate_seq(p, depth_left, cnt);
+        #pragma omp atomic
+        x_wins += cnt[0];
+        #pragma omp atomic
+        o_wins += cnt[1];
+        #pragma omp atomic
+        draws += cnt[2];
+        #pragma omp atomic
+        cut += cnt[3];
+        return;
+    }
+
+    int mv[MAX_CELLS];
+    int n = gen_moves(p, mv);
+    for (int i = 0; i < n; ++i) {
+        if (makes_line(p->b, mv[i], p->player)) {
+            if (p->player == X) {
+                #pragma omp atomic
+                x_wins++;
+            } else {
+                #pragma omp atomic
+                o_wins++;
+            }
+            continue;
+        }
+        pos_t c = *p;
+        make_move(&c, mv[i]);
+        if (c.moves == G.cells) {
+            #pragma omp atomic
+            draws++;
+            continue;
+        }
+        #pragma omp task firstprivate(c, depth_left) default(none)
+        enumerate_task(&c, depth_left - 1);
+    }
+    #pragma omp taskwait
+}
+
+void enumerate(int max_depth) {
+    pos_t root;
+    init_pos(&root);
+    double t0 = omp_get_wtime();
+
+    #pragma omp parallel shared(root, max_depth) default(none)
+    {
+        #pragma omp single
+        enumerate_task(&root, max_depth);
+    }
+
+    double dt = omp_get_wtime() - t0;
+    printf("=== Enumeration (%d x %d, k=%d%s, depth %d) ===\n",
+           G.m, G.n, G.k, G.gravity ? ", gravity" : "", max_depth);
+    printf("X Wins: %lld\n", x_wins);
+    printf("O Wins: %lld\n", o_wins);
+    printf("Draws: %lld\n", draws);
+    if (cut)
+        printf("Unfinished at depth limit: %lld\n", cut);
+    printf("Total: %lld games in %.2fs\n", x_wins + o_wins + draws + cut, dt);
+}
+
+// --- Main Execution ---
+
+int main(int argc, char **argv) {
+    const char *mode = argc > 1 ? argv[1] : "solve";
+    G.m = 3; G.n = 3; G.k = 3; G.gravity = 0;
+    int max_depth = -1, tt_bits = 22;
+
+    int pos_arg = 0;
+    for (int i = 2; i < argc; ++i) {
+        if (!strcmp(argv[i], "-g")) G.gravity = 1;
+        else if (!strcmp(argv[i], "-d") && i + 1 < argc) max_depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) tt_bits = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-p") && i + 1 < argc) split_min_depth = atoi(argv[++i]);
+        else if (pos_arg == 0) G.m = atoi(argv[i]), pos_arg++;
+        else if (pos_arg == 1) G.n = atoi(argv[i]), pos_arg++;
+        else if (pos_arg == 2) G.k = atoi(argv[i]), pos_arg++;
+    }
+
+    G.cells = G.m * G.n;
+    if (G.m < 1 || G.n < 1 || G.cells > MAX_CELLS || G.k < 1 || (G.k > G.m && G.k > G.n)) {
+        fprintf(stderr, "Invalid board %d x %d with k=%d (at most %d cells)\n", G.m, G.n, G.k, MAX_CELLS);
+        return 1;
+    }
+    if (tt_bits < 10 || tt_bits > 30) tt_bits = 22;
+    if (max_depth <= 0 || max_depth > G.cells) max_depth = G.cells;
+    if (omp_get_max_threads() > MAX_THREADS) omp_set_num_threads(MAX_THREADS);
+
+    init_game();
+    printf("=== m,n,k-game: %d x %d, k=%d%s, %d threads ===\n",
+           G.m, G.n, G.k, G.gravity ? ", gravity" : "", omp_get_max_threads());
+
+    if (!strcmp(mode, "enum"))
+        enumerate(max_depth);
+    else if (!strcmp(mode, "solve"))
+        solve(tt_bits);
+    else {
+        fprintf(stderr, "Usage: %s <solve|enum> [m n k] [-g] [-d depth] [-t bits] [-p depth]\n", argv[0]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,291 @@
+// perf_counters.h
+// Hardware performance counters around code regions, via perf_event_open.
+//
+// Each thread that enters a region opens (once) its own counter group:
+// cycles, instructions, last-level-cache misses and branch misses, counted in
+// user space only (so it works with perf_event_paranoid <= 2). PERF_BEGIN and
+// PERF_END read the group and add the difference to the thread's slot in the
+// region; nested entries of the same region on a thread (recursive tasks) are
+// counted once, by the outermost pair. At exit every region is reported per
+// thread and in total, with IPC, misses per 1000 instructions and a rough
+// verdict (compute-, memory- or branch-bound), to stderr or $PERF_COUNTERS_FILE.
+//
+// Where the counters cannot be opened (no PMU in a VM, stricter paranoid level)
+// the report says why and still shows calls and thread CPU time.
+//
+// Counting is compiled in only with -DPERF_COUNTERS; otherwise the macros
+// expand to nothing.
+//
+//   PERF_REGION(var, "name")   define a region (file scope)
+//   PERF_BEGIN(var) / PERF_END(var)   on the calling thread; inside an
+//                              'omp parallel' every thread brackets its own share
+//
+// Compile: gcc -O2 -fopenmp -DPERF_COUNTERS ...    Run: PERF_COUNTERS_FILE=perf.txt ./prog
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#ifdef PERF_COUNTERS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define PERF_MAX_THREADS 64       // slots per region; later threads are not measured
+#define PERF_NEVENTS 4
+
+// Verdict thresholds (per 1000 instructions / IPC)
+#define PERF_MEMORY_BOUND_LLC_PKI 5.0
+#define PERF_BRANCH_BOUND_MISS_PKI 10.0
+#define PERF_MEMORY_BOUND_IPC 1.0
+
+enum { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_LLC_MISSES, PERF_BRANCH_MISSES };
+
+static const char *const perf_event_names[PERF_NEVENTS] = { "cycles", "instructions", "LLC misses",
+                                                            "branch misses" };
+static const uint64_t perf_event_configs[PERF_NEVENTS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+typedef struct {
+    _Alignas(64) uint64_t count[PERF_NEVENTS];
+    uint64_t cpu_ns;              // CLOCK_THREAD_CPUTIME_ID inside the region
+    unsigned long calls;
+    long tid;
+    int depth;                    // nesting of this region on the owning thread
+
+    uint64_t start[PERF_NEVENTS]; // values at the outermost PERF_BEGIN
+    uint64_t start_cpu_ns;
+} perf_slot_t;
+
+typedef struct perf_region {
+    const char *name;
+    struct perf_region *next;
+    atomic_int registered;
+    perf_slot_t slot[PERF_MAX_THREADS];
+} perf_region_t;
+
+// One counter group per thread, opened on first use
+typedef struct {
+    int opened;
+    int leader;                   // group leader fd (-1: no counters on this thread)
+    int index[PERF_NEVENTS];      // position in the group read, -1 if not available
+    int nr;
+} perf_thread_t;
+
+static _Atomic(perf_region_t *) perf_regions;
+static atomic_int perf_next_thread;
+static atomic_int perf_open_errno;     // first failure, for the report
+static atomic_int perf_available;      // bit e: event e opened on some thread
+static pthread_once_t perf_once = PTHREAD_ONCE_INIT;
+static __thread perf_thread_t perf_local;
+static __thread int perf_thread_index = -1;
+
+static inline uint64_t perf_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int perf_open_event(uint64_t config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;      // user space only: allowed at perf_event_paranoid 2
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // pid 0, cpu -1: the calling thread, on whichever CPU it runs
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+static void perf_thread_open(perf_thread_t *t) {
+    t->opened = 1;
+    t->leader = -1;
+    t->nr = 0;
+    for (int e = 0; e < PERF_NEVENTS; ++e) {
+        t->index[e] = -1;
+        int fd = perf_open_event(perf_event_configs[e], t->leader);
+        if (fd < 0) {
+            int expected = 0;
+            atomic_compare_exchange_strong(&perf_open_errno, &expected, errno);
+            continue;
+        }
+        if (t->leader < 0)
+            t->leader = fd;
+        t->index[e] = t->nr++;
+        atomic_fetch_or(&perf_available, 1 << e);
+    }
+}
+
+// Current counter values (scaled if the group was multiplexed); 0 where unavailable
+static void perf_thread_read(perf_thread_t *t, uint64_t out[PERF_NEVENTS]) {
+    uint64_t buf[3 + PERF_NEVENTS];
+    memset(out, 0, sizeof(uint64_t) * PERF_NEVENTS);
+    if (t->leader < 0 || read(t->leader, buf, sizeof(buf)) < (ssize_t)((3 + t->nr) * sizeof(uint64_t)))
+        return;
+    double scale = buf[2] && buf[2] < buf[1] ? (double)buf[1] / (double)buf[2] : 1.0;
+    for (int e = 0; e < PERF_NEVENTS; ++e)
+        if (t->index[e] >= 0)
+            out[e] = (uint64_t)(buf[3 + t->index[e]] * scale);
+}
+
+static void perf_report(void);
+
+static void perf_start(void) {
+    atexit(perf_report);
+}
+
+static inline perf_slot_t *perf_slot(perf_region_t *r) {
+    if (perf_thread_index < 0)
+        perf_thread_index = atomic_fetch_add(&perf_next_thread, 1);
+    if (perf_thread_index >= PERF_MAX_THREADS)
+        return NULL;
+    if (!atomic_load_explicit(&r->registered, memory_order_acquire) && !atomic_exchange(&r->registered, 1)) {
+        pthread_once(&perf_once, perf_start);
+        r->next = atomic_load(&perf_regions);
+        while (!atomic_compare_exchange_weak(&perf_regions, &r->next, r))
+            ;
+    }
+    return &r->slot[perf_thread_index];
+}
+
+static inline void perf_region_begin(perf_region_t *r) {
+    perf_slot_t *s = perf_slot(r);
+    if (!s || s->depth++ > 0)
+        return;
+    if (!perf_local.opened)
+        perf_thread_open(&perf_local);
+    s->tid = syscall(SYS_gettid);
+    s->start_cpu_ns = perf_cpu_ns();
+    perf_thread_read(&perf_local, s->start);
+}
+
+static inline void perf_region_end(perf_region_t *r) {
+    perf_slot_t *s = perf_slot(r);
+    if (!s || --s->depth > 0)
+        return;
+    uint64_t now[PERF_NEVENTS];
+    perf_thread_read(&perf_local, now);
+    s->cpu_ns += perf_cpu_ns() - s->start_cpu_ns;
+    for (int e = 0; e < PERF_NEVENTS; ++e)
+        s->count[e] += now[e] - s->start[e];
+    s->calls++;
+}
+
+static void perf_print_row(FILE *f, const char *who, const perf_slot_t *s, int have) {
+    fprintf(f, "  %-10s %9lu %9.2f", who, s->calls, s->cpu_ns / 1e6);
+    if (have) {
+        for (int e = 0; e < PERF_NEVENTS; ++e) {
+            if (have & (1 << e))
+                fprintf(f, " %14llu", (unsigned long long)s->count[e]);
+            else
+                fprintf(f, " %14s", "n/a");
+        }
+        double ins = (double)s->count[PERF_INSTRUCTIONS];
+        int ok = (have & (1 << PERF_INSTRUCTIONS)) && ins > 0;
+        if (ok && (have & (1 << PERF_CYCLES)) && s->count[PERF_CYCLES])
+            fprintf(f, " %6.2f", ins / s->count[PERF_CYCLES]);
+        else
+            fprintf(f, " %6s", "n/a");
+        for (int e = PERF_LLC_MISSES; e <= PERF_BRANCH_MISSES; ++e) {
+            if (ok && (have & (1 << e)))
+                fprintf(f, " %8.2f", s->count[e] * 1000.0 / ins);
+            else
+                fprintf(f, " %8s", "n/a");
+        }
+    }
+    fprintf(f, "\n");
+}
+
+// Per-region, per-thread table (registered with atexit)
+static void perf_report(void) {
+    const char *path = getenv("PERF_COUNTERS_FILE");
+    FILE *f = path ? fopen(path, "w") : stderr;
+    if (!f) {
+        perror("perf_counters: cannot write report");
+        return;
+    }
+
+    int err = atomic_load(&perf_open_errno);
+    int have = atomic_load(&perf_available);
+    if (err) {
+        FILE *pf = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+        int paranoid = -99;
+        if (pf) {
+            if (fscanf(pf, "%d", &paranoid) != 1)
+                paranoid = -99;
+            fclose(pf);
+        }
+        fprintf(f, "perf_counters: some events unavailable (perf_event_open: %s; perf_event_paranoid=%d)%s\n",
+                strerror(err), paranoid, have ? "" : ", showing CPU time only");
+    }
+
+    for (perf_region_t *r = atomic_load(&perf_regions); r; r = r->next) {
+        fprintf(f, "=== perf: %s ===\n", r->name);
+        fprintf(f, "  %-10s %9s %9s", "thread", "calls", "cpu ms");
+        if (have) {
+            for (int e = 0; e < PERF_NEVENTS; ++e)
+                fprintf(f, " %14s", perf_event_names[e]);
+            fprintf(f, " %6s %8s %8s", "IPC", "LLC/kI", "brm/kI");
+        }
+        fprintf(f, "\n");
+
+        perf_slot_t total;
+        memset(&total, 0, sizeof(total));
+        for (int i = 0; i < PERF_MAX_THREADS; ++i) {
+            const perf_slot_t *s = &r->slot[i];
+            if (!s->calls)
+                continue;
+            char who[32];
+            snprintf(who, sizeof(who), "tid %ld", s->tid);
+            perf_print_row(f, who, s, have);
+            total.calls += s->calls;
+            total.cpu_ns += s->cpu_ns;
+            for (int e = 0; e < PERF_NEVENTS; ++e)
+                total.count[e] += s->count[e];
+        }
+        perf_print_row(f, "total", &total, have);
+
+        int all = (1 << PERF_NEVENTS) - 1;
+        if (have == all && total.count[PERF_INSTRUCTIONS]) {
+            double ins = (double)total.count[PERF_INSTRUCTIONS];
+            double ipc = total.count[PERF_CYCLES] ? ins / total.count[PERF_CYCLES] : 0.0;
+            double llc = total.count[PERF_LLC_MISSES] * 1000.0 / ins;
+            double brm = total.count[PERF_BRANCH_MISSES] * 1000.0 / ins;
+            const char *verdict = "compute-bound";
+            if (llc >= PERF_MEMORY_BOUND_LLC_PKI && ipc < PERF_MEMORY_BOUND_IPC)
+                verdict = "memory-bound";
+            else if (brm >= PERF_BRANCH_BOUND_MISS_PKI)
+                verdict = "branch-bound";
+            fprintf(f, "  -> %s (IPC %.2f, %.2f LLC misses and %.2f branch misses per 1000 instructions)\n",
+                    verdict, ipc, llc, brm);
+        }
+    }
+    if (f != stderr)
+        fclose(f);
+}
+
+#define PERF_REGION(var, label) static perf_region_t var = { .name = (label) }
+#define PERF_BEGIN(var)        perf_region_begin(&(var))
+#define PERF_END(var)          perf_region_end(&(var))
+
+#else // !PERF_COUNTERS: no code, no data
+
+#define PERF_REGION(var, label) struct perf_region_unused_##var
+#define PERF_BEGIN(var)        ((void)0)
+#define PERF_END(var)          ((void)0)
+
+#endif // PERF_COUNTERS
+
+#endif // PERF_COUNTERS_H
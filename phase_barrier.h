@@ -0,0 +1,172 @@
+// phase_barrier.h
+// Reusable thread barriers for phase-heavy loops, selectable at run time.
+//
+//   BARRIER_CENTRAL        sense-reversing counter: one atomic decrement per
+//                          thread, everyone spins on a shared sense word
+//   BARRIER_DISSEMINATION  ceil(log2 n) rounds; in round r thread i signals
+//                          thread (i + 2^r) % n and waits for (i - 2^r) % n
+//   BARRIER_TREE           tournament tree (fan-in 4): children report to their
+//                          parent, the root releases back down the same tree
+//   BARRIER_PTHREAD        pthread_barrier_t, for comparison
+//
+// Every flag is a monotonically increasing episode number, so the barrier can be
+// reused for any number of phases without re-initialisation. Waiters spin with
+// pause for a while and then fall back to sched_yield(), which keeps the spin
+// variants usable when there are more threads than cores.
+//
+// Usage:
+//   phase_barrier_t b;
+//   phase_barrier_init(&b, phase_barrier_parse("tree"), nthreads);
+//   phase_barrier_wait(&b, tid);      // tid in [0, nthreads), once per phase
+//   phase_barrier_destroy(&b);
+
+#ifndef PHASE_BARRIER_H
+#define PHASE_BARRIER_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define BARRIER_CENTRAL 0
+#define BARRIER_DISSEMINATION 1
+#define BARRIER_TREE 2
+#define BARRIER_PTHREAD 3
+
+#define BARRIER_MAX_ROUNDS 16   // dissemination rounds: up to 65536 threads
+#define BARRIER_TREE_ARITY 4
+#define BARRIER_SPIN 256        // pause rounds before yielding the CPU
+
+static const char *const phase_barrier_names[] = { "central", "dissemination", "tree", "pthread" };
+
+// Per-thread state, one cache line each
+typedef struct {
+    _Alignas(64) unsigned episode;                  // Barriers this thread has passed (owner only)
+    atomic_uint arrive;                             // Tree: subtree arrived for this episode
+    atomic_uint release;                            // Tree: parent released this episode
+    atomic_uint round_flag[BARRIER_MAX_ROUNDS];     // Dissemination: partner signalled round r
+} phase_barrier_node_t;
+
+typedef struct {
+    int kind;
+    int nthreads;
+    int rounds;                                     // Dissemination rounds
+    _Alignas(64) atomic_int count;                  // Central: threads still to arrive
+    _Alignas(64) atomic_uint sense;                 // Central: episode released so far
+    phase_barrier_node_t *nodes;
+    pthread_barrier_t pthread_barrier;
+} phase_barrier_t;
+
+static inline void phase_barrier_relax(int *spins) {
+    if (++*spins < BARRIER_SPIN) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        __asm__ __volatile__("yield");
+#endif
+    } else {
+        sched_yield();
+    }
+}
+
+// Spins until *flag reaches episode (wrap-safe)
+static inline void phase_barrier_await(atomic_uint *flag, unsigned episode) {
+    int spins = 0;
+    while ((int)(atomic_load_explicit(flag, memory_order_acquire) - episode) < 0)
+        phase_barrier_relax(&spins);
+}
+
+// Returns the BARRIER_* kind for a name, or -1 if unknown
+static inline int phase_barrier_parse(const char *name) {
+    for (int k = 0; k < (int)(sizeof(phase_barrier_names) / sizeof(phase_barrier_names[0])); ++k)
+        if (strcmp(name, phase_barrier_names[k]) == 0)
+            return k;
+    return -1;
+}
+
+// Returns 0 on success, -1 on a bad kind/thread count or allocation failure
+static inline int phase_barrier_init(phase_barrier_t *b, int kind, int nthreads) {
+    if (kind < BARRIER_CENTRAL || kind > BARRIER_PTHREAD || nthreads < 1)
+        return -1;
+    memset(b, 0, sizeof(*b));
+    b->kind = kind;
+    b->nthreads = nthreads;
+    while ((1 << b->rounds) < nthreads)
+        b->rounds++;
+    if (b->rounds > BARRIER_MAX_ROUNDS)
+        return -1;
+
+    atomic_init(&b->count, nthreads);
+    atomic_init(&b->sense, 0);
+    b->nodes = aligned_alloc(64, sizeof(phase_barrier_node_t) * (size_t)nthreads);
+    if (!b->nodes)
+        return -1;
+    memset(b->nodes, 0, sizeof(phase_barrier_node_t) * (size_t)nthreads);
+
+    if (kind == BARRIER_PTHREAD && pthread_barrier_init(&b->pthread_barrier, NULL, (unsigned)nthreads) != 0) {
+        free(b->nodes);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void phase_barrier_destroy(phase_barrier_t *b) {
+    if (b->kind == BARRIER_PTHREAD)
+        pthread_barrier_destroy(&b->pthread_barrier);
+    free(b->nodes);
+    b->nodes = NULL;
+}
+
+// Blocks until all nthreads threads called it for this phase.
+// Returns 1 in exactly one thread per phase (like PTHREAD_BARRIER_SERIAL_THREAD).
+static inline int phase_barrier_wait(phase_barrier_t *b, int tid) {
+    phase_barrier_node_t *me = &b->nodes[tid];
+    unsigned episode = ++me->episode;
+    int n = b->nthreads;
+
+    switch (b->kind) {
+    case BARRIER_CENTRAL:
+        if (atomic_fetch_sub_explicit(&b->count, 1, memory_order_acq_rel) == 1) {
+            // Last to arrive: re-arm, then flip the sense to release everyone
+            atomic_store_explicit(&b->count, n, memory_order_relaxed);
+            atomic_store_explicit(&b->sense, episode, memory_order_release);
+            return 1;
+        }
+        phase_barrier_await(&b->sense, episode);
+        return 0;
+
+    case BARRIER_DISSEMINATION:
+        for (int r = 0; r < b->rounds; ++r) {
+            int partner = (tid + (1 << r)) % n;
+            atomic_fetch_add_explicit(&b->nodes[partner].round_flag[r], 1, memory_order_release);
+            phase_barrier_await(&me->round_flag[r], episode);
+        }
+        return tid == 0;
+
+    case BARRIER_TREE: {
+        // Arrival: wait for every child subtree, then report to the parent
+        for (int c = 1; c <= BARRIER_TREE_ARITY; ++c) {
+            int child = tid * BARRIER_TREE_ARITY + c;
+            if (child < n)
+                phase_barrier_await(&b->nodes[child].arrive, episode);
+        }
+        if (tid != 0) {
+            atomic_store_explicit(&me->arrive, episode, memory_order_release);
+            phase_barrier_await(&me->release, episode);
+        }
+        // Wake-up: pass the release down to the children
+        for (int c = 1; c <= BARRIER_TREE_ARITY; ++c) {
+            int child = tid * BARRIER_TREE_ARITY + c;
+            if (child < n)
+                atomic_store_explicit(&b->nodes[child].release, episode, memory_order_release);
+        }
+        return tid == 0;
+    }
+
+    default:
+        return pthread_barrier_wait(&b->pthread_barrier) == PTHREAD_BARRIER_SERIAL_THREAD;
+    }
+}
+
+#endif // PHASE_BARRIER_H
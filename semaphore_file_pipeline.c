@@ -1,133 +1,216 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <time.h>
+#include <semaphore.h>
+
+// Three-stage pipeline: create -> produce -> consume.
+// Each stage hands work to the next through a semaphore-guarded queue, so the
+// consumer streams values while files are still being created and written.
+//
+// Compile: gcc -O2 -pthread semaphore_file_pipeline.c -o semaphore_file_pipeline
+// Run:     ./semaphore_file_pipeline [FILE_COUNT] [values_per_file] [--quiet]
+
+// ---------------- Config ----------------
+#define DEFAULT_FILE_COUNT 2
+#define DEFAULT_VALUES 3      // Random integers written per file
+#define QUEUE_CAPACITY 64     // Slots in each stage queue (backpressure)
+
+int file_count = DEFAULT_FILE_COUNT;
+int values_per_file = DEFAULT_VALUES;
+int quiet = 0;                // 1 = only print the summary (benchmark runs)
+
+// ---------------- Stage Queue ----------------
+// Bounded FIFO: 'slots' counts free entries, 'items' counts filled ones,
+// the mutex guards head/tail between several pushers/poppers.
+typedef struct {
+    int file;     // File index, or -1 = end of stream
+    int value;    // Produced value (produce -> consume queue only)
+    int last;     // 1 on the last value of a file
+} stage_item_t;
+
+typedef struct {
+    stage_item_t buf[QUEUE_CAPACITY];
+    int head, tail;
+    sem_t slots, items;
+    pthread_mutex_t lock;
+} stage_queue_t;
+
+static void queue_init(stage_queue_t *q) {
+    q->head = q->tail = 0;
+    sem_init(&q->slots, 0, QUEUE_CAPACITY);
+    sem_init(&q->items, 0, 0);
+    pthread_mutex_init(&q->lock, NULL);
+}
 
-#define FILE_COUNT 2  // Number of files to create
-
-// Array to hold the file names
-const char *filenames[FILE_COUNT];
-
-// Thread function to create files and store their names (thread 1)
-void *create(void *arg) {
-printf("Creating 2 files...\n");
-
-
-// Create two empty files by opening and closing them
-filenames[0] = "file1.txt";
-filenames[1] = "file2.txt";
-
-// Open the files for writing, this will create them if they do not exist
-FILE *file1 = fopen(filenames[0], "w");
-FILE *file2 = fopen(filenames[1], "w");
+static void queue_destroy(stage_queue_t *q) {
+    sem_destroy(&q->slots);
+    sem_destroy(&q->items);
+    pthread_mutex_destroy(&q->lock);
+}
 
-if (!file1 || !file2) {
-    perror("Failed to create files");
-    
+static void queue_push(stage_queue_t *q, stage_item_t item) {
+    sem_wait(&q->slots);            // Blocks while the next stage is behind
+    pthread_mutex_lock(&q->lock);
+    q->buf[q->tail] = item;
+    q->tail = (q->tail + 1) % QUEUE_CAPACITY;
+    pthread_mutex_unlock(&q->lock);
+    sem_post(&q->items);
 }
 
-// Close the files after creating them
-fclose(file1);
-fclose(file2);
+static stage_item_t queue_pop(stage_queue_t *q) {
+    sem_wait(&q->items);
+    pthread_mutex_lock(&q->lock);
+    stage_item_t item = q->buf[q->head];
+    q->head = (q->head + 1) % QUEUE_CAPACITY;
+    pthread_mutex_unlock(&q->lock);
+    sem_post(&q->slots);
+    return item;
+}
 
-// Print file names
-printf("Files created: %s, %s\\n", filenames[0], filenames[1]);
+stage_queue_t created_queue;    // create  -> produce: files ready to be written
+stage_queue_t produced_queue;   // produce -> consume: values as they are written
 
+// ---------------- Files ----------------
+char (*filenames)[32];          // "file1.txt", "file2.txt", ...
 
+// ---------------- Stats ----------------
+long values_consumed = 0;       // Written by the consumer only
+int files_consumed = 0;
 
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
 
+// ---------------- Stage 1: Create ----------------
+void *create(void *arg) {
+    if (!quiet)
+        printf("Creating %d files...\n", file_count);
+
+    for (int i = 0; i < file_count; i++) {
+        snprintf(filenames[i], sizeof(filenames[i]), "file%d.txt", i + 1);
+
+        // Opening for writing creates (or truncates) the file
+        FILE *file = fopen(filenames[i], "w");
+        if (!file) {
+            perror("Failed to create file");
+            continue;   // skip it; the later stages never see this index
+        }
+        fclose(file);
+
+        // Hand-off: this file may now be produced into
+        queue_push(&created_queue, (stage_item_t){ i, 0, 0 });
+    }
 
+    queue_push(&created_queue, (stage_item_t){ -1, 0, 0 });   // End of stream
+    pthread_exit(NULL);
 }
 
-// Thread function for the producer (thread 2)
+// ---------------- Stage 2: Produce ----------------
 void *producer(void *arg) {
-printf("Producer writing random integers to files:\n");
-
-
-srand(time(NULL));  // Seed for random number generation
-
-for (int i = 0; i< FILE_COUNT; i++) {
-    
-    FILE *file = fopen(filenames[i], "a");
-    if (!file) {
-        perror("Failed to open file for writing");
-        pthread_exit(NULL);
-    }
+    unsigned int seed = (unsigned int)time(NULL);  // Private seed (rand() is not thread-safe)
 
-    // Insert 3 random integers into the file (maximum of 3 lines)
-    for (int i = 0; i < 3; i++) {
-        int random_num = rand() % 100;  // Generate a random integer < 100
-        fprintf(file, "%d\n", random_num);  // Use correct newline
-    }
+    for (;;) {
+        stage_item_t job = queue_pop(&created_queue);
+        if (job.file < 0)
+            break;
 
-    fclose(file);  // Close the file after writing
-}
+        FILE *file = fopen(filenames[job.file], "a");
+        if (!file) {
+            perror("Failed to open file for writing");
+            continue;
+        }
 
-pthread_exit(NULL);
+        for (int v = 0; v < values_per_file; v++) {
+            int random_num = rand_r(&seed) % 100;   // Random integer < 100
+            fprintf(file, "%d\n", random_num);
 
+            // Hand-off: stream the value on to the consumer right away
+            queue_push(&produced_queue, (stage_item_t){ job.file, random_num, v == values_per_file - 1 });
+        }
 
+        fclose(file);
+    }
 
+    queue_push(&produced_queue, (stage_item_t){ -1, 0, 0 });  // End of stream
+    pthread_exit(NULL);
 }
 
-// Thread function for the consumer (thread 3)
+// ---------------- Stage 3: Consume ----------------
 void *consumer(void *arg) {
-printf("Consumer reading the files' contents:\n");
-
-for (int i = 0; i< FILE_COUNT; i++) {
-    // Open the file in read mode
-    FILE *file = fopen(filenames[i], "r");
-    if (!file) {
-        perror("Failed to open file for reading");
-        pthread_exit(NULL);
+    if (!quiet)
+        printf("Consumer streaming values as they are written:\n");
+
+    for (;;) {
+        stage_item_t item = queue_pop(&produced_queue);
+        if (item.file < 0)
+            break;
+
+        values_consumed++;
+        if (!quiet)
+            printf("%s: %d\n", filenames[item.file], item.value);
+        if (item.last)
+            files_consumed++;
     }
 
-    // Read and print the file contents
-    printf("Contents of %s:\\n", filenames[i]);
-    char line[100];
-
-    while (fgets(line, sizeof(line), file)) {
-        printf("%s", line);
-    }
-
-    fclose(file);  // Close the file after reading
+    pthread_exit(NULL);
 }
 
-pthread_exit(NULL);
-
+// ---------------- Main ----------------
+int main(int argc, char **argv) {
+    pthread_t create_thread, producer_thread, consumer_thread;
 
+    for (int i = 1, pos = 0; i < argc; i++) {
+        if (!strcmp(argv[i], "--quiet")) quiet = 1;
+        else if (pos++ == 0) file_count = atoi(argv[i]);
+        else values_per_file = atoi(argv[i]);
+    }
+    if (file_count < 1 || values_per_file < 1) {
+        fprintf(stderr, "Usage: %s [FILE_COUNT] [values_per_file] [--quiet]\n", argv[0]);
+        return 1;
+    }
 
-}
-
-int main() {
-pthread_t create_thread, producer_thread, consumer_thread;
+    filenames = calloc((size_t)file_count, sizeof(*filenames));
+    if (!filenames) {
+        perror("Failed to allocate file names");
+        return 1;
+    }
+    queue_init(&created_queue);
+    queue_init(&produced_queue);
 
+    double t0 = now_sec();
 
-// Create the file creation thread (thread 1)
-if (pthread_create(&create_thread, NULL, create, NULL) != 0) {
-    perror("Failed to create file creation thread");
-    return 1;
-}
+    // Start all three stages; the queues order them, not the start-up sequence
+    if (pthread_create(&create_thread, NULL, create, NULL) != 0) {
+        perror("Failed to create file creation thread");
+        return 1;
+    }
+    if (pthread_create(&producer_thread, NULL, producer, NULL) != 0) {
+        perror("Failed to create producer thread");
+        return 1;
+    }
+    if (pthread_create(&consumer_thread, NULL, consumer, NULL) != 0) {
+        perror("Failed to create consumer thread");
+        return 1;
+    }
 
+    // Wait for every stage before reporting (and before the process exits)
+    pthread_join(create_thread, NULL);
+    pthread_join(producer_thread, NULL);
+    pthread_join(consumer_thread, NULL);
 
+    double dt = now_sec() - t0;
+    printf("Pipeline: %d files, %ld values in %.4f s (%.0f files/s, %.0f values/s)\n",
+           files_consumed, values_consumed, dt, files_consumed / dt, values_consumed / dt);
 
-// Create the producer thread (thread 2)
-if (pthread_create(&producer_thread, NULL, producer, NULL) != 0) {
-    perror("Failed to create producer thread");
-    return 1;
-}
+    queue_destroy(&created_queue);
+    queue_destroy(&produced_queue);
+    free(filenames);
 
-// Create the consumer thread (thread 3)
-if (pthread_create(&consumer_thread, NULL, consumer, NULL) != 0) {
-    perror("Failed to create consumer thread");
-    return 1;
+    printf("Program completed successfully.\n");
+    return 0;
 }
-
-
-
-printf("Program completed successfully.\\n");
-return 0;
-
-
-
-}
\ No newline at end of file
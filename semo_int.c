@@ -1,14 +1,25 @@
+#define _GNU_SOURCE     // splice() in fast_io.h
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <time.h>
 #include <semaphore.h>  // For semaphores
+#include "committed_file.h"
+#include "fast_io.h"
+#include "lock_profile.h"
+
+#define NUM_READERS 3
+#define COMMIT_BATCH 5   // values appended + committed at once (readers see them together)
 
 const char *filename = "empty_file.txt";
 
-// Declare semaphore to protect file access
-sem_t file_semaphore;
+// Declare semaphore to serialize writers (readers never take it)
+prof_sem_t file_semaphore;
+
+// Writers append and publish the committed offset; readers pread up to it lock-free
+committed_file_t data_file;
 
 // Thread function to create the file
 void *create_file(void *arg) {
@@ -20,55 +31,67 @@ void *create_file(void *arg) {
 
 // Thread function for the producer
 void *producer(void *arg) {
-    printf("Producer writing random integers to the file using 'echo':\n");
+    printf("Producer writing random integers to the file:\n");
     srand(time(NULL)); // Seed random number generator
 
+    cf_batch_t batch = { .len = 0 };
     for (int i = 0; i < 10; i++) {
         int random_num = rand() % 100; // Generate random integer < 100
-        char command[100];
 
-        // Protect file access with semaphore
-        sem_wait(&file_semaphore);
+        // Collect COMMIT_BATCH values, then append them with one write and one commit
+        cf_batch_int(&batch, random_num);
+        if (batch.count < COMMIT_BATCH && i < 9)
+            continue;
 
-        // Construct the echo command
-        snprintf(command, sizeof(command), "echo %d >> %s", random_num, filename);
+        // Serialize writers with the semaphore; readers are not blocked
+        prof_sem_wait(&file_semaphore);
 
-        // Execute the echo command
-        if (system(command) != 0) {
+        // Append in-process (no shell, no fork), then publish the new committed offset
+        if (cf_append_batch(&data_file, &batch) != 0) {
             perror("Failed to append random number to file");
-            sem_post(&file_semaphore);
+            prof_sem_post(&file_semaphore);
             pthread_exit(NULL);
         }
 
-        sem_post(&file_semaphore);
+        prof_sem_post(&file_semaphore);
     }
 
     pthread_exit(NULL);
 }
 
-// Thread function for the consumer
-void *consumer(void *arg) {
-    printf("Consumer reading the file contents:\n");
-
-    // Protect file access with semaphore
-    sem_wait(&file_semaphore);
+// Thread function for the readers: stream the committed part of the file, lock-free.
+// Reader 0 echoes it to stdout; the others only count what they saw.
+void *reader(void *arg) {
+    int id = (int)(intptr_t)arg;
+    char buf[4096];
+    long long pos = 0, bytes = 0;
+    int values = 0;
+    ssize_t n;
+
+    if (id == 0) {
+        printf("Reader 0 streaming the file contents:\n");
+        fflush(stdout);
+    }
 
-    // Use the 'cat' command to display the file contents
-    if (system("cat empty_file.txt") != 0) {
-        perror("Failed to read the file contents");
-        sem_post(&file_semaphore);
-        pthread_exit(NULL);
+    while ((n = cf_read_wait(&data_file, &pos, buf, sizeof(buf))) > 0) {
+        bytes += n;
+        for (ssize_t i = 0; i < n; i++)
+            values += buf[i] == '\n';
+        if (id == 0)
+            fio_write_all(STDOUT_FILENO, buf, (size_t)n);
     }
+    if (n < 0)
+        perror("Failed to read the file contents");
 
-    sem_post(&file_semaphore);
+    printf("Reader %d streamed %lld bytes (%d values).\n", id, bytes, values);
     pthread_exit(NULL);
 }
 
 int main() {
-    pthread_t create_thread, producer_thread, consumer_thread;
+    pthread_t create_thread, producer_thread, reader_thread[NUM_READERS];
 
-    // Initialize semaphore with 1 (mutual exclusion)
-    sem_init(&file_semaphore, 0, 1);
+    // Initialize semaphore with 1 (mutual exclusion between writers)
+    prof_sem_init(&file_semaphore, "file_semaphore", 1);
 
     // Create the file creation thread
     if (pthread_create(&create_thread, NULL, create_file, NULL) != 0) { // Fixed function name
@@ -78,23 +101,34 @@ int main() {
 
     pthread_join(create_thread, NULL);
 
+    // Open the shared file once for the writer and the readers
+    if (cf_open(&data_file, filename) != 0)
+        return 1;
+
     // Create the producer thread
     if (pthread_create(&producer_thread, NULL, producer, NULL) != 0) {
         perror("Failed to create producer thread");
         return 1;
     }
 
-    // Create the consumer thread
-    if (pthread_create(&consumer_thread, NULL, consumer, NULL) != 0) {
-        perror("Failed to create consumer thread");
-        return 1;
+    // Create the reader threads (they stream while the producer writes)
+    for (int i = 0; i < NUM_READERS; i++) {
+        if (pthread_create(&reader_thread[i], NULL, reader, (void *)(intptr_t)i) != 0) {
+            perror("Failed to create reader thread");
+            return 1;
+        }
     }
 
+    // Producer done: readers drain the committed data and stop
     pthread_join(producer_thread, NULL);
-    pthread_join(consumer_thread, NULL);
+    cf_close_writers(&data_file);
+    for (int i = 0; i < NUM_READERS; i++)
+        pthread_join(reader_thread[i], NULL);
+
+    cf_close(&data_file);
 
     // Destroy the semaphore
-    sem_destroy(&file_semaphore);
+    prof_sem_destroy(&file_semaphore);
 
     printf("Program completed successfully.\n");
     return 0;
@@ -0,0 +1,107 @@
+// seqlock.h
+// Sequence lock for publishing a multi-field snapshot (statistics structs and
+// the like) that readers poll at high frequency.
+//
+// The sequence word is odd while a write is in progress. A reader copies the
+// struct and retries if the sequence was odd or changed meanwhile, so it always
+// ends up with a consistent copy without taking a lock and without ever blocking
+// the writer (writers cannot be starved by readers). Writers exclude each other
+// by CAS-ing the sequence from even to odd, so several producers may publish.
+//
+// The shared copy is only ever accessed through seqlock_store()/seqlock_read(),
+// which move it word by word with relaxed atomics; writers that update fields
+// incrementally keep a private shadow (touched only inside the write section)
+// and store the whole shadow.
+//
+// Usage:
+//   seqlock_t sl;  stats_t shared, shadow;
+//   seqlock_init(&sl);
+//   seqlock_write_begin(&sl);                        // writer
+//   shadow.count++;
+//   seqlock_store(&shared, &shadow, sizeof(shadow));
+//   seqlock_write_end(&sl);
+//   seqlock_read(&sl, &copy, &shared, sizeof(copy));  // any number of readers
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sched.h>
+
+typedef struct {
+    _Alignas(64) atomic_uint seq;   // even = stable, odd = write in progress
+} seqlock_t;
+
+static inline void seqlock_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static inline void seqlock_init(seqlock_t *sl) {
+    atomic_init(&sl->seq, 0);
+}
+
+// Copies size bytes with relaxed atomic accesses (8-byte words, then bytes)
+static inline void seqlock_copy(void *dst, const void *src, size_t size) {
+    size_t words = size / 8;
+    uint64_t *d = dst;
+    const uint64_t *s = src;
+    for (size_t i = 0; i < words; ++i)
+        __atomic_store_n(&d[i], __atomic_load_n(&s[i], __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    for (size_t i = words * 8; i < size; ++i)
+        __atomic_store_n((char *)dst + i, __atomic_load_n((const char *)src + i, __ATOMIC_RELAXED),
+                         __ATOMIC_RELAXED);
+}
+
+// Enters the write section (spins while another writer is inside)
+static inline void seqlock_write_begin(seqlock_t *sl) {
+    unsigned s = atomic_load_explicit(&sl->seq, memory_order_relaxed);
+    for (;;) {
+        if (!(s & 1) && atomic_compare_exchange_weak_explicit(&sl->seq, &s, s + 1,
+                                                              memory_order_relaxed, memory_order_relaxed))
+            break;
+        if (s & 1) {
+            seqlock_relax();
+            s = atomic_load_explicit(&sl->seq, memory_order_relaxed);
+        }
+    }
+    // Readers that see any of the new data also see the odd sequence
+    atomic_thread_fence(memory_order_release);
+}
+
+// Leaves the write section and publishes the new snapshot
+static inline void seqlock_write_end(seqlock_t *sl) {
+    atomic_store_explicit(&sl->seq, atomic_load_explicit(&sl->seq, memory_order_relaxed) + 1,
+                          memory_order_release);
+}
+
+// Writer side, between begin and end: copies the new contents into the shared struct
+static inline void seqlock_store(void *shared, const void *src, size_t size) {
+    seqlock_copy(shared, src, size);
+}
+
+// Reader side: consistent copy of the shared struct. Returns the number of retries.
+static inline unsigned seqlock_read(seqlock_t *sl, void *out, const void *shared, size_t size) {
+    unsigned retries = 0;
+    for (;;) {
+        unsigned s1 = atomic_load_explicit(&sl->seq, memory_order_acquire);
+        if (!(s1 & 1)) {
+            seqlock_copy(out, shared, size);
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&sl->seq, memory_order_relaxed) == s1)
+                return retries;
+        }
+        retries++;
+        if (retries % 64 == 0)
+            sched_yield();   // the writer may be preempted inside its section
+        else
+            seqlock_relax();
+    }
+}
+
+#endif // SEQLOCK_H
@@ -0,0 +1,138 @@
+// shared_counter.h
+// Shared ID counter with selectable backends, replacing the
+// pthread_mutex_lock(&counter_lock); counter++; pattern in the producers.
+//
+//   COUNTER_MUTEX   - mutex around a plain long (the original behaviour)
+//   COUNTER_ATOMIC  - one atomic_fetch_add per ID
+//   COUNTER_SHARDED - one cache-line-padded shard per thread; IDs come from
+//                     blocks reserved from the global counter, so the shared
+//                     line is touched once per 'block' IDs. Reads sum the shards.
+//
+// IDs start at 1 and are unique; with COUNTER_SHARDED they are not issued in
+// global order (each thread walks through its own block).
+//
+// Usage:
+//   shared_counter_t c;
+//   counter_init(&c, COUNTER_SHARDED, NUM_PRODUCERS, 64);
+//   long id = counter_next(&c, my_index);        // my_index in [0, shards), else -1
+//   long first = counter_reserve(&c, 100);       // IDs first .. first+99
+//   long issued = counter_read(&c);
+
+#ifndef SHARED_COUNTER_H
+#define SHARED_COUNTER_H
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "lock_profile.h"
+
+#define COUNTER_MUTEX 0
+#define COUNTER_ATOMIC 1
+#define COUNTER_SHARDED 2
+
+#define COUNTER_CACHE_LINE 64
+
+typedef struct {
+    _Alignas(COUNTER_CACHE_LINE) atomic_long used;  // IDs issued by this shard (owner writes)
+    long next, end;                                  // Current reserved block [next, end)
+} counter_shard_t;
+
+typedef struct {
+    int backend;
+    long block;                   // IDs reserved per refill (sharded)
+    int nshards;
+    counter_shard_t *shards;
+
+    prof_mutex_t lock;            // COUNTER_MUTEX ("counter_lock" in lock profiles)
+    long value;
+
+    _Alignas(COUNTER_CACHE_LINE) atomic_long issued;  // COUNTER_ATOMIC / block source
+    atomic_long reserved;         // IDs taken through counter_reserve (sharded)
+} shared_counter_t;
+
+// Returns 0 on success; nshards/block only matter for COUNTER_SHARDED
+static inline int counter_init(shared_counter_t *c, int backend, int nshards, long block) {
+    c->backend = backend;
+    c->block = block > 0 ? block : 1;
+    c->nshards = nshards > 0 ? nshards : 1;
+    c->value = 0;
+    atomic_init(&c->issued, 0);
+    atomic_init(&c->reserved, 0);
+    prof_mutex_init(&c->lock, "counter_lock");
+
+    c->shards = NULL;
+    if (backend == COUNTER_SHARDED) {
+        c->shards = aligned_alloc(COUNTER_CACHE_LINE, c->nshards * sizeof(counter_shard_t));
+        if (!c->shards)
+            return -1;
+        for (int i = 0; i < c->nshards; ++i) {
+            atomic_init(&c->shards[i].used, 0);
+            c->shards[i].next = c->shards[i].end = 0;
+        }
+    }
+    return 0;
+}
+
+static inline void counter_destroy(shared_counter_t *c) {
+    prof_mutex_destroy(&c->lock);
+    free(c->shards);
+    c->shards = NULL;
+}
+
+// Takes n consecutive IDs from the global counter, returns the first one
+static inline long counter_take(shared_counter_t *c, long n) {
+    if (c->backend == COUNTER_MUTEX) {
+        prof_mutex_lock(&c->lock);
+        long first = c->value + 1;
+        c->value += n;
+        prof_mutex_unlock(&c->lock);
+        return first;
+    }
+    return atomic_fetch_add_explicit(&c->issued, n, memory_order_relaxed) + 1;
+}
+
+// Reserves n consecutive IDs for the caller and returns the first one
+static inline long counter_reserve(shared_counter_t *c, long n) {
+    if (c->backend == COUNTER_SHARDED)
+        atomic_fetch_add_explicit(&c->reserved, n, memory_order_relaxed);
+    return counter_take(c, n);
+}
+
+// Returns one unique ID; 'shard' is the calling thread's index (sharded backend).
+// Each shard has a single writer, so an index outside [0, nshards) is refused (-1)
+// rather than folded onto a shard another thread owns.
+static inline long counter_next(shared_counter_t *c, int shard) {
+    if (c->backend != COUNTER_SHARDED)
+        return counter_take(c, 1);
+    if (shard < 0 || shard >= c->nshards)
+        return -1;
+
+    counter_shard_t *s = &c->shards[shard];
+    if (s->next == s->end) {
+        s->next = counter_take(c, c->block);
+        s->end = s->next + c->block;
+    }
+    // Single writer per shard: a relaxed load/store pair is enough
+    atomic_store_explicit(&s->used, atomic_load_explicit(&s->used, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    return s->next++;
+}
+
+// Number of IDs handed out so far (exact once the producers have stopped)
+static inline long counter_read(shared_counter_t *c) {
+    if (c->backend == COUNTER_MUTEX) {
+        prof_mutex_lock(&c->lock);
+        long v = c->value;
+        prof_mutex_unlock(&c->lock);
+        return v;
+    }
+    if (c->backend == COUNTER_ATOMIC)
+        return atomic_load_explicit(&c->issued, memory_order_relaxed);
+
+    long sum = atomic_load_explicit(&c->reserved, memory_order_relaxed);
+    for (int i = 0; i < c->nshards; ++i)
+        sum += atomic_load_explicit(&c->shards[i].used, memory_order_relaxed);
+    return sum;
+}
+
+#endif // SHARED_COUNTER_H
@@ -0,0 +1,443 @@
+// sync_loadgen.c
+// Parameterized load generator for the producer/consumer hand-off strategies
+// used by the synchronization_* programs. Producers create timestamped items,
+// consumers take them; the program reports throughput and the p50/p99 time an
+// item spent between put() and get() (hand-off latency).
+//
+// Strategies:
+//   condvar    bounded buffer, one mutex + not_empty/not_full condition variables
+//   semaphore  bounded buffer, mutex + empty_slots/full_slots semaphores
+//   ring       lock-free MPSC ring (mpsc_ring.h); single consumer only
+//   workqueue  bounded MPMC work queue (work_queue.h), batch dequeue
+//   all        every strategy above that supports the consumer count
+//
+// Work distributions (-w producer work, -W consumer work, busy CPU time per item):
+//   none | fixed:US | uniform:LO:HI | exp:MEAN      (microseconds)
+//
+// Compile: gcc -O2 -pthread sync_loadgen.c -o sync_loadgen -lm
+// Run:     ./sync_loadgen [-s strategy] [-p producers] [-c consumers] [-n items]
+//                         [-q capacity] [-b batch] [-w dist] [-W dist]
+//   e.g.   ./sync_loadgen -s all -p 64 -c 8 -n 100000 -w exp:2
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "mpsc_ring.h"
+#include "work_queue.h"
+
+// ---------------- Config ----------------
+int num_producers = 4;
+int num_consumers = 1;
+long items_per_producer = 100000;
+long queue_capacity = 1024;
+int consumer_batch = 32;      // workqueue: items taken per lock acquisition
+
+// ---------------- Work Distribution ----------------
+#define WORK_NONE 0
+#define WORK_FIXED 1
+#define WORK_UNIFORM 2
+#define WORK_EXP 3
+
+typedef struct {
+    int kind;
+    double a, b;   // fixed: a; uniform: [a, b]; exp: mean a (microseconds)
+} work_dist_t;
+
+work_dist_t producer_work = { WORK_NONE, 0, 0 };
+work_dist_t consumer_work = { WORK_NONE, 0, 0 };
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// xorshift64*: cheap per-thread random numbers in [0, 1)
+static inline double rand01(uint64_t *s) {
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return (double)((*s * 2685821657736338717ull) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int parse_work(const char *spec, work_dist_t *w) {
+    if (!strcmp(spec, "none")) { w->kind = WORK_NONE; return 0; }
+    if (sscanf(spec, "fixed:%lf", &w->a) == 1) { w->kind = WORK_FIXED; return 0; }
+    if (sscanf(spec, "uniform:%lf:%lf", &w->a, &w->b) == 2 && w->b >= w->a) { w->kind = WORK_UNIFORM; return 0; }
+    if (sscanf(spec, "exp:%lf", &w->a) == 1) { w->kind = WORK_EXP; return 0; }
+    return -1;
+}
+
+// Burns CPU for one sample of the distribution (usleep() would measure the timer)
+static void do_work(const work_dist_t *w, uint64_t *rng) {
+    double us;
+    switch (w->kind) {
+    case WORK_FIXED:   us = w->a; break;
+    case WORK_UNIFORM: us = w->a + (w->b - w->a) * rand01(rng); break;
+    case WORK_EXP:     us = -w->a * log(1.0 - rand01(rng)); break;
+    default:           return;
+    }
+    uint64_t until = now_ns() + (uint64_t)(us * 1000.0);
+    while (now_ns() < until)
+        ;
+}
+
+// ---------------- Latency Histogram ----------------
+// Log-linear buckets: 8 sub-buckets per power of two (~12% resolution)
+#define HIST_SUB 3
+#define HIST_BUCKETS (64 << HIST_SUB)
+
+typedef struct {
+    _Alignas(64) long count[HIST_BUCKETS];
+} latency_hist_t;
+
+static inline int hist_index(uint64_t ns) {
+    if (ns < (1u << HIST_SUB))
+        return (int)ns;
+    int msb = 63 - __builtin_clzll(ns);
+    return ((msb - HIST_SUB + 1) << HIST_SUB) | (int)((ns >> (msb - HIST_SUB)) & ((1 << HIST_SUB) - 1));
+}
+
+// Lower bound of a bucket in nanoseconds
+static inline double hist_value(int idx) {
+    if (idx < (1 << HIST_SUB))
+        return idx;
+    int msb = (idx >> HIST_SUB) + HIST_SUB - 1;
+    return (double)(((uint64_t)((1 << HIST_SUB) | (idx & ((1 << HIST_SUB) - 1)))) << (msb - HIST_SUB));
+}
+
+static double hist_percentile(const latency_hist_t *h, double p) {
+    long total = 0, seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; ++i)
+        total += h->count[i];
+    long target = (long)ceil(p * total);
+    for (int i = 0; i < HIST_BUCKETS; ++i) {
+        seen += h->count[i];
+        if (seen >= target && h->count[i])
+            return hist_value(i);
+    }
+    return 0;
+}
+
+// ---------------- Strategies ----------------
+// Items are enqueue timestamps; 0 is never a valid timestamp and marks "no more items".
+typedef struct {
+    const char *name;
+    int multi_consumer;              // 0 = requires exactly one consumer
+    int (*init)(void);
+    void (*put)(uint64_t item);
+    uint64_t (*get)(void);           // blocks; 0 once the queue is closed and drained
+    void (*close)(void);             // called after every producer finished
+    void (*destroy)(void);
+} strategy_t;
+
+// --- Bounded buffer: mutex + two condition variables ---
+struct {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty, not_full;
+    uint64_t *buf;
+    long head, count;
+    int closed;
+} cq;
+
+static int cq_init(void) {
+    cq.buf = malloc(sizeof(uint64_t) * (size_t)queue_capacity);
+    cq.head = cq.count = 0;
+    cq.closed = 0;
+    pthread_mutex_init(&cq.lock, NULL);
+    pthread_cond_init(&cq.not_empty, NULL);
+    pthread_cond_init(&cq.not_full, NULL);
+    return cq.buf ? 0 : -1;
+}
+
+static void cq_put(uint64_t item) {
+    pthread_mutex_lock(&cq.lock);
+    while (cq.count == queue_capacity)
+        pthread_cond_wait(&cq.not_full, &cq.lock);
+    cq.buf[(cq.head + cq.count++) % queue_capacity] = item;
+    pthread_cond_signal(&cq.not_empty);
+    pthread_mutex_unlock(&cq.lock);
+}
+
+static uint64_t cq_get(void) {
+    pthread_mutex_lock(&cq.lock);
+    while (cq.count == 0 && !cq.closed)
+        pthread_cond_wait(&cq.not_empty, &cq.lock);
+    uint64_t item = 0;
+    if (cq.count > 0) {
+        item = cq.buf[cq.head];
+        cq.head = (cq.head + 1) % queue_capacity;
+        cq.count--;
+        pthread_cond_signal(&cq.not_full);
+    }
+    pthread_mutex_unlock(&cq.lock);
+    return item;
+}
+
+static void cq_close(void) {
+    pthread_mutex_lock(&cq.lock);
+    cq.closed = 1;
+    pthread_cond_broadcast(&cq.not_empty);
+    pthread_mutex_unlock(&cq.lock);
+}
+
+static void cq_destroy(void) {
+    pthread_mutex_destroy(&cq.lock);
+    pthread_cond_destroy(&cq.not_empty);
+    pthread_cond_destroy(&cq.not_full);
+    free(cq.buf);
+}
+
+// --- Bounded buffer: mutex + counting semaphores ---
+struct {
+    pthread_mutex_t lock;
+    sem_t empty_slots, full_slots;
+    uint64_t *buf;
+    long head, tail;
+} sq;
+
+static int sq_init(void) {
+    sq.buf = malloc(sizeof(uint64_t) * (size_t)queue_capacity);
+    sq.head = sq.tail = 0;
+    pthread_mutex_init(&sq.lock, NULL);
+    sem_init(&sq.empty_slots, 0, (unsigned)queue_capacity);
+    sem_init(&sq.full_slots, 0, 0);
+    return sq.buf ? 0 : -1;
+}
+
+static void sq_put(uint64_t item) {
+    sem_wait(&sq.empty_slots);
+    pthread_mutex_lock(&sq.lock);
+    sq.buf[sq.tail] = item;
+    sq.tail = (sq.tail + 1) % queue_capacity;
+    pthread_mutex_unlock(&sq.lock);
+    sem_post(&sq.full_slots);
+}
+
+static uint64_t sq_get(void) {
+    sem_wait(&sq.full_slots);
+    pthread_mutex_lock(&sq.lock);
+    uint64_t item = sq.buf[sq.head];
+    sq.head = (sq.head + 1) % queue_capacity;
+    pthread_mutex_unlock(&sq.lock);
+    sem_post(&sq.empty_slots);
+    return item;
+}
+
+static void sq_close(void) {
+    for (int i = 0; i < num_consumers; i++)
+        sq_put(0);   // one end marker per consumer
+}
+
+static void sq_destroy(void) {
+    pthread_mutex_destroy(&sq.lock);
+    sem_destroy(&sq.empty_slots);
+    sem_destroy(&sq.full_slots);
+    free(sq.buf);
+}
+
+// --- Lock-free MPSC ring ---
+mpsc_ring_t ring;
+atomic_int ring_closed;
+
+static int ring_init(void) {
+    atomic_store(&ring_closed, 0);
+    return mpsc_ring_init(&ring, (size_t)queue_capacity);
+}
+
+static void ring_put(uint64_t item) {
+    mpsc_ring_push(&ring, (long)item);
+}
+
+static uint64_t ring_get(void) {
+    long item;
+    for (;;) {
+        if (mpsc_ring_pop(&ring, &item))
+            return (uint64_t)item;
+        // Empty: done only if the producers finished and nothing is left
+        if (atomic_load_explicit(&ring_closed, memory_order_acquire))
+            return mpsc_ring_pop(&ring, &item) ? (uint64_t)item : 0;
+        sched_yield();
+    }
+}
+
+static void ring_close(void) {
+    atomic_store_explicit(&ring_closed, 1, memory_order_release);
+}
+
+static void ring_destroy(void) {
+    mpsc_ring_destroy(&ring);
+}
+
+// --- Bounded MPMC work queue with batch dequeue ---
+work_queue_t wq;
+static __thread long wq_batch[1024];   // consumer-local: items taken but not yet returned
+static __thread size_t wq_next, wq_have;
+
+static int wq_strategy_init(void) {
+    return wq_init(&wq, (size_t)queue_capacity);
+}
+
+static void wq_strategy_put(uint64_t item) {
+    wq_push(&wq, (long)item);
+}
+
+static uint64_t wq_strategy_get(void) {
+    if (wq_next == wq_have) {
+        wq_have = wq_pop_batch(&wq, wq_batch, (size_t)consumer_batch);
+        wq_next = 0;
+        if (wq_have == 0)
+            return 0;
+    }
+    return (uint64_t)wq_batch[wq_next++];
+}
+
+static void wq_strategy_close(void) {
+    wq_close(&wq);
+}
+
+static void wq_strategy_destroy(void) {
+    wq_destroy(&wq);
+}
+
+static const strategy_t strategies[] = {
+    { "condvar",   1, cq_init,   cq_put,   cq_get,   cq_close,   cq_destroy },
+    { "semaphore", 1, sq_init,   sq_put,   sq_get,   sq_close,   sq_destroy },
+    { "ring",      0, ring_init, ring_put, ring_get, ring_close, ring_destroy },
+    { "workqueue", 1, wq_strategy_init, wq_strategy_put, wq_strategy_get, wq_strategy_close, wq_strategy_destroy },
+};
+#define NUM_STRATEGIES (int)(sizeof(strategies) / sizeof(strategies[0]))
+
+// ---------------- Threads ----------------
+const strategy_t *strategy;
+
+typedef struct {
+    _Alignas(64) long consumed;
+    latency_hist_t hist;
+} consumer_stats_t;
+
+consumer_stats_t *consumer_stats;
+
+void *producer(void *arg) {
+    uint64_t rng = 0x9E3779B97F4A7C15ull * ((uint64_t)(intptr_t)arg + 1);
+    for (long i = 0; i < items_per_producer; i++) {
+        do_work(&producer_work, &rng);
+        strategy->put(now_ns());
+    }
+    return NULL;
+}
+
+void *consumer(void *arg) {
+    int id = (int)(intptr_t)arg;
+    consumer_stats_t *st = &consumer_stats[id];
+    uint64_t rng = 0xD1B54A32D192ED03ull * ((uint64_t)id + 1);
+    uint64_t item;
+    while ((item = strategy->get()) != 0) {
+        uint64_t t = now_ns();
+        st->hist.count[hist_index(t > item ? t - item : 0)]++;
+        st->consumed++;
+        do_work(&consumer_work, &rng);
+    }
+    return NULL;
+}
+
+// Runs one strategy and prints its result line; returns 0 if every item arrived
+static int run_strategy(const strategy_t *s) {
+    pthread_t producers[num_producers], consumers[num_consumers];
+    strategy = s;
+    consumer_stats = aligned_alloc(64, sizeof(consumer_stats_t) * (size_t)num_consumers);
+    if (!consumer_stats || s->init() != 0) {
+        perror("Failed to initialize strategy");
+        return -1;
+    }
+    memset(consumer_stats, 0, sizeof(consumer_stats_t) * (size_t)num_consumers);
+
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < num_consumers; i++)
+        pthread_create(&consumers[i], NULL, consumer, (void *)(intptr_t)i);
+    for (int i = 0; i < num_producers; i++)
+        pthread_create(&producers[i], NULL, producer, (void *)(intptr_t)i);
+    for (int i = 0; i < num_producers; i++)
+        pthread_join(producers[i], NULL);
+    s->close();
+    for (int i = 0; i < num_consumers; i++)
+        pthread_join(consumers[i], NULL);
+    double dt = (now_ns() - t0) * 1e-9;
+
+    // Merge the per-consumer histograms
+    latency_hist_t total;
+    long consumed = 0;
+    memset(&total, 0, sizeof(total));
+    for (int i = 0; i < num_consumers; i++) {
+        consumed += consumer_stats[i].consumed;
+        for (int b = 0; b < HIST_BUCKETS; b++)
+            total.count[b] += consumer_stats[i].hist.count[b];
+    }
+
+    long expected = (long)num_producers * items_per_producer;
+    printf("%-10s %5d %5d %12ld %9.3f %12.3f %10.2f %10.2f  %s\n", s->name,
+           num_producers, num_consumers, consumed, dt, consumed / dt / 1e6,
+           hist_percentile(&total, 0.50) / 1000.0, hist_percentile(&total, 0.99) / 1000.0,
+           consumed == expected ? "ok" : "ITEMS LOST");
+
+    s->destroy();
+    free(consumer_stats);
+    return consumed == expected ? 0 : -1;
+}
+
+// ---------------- Main ----------------
+int main(int argc, char **argv) {
+    const char *which = "all";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc) which = argv[++i];
+        else if (!strcmp(argv[i], "-p") && i + 1 < argc) num_producers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc) num_consumers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc) items_per_producer = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-q") && i + 1 < argc) queue_capacity = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc) consumer_batch = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-w") && i + 1 < argc && parse_work(argv[i + 1], &producer_work) == 0) i++;
+        else if (!strcmp(argv[i], "-W") && i + 1 < argc && parse_work(argv[i + 1], &consumer_work) == 0) i++;
+        else {
+            fprintf(stderr, "Usage: %s [-s condvar|semaphore|ring|workqueue|all] [-p producers] [-c consumers]\n"
+                            "       [-n items] [-q capacity] [-b batch] [-w dist] [-W dist]\n"
+                            "  dist: none | fixed:US | uniform:LO:HI | exp:MEAN\n", argv[0]);
+            return 1;
+        }
+    }
+    if (num_producers < 1 || num_consumers < 1 || items_per_producer < 1 || queue_capacity < 1
+        || consumer_batch < 1 || consumer_batch > 1024) {
+        fprintf(stderr, "Counts must be positive (batch at most 1024)\n");
+        return 1;
+    }
+
+    int rc = 0, ran = 0;
+    for (int s = 0; s < NUM_STRATEGIES; s++) {
+        if (strcmp(which, "all") != 0 && strcmp(which, strategies[s].name) != 0)
+            continue;
+        if (!strategies[s].multi_consumer && num_consumers != 1) {
+            if (strcmp(which, "all") != 0)
+                fprintf(stderr, "%s supports a single consumer only\n", strategies[s].name);
+            continue;
+        }
+        if (!ran) {
+            printf("=== Load: %d producers x %ld items, %d consumers, capacity %ld ===\n",
+                   num_producers, items_per_producer, num_consumers, queue_capacity);
+            printf("%-10s %5s %5s %12s %9s %12s %10s %10s  %s\n", "strategy", "prod", "cons",
+                   "items", "seconds", "Mitems/sec", "p50 us", "p99 us", "check");
+        }
+        rc |= run_strategy(&strategies[s]);
+        ran++;
+    }
+    if (!ran) {
+        fprintf(stderr, "No strategy ran (unknown name or unsupported consumer count)\n");
+        return 1;
+    }
+    return rc ? 1 : 0;
+}
@@ -1,36 +1,49 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <semaphore.h>
 #include <stdatomic.h>
+#include "append_log.h"
+#include "lock_profile.h"
+#include "shared_counter.h"
+#include "trace.h"
+#include "event_latch.h"
+#include "phase_barrier.h"
 
 // ---------------- Config ----------------
 #define NUM_PRODUCERS 3
 #define NUM_VALUES 5
+#define NUM_PHASES 2                    // Values are split into this many barrier-separated phases
 const char *filename = "demo_file.txt";
 
-// ---------------- Semaphores ----------------
-sem_t file_semaphore;  // Protects file writes (mutual exclusion)
+// ---------------- Append Log ----------------
+append_log_t data_log;  // One shared fd, per-producer buffers
+log_writer_t *writers[NUM_PRODUCERS];  // One per producer, opened by main
+
+// ---------------- Shared Counter ----------------
+#define COUNTER_BACKEND COUNTER_SHARDED  // COUNTER_MUTEX / COUNTER_ATOMIC / COUNTER_SHARDED
+#define COUNTER_BLOCK NUM_VALUES         // IDs a producer reserves per refill (sharded)
+shared_counter_t counter;                // Shared counter between producers
 
 // ---------------- Mutex ----------------
-pthread_mutex_t counter_lock;   // Protects shared counter
-pthread_mutex_t producer_lock;  // Protects producers_finished & ready
+prof_mutex_t producer_lock;     // Protects producers_finished & ready
 
 // ---------------- Condition Variable ----------------
-pthread_cond_t cond_var;        // Consumer waits until all producers finish
+prof_cond_t cond_var;           // Consumer waits until all producers finish
 
 // ---------------- Barrier ----------------
-pthread_barrier_t barrier;      // Synchronize all producers at midpoint
+phase_barrier_t barrier;        // Synchronize all producers between phases
+int barrier_kind = BARRIER_TREE; // central / dissemination / tree / pthread (argv[1])
 
 // ---------------- Shared Variables ----------------
-int counter = 0;                 // Shared counter
 int producers_finished = 0;      // Number of finished producers
 int ready = 0;                   // Flag for condition variable
 
 // ---------------- Memory Fence Variables ----------------
 atomic_int fence_counter = 0;    // Final counter value
-atomic_int fence_flag = 0;       // Signals that final counter is ready
+event_latch_t fence_flag;        // Signals that final counter is ready (spin, then futex park)
 
 // ---------------- File Creation Thread ----------------
 void *create_file(void *arg) {
@@ -42,57 +55,46 @@ void *create_file(void *arg) {
 
 // ---------------- Producer Thread ----------------
 void *producer(void *arg) {
+    int id = (int)(intptr_t)arg;  // Producer index (counter shard)
     pthread_t tid = pthread_self();
     printf("Producer thread %lu started.\n", (unsigned long)tid);
 
-    // Phase 1: write first half of values
-    for (int i = 0; i < NUM_VALUES / 2; i++) {
-        pthread_mutex_lock(&counter_lock); // Mutex: increment counter safely
-        counter++;
-        int my_value = counter;
-        pthread_mutex_unlock(&counter_lock);
-
-        sem_wait(&file_semaphore);         // Semaphore: exclusive file access
-        FILE *f = fopen(filename, "a");
-        if (f) fprintf(f, "%d\n", my_value);
-        if (f) fclose(f);
-        sem_post(&file_semaphore);
-
-        usleep(10000); // Simulate work
-    }
+    log_writer_t *w = writers[id];
 
-    // Barrier: all producers wait here before continuing
-    pthread_barrier_wait(&barrier);
+    for (int phase = 0; phase < NUM_PHASES; phase++) {
+        // Phase: write this phase's share of the values
+        for (int i = phase * NUM_VALUES / NUM_PHASES; i < (phase + 1) * NUM_VALUES / NUM_PHASES; i++) {
+            // Counter: unique ID from this producer's shard
+            int my_value = (int)counter_next(&counter, id);
 
-    // Phase 2: write remaining values
-    for (int i = NUM_VALUES / 2; i < NUM_VALUES; i++) {
-        pthread_mutex_lock(&counter_lock);
-        counter++;
-        int my_value = counter;
-        pthread_mutex_unlock(&counter_lock);
+            log_append_int(w, my_value);   // Append log: buffered, batched writes
 
-        sem_wait(&file_semaphore);
-        FILE *f = fopen(filename, "a");
-        if (f) fprintf(f, "%d\n", my_value);
-        if (f) fclose(f);
-        sem_post(&file_semaphore);
+            usleep(10000); // Simulate work
+        }
 
-        usleep(10000);
+        // Barrier: all producers wait here before the next phase
+        if (phase < NUM_PHASES - 1) {
+            TRACE_BEGIN("barrier");
+            phase_barrier_wait(&barrier, id);
+            TRACE_END("barrier");
+        }
     }
 
+    log_writer_close(w);
+
     // Signal consumer if last producer
-    pthread_mutex_lock(&producer_lock);
+    prof_mutex_lock(&producer_lock);
     producers_finished++;
     if (producers_finished == NUM_PRODUCERS) {
         // Memory fence: safely publish final counter
-        atomic_store_explicit(&fence_counter, counter, memory_order_relaxed);
+        atomic_store_explicit(&fence_counter, (int)counter_read(&counter), memory_order_relaxed);
         atomic_thread_fence(memory_order_release);
-        atomic_store_explicit(&fence_flag, 1, memory_order_relaxed);
+        event_latch_set(&fence_flag);    // Wakes the consumer if it parked
 
         ready = 1;
-        pthread_cond_signal(&cond_var);
+        prof_cond_signal(&cond_var);
     }
-    pthread_mutex_unlock(&producer_lock);
+    prof_mutex_unlock(&producer_lock);
 
     pthread_exit(NULL);
 }
@@ -100,11 +102,13 @@ void *producer(void *arg) {
 // ---------------- Consumer Thread ----------------
 void *consumer(void *arg) {
     // Wait until all producers finish
-    pthread_mutex_lock(&producer_lock);
+    TRACE_BEGIN("wait ready");
+    prof_mutex_lock(&producer_lock);
     while (!ready) {
-        pthread_cond_wait(&cond_var, &producer_lock);
+        prof_cond_wait(&cond_var, &producer_lock);
     }
-    pthread_mutex_unlock(&producer_lock);
+    prof_mutex_unlock(&producer_lock);
+    TRACE_END("wait ready");
 
     // Read file contents
     printf("Consumer reading file contents:\n");
@@ -118,7 +122,7 @@ void *consumer(void *arg) {
     }
 
     // Memory fence: read final counter safely
-    while (atomic_load_explicit(&fence_flag, memory_order_acquire) == 0);
+    event_latch_wait(&fence_flag, EVENT_SPIN_DEFAULT); // spin briefly, then sleep until published
     int final_count = atomic_load_explicit(&fence_counter, memory_order_relaxed);
     printf("Consumer sees final counter (fence): %d\n", final_count);
 
@@ -126,23 +130,44 @@ void *consumer(void *arg) {
 }
 
 // ---------------- Main ----------------
-int main() {
+int main(int argc, char **argv) {
     pthread_t create_thread, producers[NUM_PRODUCERS], consumer_thread;
 
+    if (argc > 1 && (barrier_kind = phase_barrier_parse(argv[1])) < 0) {
+        fprintf(stderr, "Usage: %s [central|dissemination|tree|pthread]\n", argv[0]);
+        return 1;
+    }
+
     // Initialize synchronization primitives
-    sem_init(&file_semaphore, 0, 1);          // Semaphore
-    pthread_mutex_init(&counter_lock, NULL);  // Mutex
-    pthread_mutex_init(&producer_lock, NULL); // Mutex
-    pthread_cond_init(&cond_var, NULL);       // Condition variable
-    pthread_barrier_init(&barrier, NULL, NUM_PRODUCERS); // Barrier
+    counter_init(&counter, COUNTER_BACKEND, NUM_PRODUCERS, COUNTER_BLOCK); // Counter
+    event_latch_init(&fence_flag);                    // Event latch
+    prof_mutex_init(&producer_lock, "producer_lock"); // Mutex
+    prof_cond_init(&cond_var, "cond_var");            // Condition variable
+    if (phase_barrier_init(&barrier, barrier_kind, NUM_PRODUCERS) != 0) { // Barrier
+        fprintf(stderr, "Failed to initialize barrier\n");
+        return 1;
+    }
+    printf("Barrier: %s, %d phases\n", phase_barrier_names[barrier_kind], NUM_PHASES);
 
     // Create/clear file
     pthread_create(&create_thread, NULL, create_file, NULL);
     pthread_join(create_thread, NULL);
 
+    // Open the shared append log once for all producers
+    if (log_open(&data_log, filename, LOG_FLUSH_BYTES, LOG_FLUSH_MS, LOG_SYNC_POLICY) != 0)
+        return 1;
+
+    // Per-producer writers, opened up front: a producer that quit would hang the barrier
+    for (int i = 0; i < NUM_PRODUCERS; i++) {
+        if (!(writers[i] = log_writer_open(&data_log))) {
+            perror("Failed to open log writer");
+            return 1;
+        }
+    }
+
     // Start producer threads
     for (int i = 0; i < NUM_PRODUCERS; i++)
-        pthread_create(&producers[i], NULL, producer, NULL);
+        pthread_create(&producers[i], NULL, producer, (void *)(intptr_t)i);
 
     // Start consumer thread
     pthread_create(&consumer_thread, NULL, consumer, NULL);
@@ -153,11 +178,11 @@ int main() {
     pthread_join(consumer_thread, NULL);
 
     // Cleanup
-    sem_destroy(&file_semaphore);
-    pthread_mutex_destroy(&counter_lock);
-    pthread_mutex_destroy(&producer_lock);
-    pthread_cond_destroy(&cond_var);
-    pthread_barrier_destroy(&barrier);
+    log_close(&data_log);
+    counter_destroy(&counter);
+    prof_mutex_destroy(&producer_lock);
+    prof_cond_destroy(&cond_var);
+    phase_barrier_destroy(&barrier);
 
     printf("Program completed successfully.\n");
     return 0;
@@ -1,31 +1,80 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <semaphore.h>
 #include <stdatomic.h>
+#include <time.h>
+#include "append_log.h"
+#include "lock_profile.h"
+#include "shared_counter.h"
+#include "trace.h"
+#include "event_latch.h"
+#include "seqlock.h"
 
 #define NUM_PRODUCERS 3
 #define NUM_VALUES 5
+#define MONITOR_POLL_US 2000            // How often the monitor samples the stats
 const char *filename = "empty_file.txt";
 
-// ---------------- Semaphore ----------------
-sem_t file_semaphore;             // Protect file writes
+// ---------------- Append Log ----------------
+append_log_t data_log;            // One shared fd, per-producer buffers
+log_writer_t *writers[NUM_PRODUCERS];  // One per producer, opened by main
+
+// ---------------- Shared Counter ----------------
+#define COUNTER_BACKEND COUNTER_SHARDED  // COUNTER_MUTEX / COUNTER_ATOMIC / COUNTER_SHARDED
+#define COUNTER_BLOCK NUM_VALUES         // IDs a producer reserves per refill (sharded)
+shared_counter_t counter;                // Shared counter between producers
 
 // ---------------- Mutex ----------------
-pthread_mutex_t counter_lock;     // protect shared counter
-pthread_mutex_t producer_lock;    // Protect producers_finished & ready
+prof_mutex_t producer_lock;       // Protect producers_finished & ready
 
 // ---------------- Condition Variable ----------------
-pthread_cond_t cond_var;          // Consumer waits until producers finish
+prof_cond_t cond_var;             // Consumer waits until producers finish
 
-int counter = 0;                   // Shared counter
 int producers_finished = 0;
 int ready = 0;                     // Condition variable flag
 
 // ---------------- Memory Fence Variables ----------------
 atomic_int fence_counter = 0;      // Fence: Final counter value
-atomic_int fence_flag = 0;         // Fence: Signals that final counter is ready
+event_latch_t fence_flag;          // Fence: Signals that final counter is ready (spin, then futex park)
+
+// ---------------- Seqlock Snapshot ----------------
+typedef struct {
+    long values_written;                // Values appended by all producers
+    long per_producer[NUM_PRODUCERS];   // ...and by each producer
+    long last_value;                    // Most recent counter value
+    long producers_finished;
+    uint64_t first_ns, last_ns;         // CLOCK_MONOTONIC of the first / latest update
+} producer_stats_t;
+
+seqlock_t stats_lock;                   // Writers: producers (exclusive); readers: lock-free
+producer_stats_t stats;                 // Published copy (only via seqlock_store/seqlock_read)
+producer_stats_t stats_shadow;          // Writers' working copy (inside the write section only)
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Producer side: applies one update to the shadow and publishes the whole struct
+static void stats_publish(int id, long value, int finished) {
+    seqlock_write_begin(&stats_lock);
+    uint64_t t = now_ns();
+    if (value >= 0) {
+        stats_shadow.values_written++;
+        stats_shadow.per_producer[id]++;
+        stats_shadow.last_value = value;
+    }
+    stats_shadow.producers_finished += finished;
+    if (!stats_shadow.first_ns)
+        stats_shadow.first_ns = t;
+    stats_shadow.last_ns = t;
+    seqlock_store(&stats, &stats_shadow, sizeof(stats));
+    seqlock_write_end(&stats_lock);
+}
 
 // ---------------- File Creation ----------------
 void *create_file(void *arg) {
@@ -37,41 +86,41 @@ void *create_file(void *arg) {
 
 // ---------------- Producer Thread ----------------
 void *producer(void *arg) {
+    int id = (int)(intptr_t)arg;  // Producer index (counter shard)
     pthread_t tid = pthread_self();
     printf("Producer thread %lu started.\n", (unsigned long)tid);
 
+    log_writer_t *w = writers[id];
+
     for (int i = 0; i < NUM_VALUES; i++) {
-        // Mutex: safely increment shared counter
-        pthread_mutex_lock(&counter_lock);
-        counter++;
-        int my_value = counter;
-        pthread_mutex_unlock(&counter_lock);
-
-        // Semaphore: safely write to file
-        sem_wait(&file_semaphore);
-        FILE *f = fopen(filename, "a");
-        if (f) {
-            fprintf(f, "%d\n", my_value);
-            fclose(f);
-        }
-        sem_post(&file_semaphore);
+        // Counter: unique ID from this producer's shard
+        int my_value = (int)counter_next(&counter, id);
+
+        // Append log: buffered in this thread, written in large batches
+        log_append_int(w, my_value);
+
+        // Seqlock: publish the updated statistics snapshot
+        stats_publish(id, my_value, 0);
 
         usleep(10000); // simulate work
     }
 
+    log_writer_close(w);
+    stats_publish(id, -1, 1);
+
     // Mutex + Condition Variable: signal consumer if last producer
-    pthread_mutex_lock(&producer_lock);
+    prof_mutex_lock(&producer_lock);
     producers_finished++;
     if (producers_finished == NUM_PRODUCERS) {
         // Memory Fence: safely publish final counter
-        atomic_store_explicit(&fence_counter, counter, memory_order_relaxed);
+        atomic_store_explicit(&fence_counter, (int)counter_read(&counter), memory_order_relaxed);
         atomic_thread_fence(memory_order_release);
-        atomic_store_explicit(&fence_flag, 1, memory_order_relaxed);
+        event_latch_set(&fence_flag);    // Wakes the consumer if it parked
 
         ready = 1;
-        pthread_cond_signal(&cond_var);
+        prof_cond_signal(&cond_var);
     }
-    pthread_mutex_unlock(&producer_lock);
+    prof_mutex_unlock(&producer_lock);
 
     pthread_exit(NULL);
 }
@@ -79,13 +128,15 @@ void *producer(void *arg) {
 // ---------------- Consumer Thread ----------------
 void *consumer(void *arg) {
     // Mutex + Condition Variable: wait until producers finish
-    pthread_mutex_lock(&producer_lock);
+    TRACE_BEGIN("wait ready");
+    prof_mutex_lock(&producer_lock);
     while (!ready) {
-        pthread_cond_wait(&cond_var, &producer_lock);
+        prof_cond_wait(&cond_var, &producer_lock);
     }
-    pthread_mutex_unlock(&producer_lock);
+    prof_mutex_unlock(&producer_lock);
+    TRACE_END("wait ready");
 
-    // Read file contents (no sync needed; semaphore already handled by producer)
+    // Read file contents (every producer flushed its writer before finishing)
     printf("Consumer reading file contents:\n");
     FILE *f = fopen(filename, "r");
     if (f) {
@@ -97,45 +148,89 @@ void *consumer(void *arg) {
     }
 
     // Memory Fence: read final counter safely
-    while (atomic_load_explicit(&fence_flag, memory_order_acquire) == 0)
-        ; // busy-wait until final counter is published
+    event_latch_wait(&fence_flag, EVENT_SPIN_DEFAULT); // spin briefly, then sleep until published
     int final_count = atomic_load_explicit(&fence_counter, memory_order_relaxed);
     printf("Consumer sees final counter (fence): %d\n", final_count);
 
     pthread_exit(NULL);
 }
 
+// ---------------- Monitor Thread ----------------
+void *monitor(void *arg) {
+    producer_stats_t snap;
+    long last_seen = -1;
+    unsigned long reads = 0, retries = 0;
+
+    // Seqlock: poll consistent snapshots without ever blocking the producers
+    do {
+        retries += seqlock_read(&stats_lock, &snap, &stats, sizeof(snap));
+        reads++;
+
+        long sum = 0;
+        for (int i = 0; i < NUM_PRODUCERS; i++)
+            sum += snap.per_producer[i];
+        if (sum != snap.values_written)
+            printf("Monitor: INCONSISTENT snapshot (%ld != %ld)\n", sum, snap.values_written);
+
+        if (snap.values_written != last_seen) {
+            printf("Monitor: %ld values (last %ld), %.1f ms since first update\n",
+                   snap.values_written, snap.last_value,
+                   snap.first_ns ? (snap.last_ns - snap.first_ns) / 1e6 : 0.0);
+            last_seen = snap.values_written;
+        }
+        usleep(MONITOR_POLL_US);
+    } while (snap.producers_finished < NUM_PRODUCERS);
+
+    printf("Monitor: %lu snapshots, %lu retries\n", reads, retries);
+    pthread_exit(NULL);
+}
+
 // ---------------- Main ----------------
 int main() {
-    pthread_t create_thread, producers[NUM_PRODUCERS], consumer_thread;
+    pthread_t create_thread, producers[NUM_PRODUCERS], consumer_thread, monitor_thread;
 
     // Initialize synchronization primitives
-    sem_init(&file_semaphore, 0, 1);           // Semaphore
-    pthread_mutex_init(&counter_lock, NULL);   // Mutex
-    pthread_mutex_init(&producer_lock, NULL);  // Mutex
-    pthread_cond_init(&cond_var, NULL);        // Condition Variable
+    counter_init(&counter, COUNTER_BACKEND, NUM_PRODUCERS, COUNTER_BLOCK); // Counter
+    event_latch_init(&fence_flag);                     // Event latch
+    seqlock_init(&stats_lock);                         // Seqlock
+    prof_mutex_init(&producer_lock, "producer_lock");  // Mutex
+    prof_cond_init(&cond_var, "cond_var");             // Condition Variable
 
     // Create/clear the file
     pthread_create(&create_thread, NULL, create_file, NULL);
     pthread_join(create_thread, NULL);
 
+    // Open the shared append log once for all producers
+    if (log_open(&data_log, filename, LOG_FLUSH_BYTES, LOG_FLUSH_MS, LOG_SYNC_POLICY) != 0)
+        return 1;
+
+    // Per-producer writers, opened up front: a producer that quit would leave the consumer waiting
+    for (int i = 0; i < NUM_PRODUCERS; i++) {
+        if (!(writers[i] = log_writer_open(&data_log))) {
+            perror("Failed to open log writer");
+            return 1;
+        }
+    }
+
     // Start producer threads
     for (int i = 0; i < NUM_PRODUCERS; i++)
-        pthread_create(&producers[i], NULL, producer, NULL);
+        pthread_create(&producers[i], NULL, producer, (void *)(intptr_t)i);
 
-    // Start consumer thread
+    // Start consumer and monitor threads
     pthread_create(&consumer_thread, NULL, consumer, NULL);
+    pthread_create(&monitor_thread, NULL, monitor, NULL);
 
     // Wait for all threads
     for (int i = 0; i < NUM_PRODUCERS; i++)
         pthread_join(producers[i], NULL);
     pthread_join(consumer_thread, NULL);
+    pthread_join(monitor_thread, NULL);
 
     // Cleanup synchronization primitives
-    sem_destroy(&file_semaphore);           
-    pthread_mutex_destroy(&counter_lock);   
-    pthread_mutex_destroy(&producer_lock);  
-    pthread_cond_destroy(&cond_var);        
+    log_close(&data_log);
+    counter_destroy(&counter);
+    prof_mutex_destroy(&producer_lock);
+    prof_cond_destroy(&cond_var);
 
     printf("Program completed successfully.\n");
     return 0;
@@ -1,22 +1,34 @@
+#define _GNU_SOURCE     // splice() in fast_io.h
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <semaphore.h>
+#include "append_log.h"
+#include "fast_io.h"
+#include "lock_profile.h"
+#include "shared_counter.h"
 
 // ---------------- File ----------------
 const char *filename = "empty_file.txt";
 
+// ---------------- Append Log ----------------
+append_log_t data_log;                  // One shared fd, per-producer buffers
+log_writer_t *writers[3];               // One per producer, opened by main
+
 // ---------------- Semaphores ----------------
-sem_t file_semaphore;      // Protects file access (mutual exclusion)
-sem_t producer_done;       // Signals when all producers have finished
+prof_sem_t producer_done; // Signals when all producers have finished
+
+// ---------------- Shared Counter ----------------
+#define COUNTER_BACKEND COUNTER_SHARDED  // COUNTER_MUTEX / COUNTER_ATOMIC / COUNTER_SHARDED
+#define COUNTER_BLOCK 5                  // IDs a producer reserves per refill (sharded)
+shared_counter_t counter;                // Shared counter between producers
 
 // ---------------- Mutex ----------------
-pthread_mutex_t counter_lock;  // Protect shared counter
-pthread_mutex_t producer_lock; // Protect producers_finished
+prof_mutex_t producer_lock; // Protect producers_finished
 
 // ---------------- Shared Variables ----------------
-int counter = 0;                 // Shared counter between producers
 int producers_finished = 0;      // Number of finished producers
 
 // ---------------- File Creation Thread ----------------
@@ -25,7 +37,7 @@ void *create_file(void *arg) {
     fflush(stdout);
 
     if (access(filename, F_OK) != 0) {
-        if (system("touch empty_file.txt") != 0) {
+        if (fio_touch(filename) != 0) {
             perror("Failed to create the file");
             pthread_exit(NULL);
         } else {
@@ -42,36 +54,31 @@ void *create_file(void *arg) {
 
 // ---------------- Producer Thread ----------------
 void *producer(void *arg) {
+    int id = (int)(intptr_t)arg;  // Producer index (counter shard)
     pthread_t thread_id = pthread_self();
     printf("Producer writing random integers to the file: %lu\n", (unsigned long)thread_id);
     fflush(stdout);
 
+    log_writer_t *w = writers[id];
+
     for (int i = 0; i < 5; i++) {
-        // Mutex: safely increment shared counter
-        pthread_mutex_lock(&counter_lock);
-        counter++;
-        int my_value = counter;
-        pthread_mutex_unlock(&counter_lock);
-
-        // Semaphore: protect file writing
-        sem_wait(&file_semaphore);
-        FILE *f = fopen(filename, "a");
-        if (f) {
-            fprintf(f, "%d\n", my_value);
-            fclose(f);
-        } else {
+        // Counter: unique ID from this producer's shard
+        int my_value = (int)counter_next(&counter, id);
+
+        // Append log: buffered in this thread, written in large batches
+        if (log_append_int(w, my_value) != 0)
             perror("Failed to append to file");
-        }
-        sem_post(&file_semaphore); // Release semaphore
     }
 
+    log_writer_close(w);
+
     // Mutex + Semaphore: signal consumer if last producer
-    pthread_mutex_lock(&producer_lock);
+    prof_mutex_lock(&producer_lock);
     producers_finished++;
     if (producers_finished == 3) {
-        sem_post(&producer_done); // Signal consumer
+        prof_sem_post(&producer_done); // Signal consumer
     }
-    pthread_mutex_unlock(&producer_lock);
+    prof_mutex_unlock(&producer_lock);
 
     pthread_exit(NULL);
 }
@@ -81,17 +88,15 @@ void *consumer(void *arg) {
     printf("Consumer reading the file contents:\n");
     fflush(stdout);
 
-    // Semaphore: wait until producers are done
-    sem_wait(&producer_done);
+    // Semaphore: wait until producers are done (all writers flushed)
+    prof_sem_wait(&producer_done);
 
-    // Semaphore: protect file reading
-    sem_wait(&file_semaphore);
-    if (system("cat empty_file.txt") != 0) {
+    // Copy the file to stdout in the kernel (sendfile/splice) instead of running 'cat'
+    fflush(stdout);
+    if (fio_dump(filename, STDOUT_FILENO) < 0) {
         perror("Failed to read the file contents");
-        sem_post(&file_semaphore);
         pthread_exit(NULL);
     }
-    sem_post(&file_semaphore); // Release semaphore
 
     pthread_exit(NULL);
 }
@@ -101,12 +106,11 @@ int main() {
     pthread_t create_thread, producer_thread[3], consumer_thread;
 
     // Initialize semaphores
-    sem_init(&file_semaphore, 0, 1); // Mutual exclusion for file
-    sem_init(&producer_done, 0, 0);  // Consumer waits
+    prof_sem_init(&producer_done, "producer_done", 0);  // Consumer waits
 
     // Initialize mutexes
-    pthread_mutex_init(&counter_lock, NULL);
-    pthread_mutex_init(&producer_lock, NULL);
+    counter_init(&counter, COUNTER_BACKEND, 3, COUNTER_BLOCK); // Counter
+    prof_mutex_init(&producer_lock, "producer_lock");
 
     // Create file
     if (pthread_create(&create_thread, NULL, create_file, NULL) != 0) {
@@ -115,9 +119,21 @@ int main() {
     }
     pthread_join(create_thread, NULL);
 
+    // Open the shared append log once for all producers
+    if (log_open(&data_log, filename, LOG_FLUSH_BYTES, LOG_FLUSH_MS, LOG_SYNC_POLICY) != 0)
+        return 1;
+
+    // Per-producer writers, opened up front: a producer that quit would never count as finished
+    for (int i = 0; i < 3; i++) {
+        if (!(writers[i] = log_writer_open(&data_log))) {
+            perror("Failed to open log writer");
+            return 1;
+        }
+    }
+
     // Start producers
     for (int i = 0; i < 3; i++) {
-        if (pthread_create(&producer_thread[i], NULL, producer, NULL) != 0) {
+        if (pthread_create(&producer_thread[i], NULL, producer, (void *)(intptr_t)i) != 0) {
             perror("Failed to create producer thread");
             return 1;
         }
@@ -137,10 +153,10 @@ int main() {
     pthread_join(consumer_thread, NULL);
 
     // Cleanup
-    sem_destroy(&file_semaphore);
-    sem_destroy(&producer_done);
-    pthread_mutex_destroy(&counter_lock);
-    pthread_mutex_destroy(&producer_lock);
+    log_close(&data_log);
+    prof_sem_destroy(&producer_done);
+    counter_destroy(&counter);
+    prof_mutex_destroy(&producer_lock);
 
     printf("Program completed successfully.\n");
     return 0;
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "mpsc_ring.h"
+#include "append_log.h"
+#include "shared_counter.h"
+
+// ---------------- Config ----------------
+#define NUM_PRODUCERS 3
+#define NUM_VALUES 5
+#define RING_CAPACITY 8       // Small on purpose: producers feel backpressure
+#define USE_FILE_SINK 1       // 1 = consumer also appends every value to the file
+const char *filename = "ring_file.txt";
+
+// ---------------- Lock-Free Ring ----------------
+mpsc_ring_t ring;             // Producers push, the consumer drains concurrently
+
+// ---------------- Shared Counter ----------------
+#define COUNTER_BACKEND COUNTER_SHARDED  // COUNTER_MUTEX / COUNTER_ATOMIC / COUNTER_SHARDED
+#define COUNTER_BLOCK NUM_VALUES         // IDs a producer reserves per refill (sharded)
+shared_counter_t counter;                // Shared counter between producers
+
+// ---------------- Shared Variables ----------------
+atomic_int producers_finished = 0;        // Producers that pushed all their values
+
+// ---------------- Optional File Sink ----------------
+append_log_t data_log;
+
+// ---------------- Producer Thread ----------------
+void *producer(void *arg) {
+    int id = (int)(intptr_t)arg;  // Producer index (counter shard)
+    pthread_t tid = pthread_self();
+    printf("Producer thread %lu started.\n", (unsigned long)tid);
+
+    for (int i = 0; i < NUM_VALUES; i++) {
+        // Counter: unique ID from this producer's shard
+        int my_value = (int)counter_next(&counter, id);
+
+        // Ring: hand the value straight to the consumer (no file round trip)
+        mpsc_ring_push(&ring, my_value);
+
+        usleep(10000); // simulate work
+    }
+
+    // Release: everything this producer pushed is visible before the count
+    atomic_fetch_add_explicit(&producers_finished, 1, memory_order_release);
+    pthread_exit(NULL);
+}
+
+// ---------------- Consumer Thread ----------------
+void *consumer(void *arg) {
+    long value;
+    int received = 0;
+    log_writer_t *w = USE_FILE_SINK ? log_writer_open(&data_log) : NULL;
+
+    printf("Consumer draining the ring while producers run:\n");
+    for (;;) {
+        if (mpsc_ring_pop(&ring, &value)) {
+            printf("%ld\n", value);
+            if (w)
+                log_append_int(w, (int)value);
+            received++;
+            continue;
+        }
+
+        // Empty: done only if every producer finished and nothing is left
+        if (atomic_load_explicit(&producers_finished, memory_order_acquire) == NUM_PRODUCERS) {
+            while (mpsc_ring_pop(&ring, &value)) {
+                printf("%ld\n", value);
+                if (w)
+                    log_append_int(w, (int)value);
+                received++;
+            }
+            break;
+        }
+        sched_yield();
+    }
+
+    if (w)
+        log_writer_close(w);
+    printf("Consumer received %d values.\n", received);
+    pthread_exit(NULL);
+}
+
+// ---------------- Main ----------------
+int main() {
+    pthread_t producers[NUM_PRODUCERS], consumer_thread;
+
+    // Initialize synchronization primitives
+    counter_init(&counter, COUNTER_BACKEND, NUM_PRODUCERS, COUNTER_BLOCK); // Counter
+    if (mpsc_ring_init(&ring, RING_CAPACITY) != 0) {
+        perror("Failed to allocate ring");
+        return 1;
+    }
+
+    // Optional file sink: clear it, then append through one shared log
+    if (USE_FILE_SINK) {
+        FILE *f = fopen(filename, "w");
+        if (f) fclose(f);
+        if (log_open(&data_log, filename, LOG_FLUSH_BYTES, LOG_FLUSH_MS, LOG_SYNC_NONE) != 0)
+            return 1;
+    }
+
+    // Start consumer first so it drains while producers are still pushing
+    pthread_create(&consumer_thread, NULL, consumer, NULL);
+    for (int i = 0; i < NUM_PRODUCERS; i++)
+        pthread_create(&producers[i], NULL, producer, (void *)(intptr_t)i);
+
+    // Wait for all threads
+    for (int i = 0; i < NUM_PRODUCERS; i++)
+        pthread_join(producers[i], NULL);
+    pthread_join(consumer_thread, NULL);
+
+    // Cleanup
+    if (USE_FILE_SINK)
+        log_close(&data_log);
+    mpsc_ring_destroy(&ring);
+    counter_destroy(&counter);
+
+    printf("Program completed successfully.\n");
+    return 0;
+}
@@ -1,15 +1,27 @@
+#define _GNU_SOURCE     // splice() in fast_io.h
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <time.h>
 #include <semaphore.h> // For semaphores
-
+#include <string.h>
+#include <stdint.h>
+#include "committed_file.h"
+#include "fast_io.h"
+#include "lock_profile.h"
+
+// ---------------- Config ----------------
+#define NUM_VALUES 10
+#define NUM_READERS 3
+#define COMMIT_BATCH 5   // Values per append + commit (readers see them together)
 const char *filename = "empty_file.txt";
 
 // ---------------- Semaphores ----------------
-sem_t file_semaphore;   // Protects file access (mutual exclusion)
-sem_t producer_done;    // Signals when producer has finished writing
+prof_sem_t file_semaphore; // Serializes writers only; readers never take it
+
+// ---------------- Committed File ----------------
+committed_file_t data_file;  // Writers append + publish the committed offset, readers pread up to it
 
 // ---------------- File Creation Thread ----------------
 void *create_file(void *arg) {
@@ -18,7 +30,7 @@ void *create_file(void *arg) {
 
     // Check if file exists
     if (access(filename, F_OK) != 0) {
-        if (system("touch empty_file.txt") != 0) {
+        if (fio_touch(filename) != 0) {
             perror("Failed to create the file");
             pthread_exit(NULL);
         } else {
@@ -35,69 +47,70 @@ void *create_file(void *arg) {
 
 // ---------------- Producer Thread ----------------
 void *producer(void *arg) {
-    printf("Producer writing random integers to the file using 'echo':\n");
+    printf("Producer writing random integers to the file:\n");
     fflush(stdout);
 
     srand(time(NULL)); // Seed random number generator
 
-    // Wait for access to the file (mutual exclusion)
-    sem_wait(&file_semaphore);
-
-    for (int i = 0; i < 10; i++) {
+    cf_batch_t batch = { .len = 0 };
+    for (int i = 0; i < NUM_VALUES; i++) {
         int random_num = rand() % 100; // Generate a random integer < 100
-        char command[100];
 
-        // Construct the echo command
-        snprintf(command, sizeof(command), "echo %d >> %s", random_num, filename);
+        // Batch: format locally, append + publish once per COMMIT_BATCH values
+        cf_batch_int(&batch, random_num);
+        if (batch.count < COMMIT_BATCH && i < NUM_VALUES - 1)
+            continue;
 
-        // Execute the command
-        if (system(command) != 0) {
+        // Writers: one at a time at the tail; readers keep streaming meanwhile
+        prof_sem_wait(&file_semaphore);
+        int rc = cf_append_batch(&data_file, &batch);  // Append, then publish the offset
+        prof_sem_post(&file_semaphore);
+        if (rc != 0) {
             perror("Failed to append random number to file");
-            sem_post(&file_semaphore); // Ensure semaphore is released
-            pthread_exit(NULL);
+            break;
         }
     }
 
-    // Signal that the producer is done
-    sem_post(&producer_done);
-
-    // Release the file semaphore after finishing writing
-    sem_post(&file_semaphore);
-
     pthread_exit(NULL);
 }
 
-// ---------------- Consumer Thread ----------------
-void *consumer(void *arg) {
-    printf("Consumer reading the file contents:\n");
-    fflush(stdout);
-
-    // Wait until producer signals that writing is done
-    sem_wait(&producer_done);
-
-    // Wait for access to the file (mutual exclusion)
-    sem_wait(&file_semaphore);
-
-    // Read and display file contents
-    if (system("cat empty_file.txt") != 0) {
-        perror("Failed to read the file contents");
-        sem_post(&file_semaphore); // Ensure semaphore is released
-        pthread_exit(NULL);
+// ---------------- Reader Threads ----------------
+void *reader(void *arg) {
+    int id = (int)(intptr_t)arg;
+    char buf[4096];
+    size_t have = 0;            // Bytes in buf, possibly ending in a partial line
+    long long pos = 0;          // This reader's offset in the file
+    int values = 0;
+    ssize_t n;
+
+    // Lock-free: stream everything up to the committed offset, wait for more
+    while ((n = cf_read_wait(&data_file, &pos, buf + have, sizeof(buf) - have - 1)) > 0) {
+        have += (size_t)n;
+        buf[have] = '\0';
+
+        char *line = buf, *nl;
+        while ((nl = strchr(line, '\n')) != NULL) {
+            *nl = '\0';
+            printf("Reader %d: %s\n", id, line);
+            values++;
+            line = nl + 1;
+        }
+        have -= (size_t)(line - buf);
+        memmove(buf, line, have);
     }
+    if (n < 0)
+        perror("Failed to read the file contents");
 
-    // Release file semaphore
-    sem_post(&file_semaphore);
-
+    printf("Reader %d read %d values.\n", id, values);
     pthread_exit(NULL);
 }
 
 // ---------------- Main Function ----------------
 int main() {
-    pthread_t create_thread, producer_thread, consumer_thread;
+    pthread_t create_thread, producer_thread, reader_thread[NUM_READERS];
 
     // Initialize semaphores
-    sem_init(&file_semaphore, 0, 1);  // Initialize to 1 for mutual exclusion
-    sem_init(&producer_done, 0, 0);   // Initialize to 0; consumer waits
+    prof_sem_init(&file_semaphore, "file_semaphore", 1);  // Initialize to 1 for mutual exclusion between writers
 
     // Create the file creation thread
     if (pthread_create(&create_thread, NULL, create_file, NULL) != 0) {
@@ -106,25 +119,34 @@ int main() {
     }
     pthread_join(create_thread, NULL); // Wait for file creation
 
+    // Open the shared file once for writers and readers
+    if (cf_open(&data_file, filename) != 0)
+        return 1;
+
     // Create the producer thread
     if (pthread_create(&producer_thread, NULL, producer, NULL) != 0) {
         perror("Failed to create producer thread");
         return 1;
     }
 
-    // Create the consumer thread
-    if (pthread_create(&consumer_thread, NULL, consumer, NULL) != 0) {
-        perror("Failed to create consumer thread");
-        return 1;
+    // Create the reader threads (they stream while the producer writes)
+    for (int i = 0; i < NUM_READERS; i++) {
+        if (pthread_create(&reader_thread[i], NULL, reader, (void *)(intptr_t)i) != 0) {
+            perror("Failed to create reader thread");
+            return 1;
+        }
     }
 
-    // Wait for threads to complete
+    // Producer done: readers drain the committed data and stop
     pthread_join(producer_thread, NULL);
-    pthread_join(consumer_thread, NULL);
+    cf_close_writers(&data_file);
+    for (int i = 0; i < NUM_READERS; i++)
+        pthread_join(reader_thread[i], NULL);
+
+    cf_close(&data_file);
 
     // Destroy semaphores
-    sem_destroy(&file_semaphore);
-    sem_destroy(&producer_done);
+    prof_sem_destroy(&file_semaphore);
 
     printf("Program completed successfully.\n");
     return 0;
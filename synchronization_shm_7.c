@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// Producers and the consumer run as separate processes attached to one POSIX
+// shared-memory segment. Records go through a ring inside the segment, guarded
+// by process-shared semaphores (free/filled slots) and a process-shared robust
+// mutex (ring indices); nothing touches the disk.
+//
+// Compile: gcc -O2 -pthread synchronization_shm_7.c -o synchronization_shm_7 -lrt
+// Run:     ./synchronization_shm_7                 fork NUM_PRODUCERS producers + consumer
+//          ./synchronization_shm_7 init [producers] create the segment
+//          ./synchronization_shm_7 producer         attach and produce NUM_VALUES records
+//          ./synchronization_shm_7 consumer         attach and consume until every producer ended
+//          ./synchronization_shm_7 unlink           remove the segment
+
+// ---------------- Config ----------------
+#define NUM_PRODUCERS 3
+#define NUM_VALUES 5
+#define RING_CAPACITY 64
+#define SHM_NAME "/sync_shm_ring"
+#define SHM_MAGIC 0x53484d52u    // "SHMR"
+
+// ---------------- Shared Segment ----------------
+typedef struct {
+    int producer;                // Producer index
+    int value;                   // Unique ID from the shared counter (-1 = producer finished)
+    uint64_t sent_ns;            // CLOCK_MONOTONIC when the producer queued it
+} shm_record_t;
+
+typedef struct {
+    uint32_t magic;
+    int num_producers;           // Producers the consumer waits for
+    atomic_int next_producer;    // Hands out producer indices
+    atomic_long counter;         // Shared counter between producers (lock-free across processes)
+
+    sem_t slots;                 // Free ring slots (pshared)
+    sem_t items;                 // Filled ring slots (pshared)
+    pthread_mutex_t lock;        // Protects head/tail (process-shared, robust)
+    int head, tail;
+    shm_record_t ring[RING_CAPACITY];
+} shm_segment_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Robust lock: if a process died while holding it, take over and continue
+static void ring_lock(shm_segment_t *seg) {
+    if (pthread_mutex_lock(&seg->lock) == EOWNERDEAD) {
+        fprintf(stderr, "Previous lock owner died; recovering ring lock\n");
+        pthread_mutex_consistent(&seg->lock);
+    }
+}
+
+static void ring_put(shm_segment_t *seg, shm_record_t rec) {
+    while (sem_wait(&seg->slots) != 0 && errno == EINTR)
+        ;
+    ring_lock(seg);
+    seg->ring[seg->tail] = rec;
+    seg->tail = (seg->tail + 1) % RING_CAPACITY;
+    pthread_mutex_unlock(&seg->lock);
+    sem_post(&seg->items);
+}
+
+static shm_record_t ring_get(shm_segment_t *seg) {
+    while (sem_wait(&seg->items) != 0 && errno == EINTR)
+        ;
+    ring_lock(seg);
+    shm_record_t rec = seg->ring[seg->head];
+    seg->head = (seg->head + 1) % RING_CAPACITY;
+    pthread_mutex_unlock(&seg->lock);
+    sem_post(&seg->slots);
+    return rec;
+}
+
+// ---------------- Segment Setup ----------------
+// Creates (or recreates) the segment and initializes the process-shared primitives
+static shm_segment_t *segment_create(int num_producers) {
+    shm_unlink(SHM_NAME);
+    int fd = shm_open(SHM_NAME, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        perror("shm_open");
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(shm_segment_t)) != 0) {
+        perror("ftruncate");
+        close(fd);
+        return NULL;
+    }
+    shm_segment_t *seg = mmap(NULL, sizeof(*seg), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (seg == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+
+    memset(seg, 0, sizeof(*seg));
+    seg->num_producers = num_producers;
+    atomic_init(&seg->next_producer, 0);
+    atomic_init(&seg->counter, 0);
+
+    sem_init(&seg->slots, 1, RING_CAPACITY);   // pshared = 1: usable from any process
+    sem_init(&seg->items, 1, 0);
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&seg->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    atomic_thread_fence(memory_order_release);
+    seg->magic = SHM_MAGIC;     // Attachers check this last
+    return seg;
+}
+
+static shm_segment_t *segment_attach(void) {
+    int fd = shm_open(SHM_NAME, O_RDWR, 0);
+    if (fd < 0) {
+        perror("shm_open (run 'init' first)");
+        return NULL;
+    }
+    shm_segment_t *seg = mmap(NULL, sizeof(*seg), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (seg == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+    if (seg->magic != SHM_MAGIC) {
+        fprintf(stderr, "Shared segment %s is not initialized\n", SHM_NAME);
+        munmap(seg, sizeof(*seg));
+        return NULL;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    return seg;
+}
+
+// ---------------- Producer Process ----------------
+static int run_producer(shm_segment_t *seg) {
+    int id = atomic_fetch_add(&seg->next_producer, 1);  // Producer index
+    printf("Producer process %d (index %d) started.\n", (int)getpid(), id);
+
+    for (int i = 0; i < NUM_VALUES; i++) {
+        // Counter: unique ID shared by every process
+        int my_value = (int)atomic_fetch_add(&seg->counter, 1) + 1;
+
+        // Ring: hand the record straight to the consumer process
+        ring_put(seg, (shm_record_t){ id, my_value, now_ns() });
+
+        usleep(10000); // Simulate work
+    }
+
+    ring_put(seg, (shm_record_t){ id, -1, now_ns() });   // This producer is done
+    return 0;
+}
+
+// ---------------- Consumer Process ----------------
+static int run_consumer(shm_segment_t *seg) {
+    int finished = 0, received = 0;
+    uint64_t total_ns = 0, max_ns = 0;
+
+    printf("Consumer process %d draining the shared ring:\n", (int)getpid());
+    while (finished < seg->num_producers) {
+        shm_record_t rec = ring_get(seg);
+        uint64_t latency = now_ns() - rec.sent_ns;
+        if (rec.value < 0) {
+            finished++;
+            continue;
+        }
+        printf("%d (producer %d)\n", rec.value, rec.producer);
+        received++;
+        total_ns += latency;
+        if (latency > max_ns)
+            max_ns = latency;
+    }
+
+    printf("Consumer received %d values, hand-off latency avg %.1f us, max %.1f us.\n",
+           received, received ? total_ns / 1000.0 / received : 0.0, max_ns / 1000.0);
+    return 0;
+}
+
+// ---------------- Main ----------------
+int main(int argc, char **argv) {
+    const char *role = argc > 1 ? argv[1] : "demo";
+    shm_segment_t *seg;
+
+    if (!strcmp(role, "init")) {
+        int n = argc > 2 ? atoi(argv[2]) : NUM_PRODUCERS;
+        if (n < 1 || !(seg = segment_create(n)))
+            return 1;
+        printf("Created %s for %d producers.\n", SHM_NAME, n);
+        munmap(seg, sizeof(*seg));
+        return 0;
+    }
+    if (!strcmp(role, "unlink"))
+        return shm_unlink(SHM_NAME) == 0 ? 0 : 1;
+    if (!strcmp(role, "producer") || !strcmp(role, "consumer")) {
+        if (!(seg = segment_attach()))
+            return 1;
+        int rc = role[0] == 'p' ? run_producer(seg) : run_consumer(seg);
+        munmap(seg, sizeof(*seg));
+        return rc;
+    }
+    if (strcmp(role, "demo") != 0) {
+        fprintf(stderr, "Usage: %s [demo | init [producers] | producer | consumer | unlink]\n", argv[0]);
+        return 1;
+    }
+
+    // Demo: one segment, NUM_PRODUCERS producer processes and one consumer process
+    if (!(seg = segment_create(NUM_PRODUCERS)))
+        return 1;
+    fflush(stdout);   // do not duplicate buffered output into the children
+
+    pid_t pids[NUM_PRODUCERS + 1];
+    for (int i = 0; i <= NUM_PRODUCERS; i++) {
+        pids[i] = fork();
+        if (pids[i] < 0) {
+            perror("fork");
+            return 1;
+        }
+        if (pids[i] == 0) {
+            int rc = i == NUM_PRODUCERS ? run_consumer(seg) : run_producer(seg);
+            fflush(stdout);
+            _exit(rc);
+        }
+    }
+
+    int failed = 0;
+    for (int i = 0; i <= NUM_PRODUCERS; i++) {
+        int status;
+        waitpid(pids[i], &status, 0);
+        failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+
+    printf("Final counter: %ld\n", atomic_load(&seg->counter));
+    sem_destroy(&seg->slots);
+    sem_destroy(&seg->items);
+    pthread_mutex_destroy(&seg->lock);
+    munmap(seg, sizeof(*seg));
+    shm_unlink(SHM_NAME);
+
+    printf(failed ? "A child process failed.\n" : "Program completed successfully.\n");
+    return failed;
+}
@@ -1,26 +1,44 @@
+#define _GNU_SOURCE     // splice() in fast_io.h
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <semaphore.h>
+#include "append_log.h"
+#include "fast_io.h"
+#include "lock_profile.h"
+#include "shared_counter.h"
+#include "trace.h"
+#include "work_queue.h"
+
+// ---------------- Config ----------------
+#define NUM_PRODUCERS 3
+#define NUM_VALUES 5
+#define NUM_CONSUMERS 2
+#define QUEUE_CAPACITY 4     // Small on purpose: producers feel backpressure
+#define CONSUMER_BATCH 4     // Items a consumer takes per lock acquisition
 
 // ---------------- File ----------------
 const char *filename = "empty_file.txt";
 
-// ---------------- Semaphores ----------------
-sem_t file_semaphore;      // Protects file access (mutual exclusion)
+// ---------------- Append Log ----------------
+append_log_t data_log;                  // One shared fd, per-consumer buffers
+log_writer_t *writers[NUM_CONSUMERS];   // One per consumer, opened by main
 
-// ---------------- Mutex ----------------
-pthread_mutex_t counter_lock;  // Protects shared counter
-pthread_mutex_t producer_lock; // Protects producers_finished & ready
+// ---------------- Shared Counter ----------------
+#define COUNTER_BACKEND COUNTER_SHARDED  // COUNTER_MUTEX / COUNTER_ATOMIC / COUNTER_SHARDED
+#define COUNTER_BLOCK NUM_VALUES         // IDs a producer reserves per refill (sharded)
+shared_counter_t counter;                // Shared counter between producers
+
+// ---------------- Work Queue ----------------
+work_queue_t queue;            // Mutex + not_empty/not_full condition variables
 
-// ---------------- Condition Variable ----------------
-pthread_cond_t cond_var;       // Consumer waits until producers finish
+// ---------------- Mutex ----------------
+prof_mutex_t producer_lock; // Protects producers_finished
 
 // ---------------- Shared Variables ----------------
-int counter = 0;                 // Shared counter between producers
 int producers_finished = 0;      // Number of finished producers
-int ready = 0;                   // Flag to indicate all producers finished
 
 // ---------------- File Creation Thread ----------------
 void *create_file(void *arg) {
@@ -28,7 +46,7 @@ void *create_file(void *arg) {
     fflush(stdout);
 
     if (access(filename, F_OK) != 0) {
-        if (system("touch empty_file.txt") != 0) {
+        if (fio_touch(filename) != 0) {
             perror("Failed to create the file");
             pthread_exit(NULL);
         } else {
@@ -45,77 +63,69 @@ void *create_file(void *arg) {
 
 // ---------------- Producer Thread ----------------
 void *producer(void *arg) {
+    int id = (int)(intptr_t)arg;  // Producer index (counter shard)
     pthread_t thread_id = pthread_self();
     printf("Producer writing random integers: %lu\n", (unsigned long)thread_id);
     fflush(stdout);
 
-    for (int i = 0; i < 5; i++) {
-        // Mutex: safely increment shared counter
-        pthread_mutex_lock(&counter_lock);
-        counter++;
-        int my_value = counter;
-        pthread_mutex_unlock(&counter_lock);
-
-        // Semaphore: safely write to file
-        sem_wait(&file_semaphore);
-        FILE *f = fopen(filename, "a");
-        if (f) {
-            fprintf(f, "%d\n", my_value);
-            fclose(f);
-        } else {
-            perror("Failed to append to file");
-        }
-        sem_post(&file_semaphore);
+    for (int i = 0; i < NUM_VALUES; i++) {
+        // Counter: unique ID from this producer's shard
+        int my_value = (int)counter_next(&counter, id);
+
+        // Work queue: hand the value to whichever consumer is free (blocks while full)
+        wq_push(&queue, my_value);
     }
 
-    // Mutex + Condition Variable: signal consumer if last producer
-    pthread_mutex_lock(&producer_lock);
+    // Mutex: the last producer closes the queue so the consumers can finish
+    prof_mutex_lock(&producer_lock);
     producers_finished++;
-    if (producers_finished == 3) {
-        ready = 1;
-        pthread_cond_signal(&cond_var);
-    }
-    pthread_mutex_unlock(&producer_lock);
+    if (producers_finished == NUM_PRODUCERS)
+        wq_close(&queue);
+    prof_mutex_unlock(&producer_lock);
 
     pthread_exit(NULL);
 }
 
 // ---------------- Consumer Thread ----------------
 void *consumer(void *arg) {
-    printf("Consumer reading the file contents:\n");
-    fflush(stdout);
-
-    // Mutex + Condition Variable: wait until all producers finish
-    pthread_mutex_lock(&producer_lock);
-    while (!ready) {
-        pthread_cond_wait(&cond_var, &producer_lock);
-    }
-    pthread_mutex_unlock(&producer_lock);
-
-    // Read file contents (no semaphore needed; producers handled writes)
-    FILE *f = fopen(filename, "r");
-    if (f) {
-        int value;
-        while (fscanf(f, "%d", &value) == 1) {
-            printf("%d\n", value);
+    int id = (int)(intptr_t)arg;
+    long batch[CONSUMER_BATCH];
+    size_t n;
+    int processed = 0;
+
+    log_writer_t *w = writers[id];
+
+    // Work queue: process values while the producers are still running
+    while ((n = wq_pop_batch(&queue, batch, CONSUMER_BATCH)) > 0) {
+        TRACE_COUNTER("consumer batch", n);
+        flockfile(stdout);   // keep one batch together in the output
+        for (size_t i = 0; i < n; i++) {
+            printf("Consumer %d: %ld\n", id, batch[i]);
+
+            // Append log: buffered in this thread, written in large batches
+            if (log_append_int(w, (int)batch[i]) != 0)
+                perror("Failed to append to file");
         }
-        fclose(f);
-    } else {
-        perror("Failed to read the file contents");
+        funlockfile(stdout);
+        processed += (int)n;
     }
 
+    log_writer_close(w);
+    printf("Consumer %d processed %d values.\n", id, processed);
     pthread_exit(NULL);
 }
 
 // ---------------- Main Function ----------------
 int main() {
-    pthread_t create_thread, producer_thread[3], consumer_thread;
+    pthread_t create_thread, producer_thread[NUM_PRODUCERS], consumer_thread[NUM_CONSUMERS];
 
     // Initialize synchronization primitives
-    sem_init(&file_semaphore, 0, 1);       // Semaphore
-    pthread_mutex_init(&counter_lock, NULL);  // Mutex
-    pthread_mutex_init(&producer_lock, NULL); // Mutex
-    pthread_cond_init(&cond_var, NULL);       // Condition Variable
+    counter_init(&counter, COUNTER_BACKEND, NUM_PRODUCERS, COUNTER_BLOCK); // Counter
+    prof_mutex_init(&producer_lock, "producer_lock"); // Mutex
+    if (wq_init(&queue, QUEUE_CAPACITY) != 0) { // Work queue
+        perror("Failed to allocate work queue");
+        return 1;
+    }
 
     // Create file
     if (pthread_create(&create_thread, NULL, create_file, NULL) != 0) {
@@ -124,32 +134,47 @@ int main() {
     }
     pthread_join(create_thread, NULL);
 
-    // Start producer threads
-    for (int i = 0; i < 3; i++) {
-        if (pthread_create(&producer_thread[i], NULL, producer, NULL) != 0) {
-            perror("Failed to create producer thread");
+    // Open the shared append log once for all consumers
+    if (log_open(&data_log, filename, LOG_FLUSH_BYTES, LOG_FLUSH_MS, LOG_SYNC_POLICY) != 0)
+        return 1;
+
+    // Per-consumer writers, opened up front: a consumer that quit could block the producers
+    for (int i = 0; i < NUM_CONSUMERS; i++) {
+        if (!(writers[i] = log_writer_open(&data_log))) {
+            perror("Failed to open log writer");
             return 1;
         }
     }
 
-    // Start consumer thread
-    if (pthread_create(&consumer_thread, NULL, consumer, NULL) != 0) {
-        perror("Failed to create consumer thread");
-        return 1;
+    // Start consumer threads first so they drain while producers are still pushing
+    for (int i = 0; i < NUM_CONSUMERS; i++) {
+        if (pthread_create(&consumer_thread[i], NULL, consumer, (void *)(intptr_t)i) != 0) {
+            perror("Failed to create consumer thread");
+            return 1;
+        }
+    }
+
+    // Start producer threads
+    for (int i = 0; i < NUM_PRODUCERS; i++) {
+        if (pthread_create(&producer_thread[i], NULL, producer, (void *)(intptr_t)i) != 0) {
+            perror("Failed to create producer thread");
+            return 1;
+        }
     }
 
     // Wait for producer threads
-    for (int i = 0; i < 3; i++)
+    for (int i = 0; i < NUM_PRODUCERS; i++)
         pthread_join(producer_thread[i], NULL);
 
-    // Wait for consumer thread
-    pthread_join(consumer_thread, NULL);
+    // Wait for consumer threads
+    for (int i = 0; i < NUM_CONSUMERS; i++)
+        pthread_join(consumer_thread[i], NULL);
 
     // Cleanup synchronization primitives
-    sem_destroy(&file_semaphore);
-    pthread_mutex_destroy(&counter_lock);
-    pthread_mutex_destroy(&producer_lock);
-    pthread_cond_destroy(&cond_var);
+    log_close(&data_log);
+    counter_destroy(&counter);
+    prof_mutex_destroy(&producer_lock);
+    wq_destroy(&queue);
 
     printf("Program completed successfully.\n");
     return 0;
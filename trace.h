@@ -0,0 +1,203 @@
+// trace.h
+// Lightweight hot-path tracing with Chrome / Perfetto JSON export.
+//
+// Every thread records into its own ring of fixed-size events (no locks, no
+// stdio on the hot path); timestamps come from rdtsc on x86 (clock_gettime
+// elsewhere) and are converted to microseconds only when the trace is written.
+// At exit the rings are dumped to $TRACE_FILE (default "trace.json"), which
+// chrome://tracing and ui.perfetto.dev open directly. When a ring wraps, the
+// oldest events are dropped.
+//
+// Tracing is compiled in only with -DTRACE_EVENTS; otherwise every macro below
+// expands to nothing (or to the plain lock call it wraps).
+//
+//   TRACE_BEGIN(name) / TRACE_END(name)    nested slice on the calling thread
+//   TRACE_INSTANT(name)                    point event
+//   TRACE_COUNTER(name, value)             counter track
+//   TRACE_WAIT_BEGIN(name) / TRACE_WAIT_END(name)   "wait name" slice
+//   TRACE_MUTEX_LOCK(m, name)              pthread_mutex_lock + "wait name" slice,
+//   TRACE_MUTEX_UNLOCK(m, name)            then a "name" slice while it is held
+//   TRACE_SEM_WAIT(s, name) / TRACE_SEM_POST(s, name)   same for a semaphore
+// Names must be string literals (only the pointer is stored).
+//
+// Compile: gcc -O2 -DTRACE_EVENTS ...    Run: TRACE_FILE=run.json ./prog
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef TRACE_EVENTS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifndef TRACE_RING_EVENTS
+#define TRACE_RING_EVENTS (1 << 16)   // events kept per thread (power of two)
+#endif
+
+typedef struct {
+    uint64_t ts;           // raw timestamp (trace_now)
+    const char *name;
+    int64_t value;         // counter value
+    char ph;               // 'B', 'E', 'i', 'C' (Chrome phase)
+    char wait;             // 1 = "wait <name>" slice
+} trace_event_t;
+
+typedef struct trace_buffer {
+    struct trace_buffer *next;
+    long tid;
+    uint64_t count;        // events ever recorded (ring index = count % size)
+    trace_event_t ev[TRACE_RING_EVENTS];
+} trace_buffer_t;
+
+static _Atomic(trace_buffer_t *) trace_buffers;   // every thread's ring
+static __thread trace_buffer_t *trace_local;
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static uint64_t trace_ts0, trace_ns0;              // calibration start
+
+static inline uint64_t trace_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t trace_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return trace_clock_ns();
+#endif
+}
+
+// Writes every ring as Chrome trace JSON (registered with atexit)
+static void trace_dump(void) {
+    // Calibrate ticks -> ns over the whole run (at least 5 ms)
+    uint64_t ns1 = trace_clock_ns();
+    while (ns1 - trace_ns0 < 5000000)
+        ns1 = trace_clock_ns();
+    uint64_t ts1 = trace_now();
+    double ns_per_tick = (double)(ns1 - trace_ns0) / (double)(ts1 - trace_ts0);
+
+    const char *path = getenv("TRACE_FILE");
+    FILE *f = fopen(path ? path : "trace.json", "w");
+    if (!f) {
+        perror("trace: cannot write trace file");
+        return;
+    }
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    int first = 1, pid = (int)getpid();
+    long total = 0;
+    for (trace_buffer_t *b = atomic_load(&trace_buffers); b; b = b->next) {
+        uint64_t start = b->count > TRACE_RING_EVENTS ? b->count - TRACE_RING_EVENTS : 0;
+        int depth = 0;
+        for (uint64_t i = start; i < b->count; ++i) {
+            trace_event_t *e = &b->ev[i & (TRACE_RING_EVENTS - 1)];
+            if (e->ph == 'B')
+                depth++;
+            else if (e->ph == 'E' && depth-- == 0) {
+                depth = 0;   // its begin was overwritten when the ring wrapped
+                continue;
+            }
+            double us = (double)(int64_t)(e->ts - trace_ts0) * ns_per_tick / 1000.0;
+            fprintf(f, "%s{\"name\":\"%s%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%ld",
+                    first ? "" : ",\n", e->wait ? "wait " : "", e->name, e->ph, us, pid, b->tid);
+            if (e->ph == 'C')
+                fprintf(f, ",\"args\":{\"value\":%lld}", (long long)e->value);
+            else if (e->ph == 'i')
+                fprintf(f, ",\"s\":\"t\"");
+            fprintf(f, "}");
+            first = 0;
+            total++;
+        }
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    fprintf(stderr, "trace: %ld events written to %s\n", total, path ? path : "trace.json");
+}
+
+static void trace_start(void) {
+    trace_ns0 = trace_clock_ns();
+    trace_ts0 = trace_now();
+    atexit(trace_dump);
+}
+
+// The calling thread's ring (allocated and registered on first use)
+static inline trace_buffer_t *trace_buffer(void) {
+    if (__builtin_expect(trace_local != NULL, 1))
+        return trace_local;
+    pthread_once(&trace_once, trace_start);
+    trace_buffer_t *b = calloc(1, sizeof(*b));
+    if (!b)
+        abort();
+    b->tid = syscall(SYS_gettid);
+    b->next = atomic_load(&trace_buffers);
+    while (!atomic_compare_exchange_weak(&trace_buffers, &b->next, b))
+        ;
+    trace_local = b;
+    return b;
+}
+
+static inline void trace_record(char ph, const char *name, int64_t value, char wait) {
+    trace_buffer_t *b = trace_buffer();
+    trace_event_t *e = &b->ev[b->count & (TRACE_RING_EVENTS - 1)];
+    e->ts = trace_now();
+    e->name = name;
+    e->value = value;
+    e->ph = ph;
+    e->wait = wait;
+    b->count++;
+}
+
+#define TRACE_BEGIN(name)          trace_record('B', (name), 0, 0)
+#define TRACE_END(name)            trace_record('E', (name), 0, 0)
+#define TRACE_INSTANT(name)        trace_record('i', (name), 0, 0)
+#define TRACE_COUNTER(name, value) trace_record('C', (name), (int64_t)(value), 0)
+#define TRACE_WAIT_BEGIN(name)     trace_record('B', (name), 0, 1)
+#define TRACE_WAIT_END(name)       trace_record('E', (name), 0, 1)
+
+#define TRACE_MUTEX_LOCK(m, name) do {          \
+        trace_record('B', (name), 0, 1);        \
+        pthread_mutex_lock(m);                  \
+        trace_record('E', (name), 0, 1);        \
+        trace_record('B', (name), 0, 0);        \
+    } while (0)
+#define TRACE_MUTEX_UNLOCK(m, name) do {        \
+        trace_record('E', (name), 0, 0);        \
+        pthread_mutex_unlock(m);                \
+    } while (0)
+#define TRACE_SEM_WAIT(s, name) do {            \
+        trace_record('B', (name), 0, 1);        \
+        sem_wait(s);                            \
+        trace_record('E', (name), 0, 1);        \
+        trace_record('B', (name), 0, 0);        \
+    } while (0)
+#define TRACE_SEM_POST(s, name) do {            \
+        trace_record('E', (name), 0, 0);        \
+        sem_post(s);                            \
+    } while (0)
+
+#else // !TRACE_EVENTS: no code, no data
+
+#define TRACE_BEGIN(name)           ((void)0)
+#define TRACE_END(name)             ((void)0)
+#define TRACE_INSTANT(name)         ((void)0)
+#define TRACE_COUNTER(name, value)  ((void)0)
+#define TRACE_WAIT_BEGIN(name)      ((void)0)
+#define TRACE_WAIT_END(name)        ((void)0)
+#define TRACE_MUTEX_LOCK(m, name)   pthread_mutex_lock(m)
+#define TRACE_MUTEX_UNLOCK(m, name) pthread_mutex_unlock(m)
+#define TRACE_SEM_WAIT(s, name)     sem_wait(s)
+#define TRACE_SEM_POST(s, name)     sem_post(s)
+
+#endif // TRACE_EVENTS
+
+#endif // TRACE_H
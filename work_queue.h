@@ -0,0 +1,114 @@
+// work_queue.h
+// Bounded multi-producer / multi-consumer work queue: one mutex, two condition
+// variables, batch dequeue.
+//
+// Producers block while the queue is full (backpressure); consumers take up to
+// 'max' items per lock acquisition. Waiters only ever sleep in the two extreme
+// states (empty for consumers, full for producers), so the queue broadcasts only
+// when it leaves one of them: empty -> non-empty wakes the consumers, full ->
+// not-full wakes the producers. Every other push/pop skips the condvar entirely.
+// wq_close() wakes everybody; consumers drain what is left and then get 0.
+//
+// Usage:
+//   work_queue_t q;
+//   wq_init(&q, 1024);
+//   wq_push(&q, value);                   // producers (blocks while full)
+//   n = wq_pop_batch(&q, items, 32);      // consumers (blocks while empty; 0 = closed)
+//   wq_close(&q);                         // after the last producer finished
+//   wq_destroy(&q);
+
+#ifndef WORK_QUEUE_H
+#define WORK_QUEUE_H
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "lock_profile.h"
+
+typedef struct {
+    prof_mutex_t lock;            // "work_queue" in lock profiles
+    prof_cond_t not_empty;        // Consumers wait here while count == 0
+    prof_cond_t not_full;         // Producers wait here while count == capacity
+    long *items;
+    size_t capacity, head, count;
+    int closed;
+
+    long long pushes, pops, batches;   // stats (guarded by lock)
+    long long full_waits, empty_waits;
+} work_queue_t;
+
+// Returns 0 on success, -1 if the buffer cannot be allocated
+static inline int wq_init(work_queue_t *q, size_t capacity) {
+    q->items = malloc(sizeof(long) * (capacity ? capacity : 1));
+    if (!q->items)
+        return -1;
+    q->capacity = capacity ? capacity : 1;
+    q->head = q->count = 0;
+    q->closed = 0;
+    q->pushes = q->pops = q->batches = q->full_waits = q->empty_waits = 0;
+    prof_mutex_init(&q->lock, "work_queue");
+    prof_cond_init(&q->not_empty, "wq not_empty");
+    prof_cond_init(&q->not_full, "wq not_full");
+    return 0;
+}
+
+static inline void wq_destroy(work_queue_t *q) {
+    prof_mutex_destroy(&q->lock);
+    prof_cond_destroy(&q->not_empty);
+    prof_cond_destroy(&q->not_full);
+    free(q->items);
+    q->items = NULL;
+}
+
+// Producer side: blocks while full. Returns 0, or -1 if the queue was closed.
+static inline int wq_push(work_queue_t *q, long value) {
+    prof_mutex_lock(&q->lock);
+    while (q->count == q->capacity && !q->closed) {
+        q->full_waits++;
+        prof_cond_wait(&q->not_full, &q->lock);
+    }
+    if (q->closed) {
+        prof_mutex_unlock(&q->lock);
+        return -1;
+    }
+    q->items[(q->head + q->count) % q->capacity] = value;
+    q->count++;
+    q->pushes++;
+    if (q->count == 1)
+        prof_cond_broadcast(&q->not_empty);   // empty -> non-empty
+    prof_mutex_unlock(&q->lock);
+    return 0;
+}
+
+// Consumer side: blocks while empty, then takes up to max items in FIFO order.
+// Returns the number taken; 0 only once the queue is closed and drained.
+static inline size_t wq_pop_batch(work_queue_t *q, long *out, size_t max) {
+    prof_mutex_lock(&q->lock);
+    while (q->count == 0 && !q->closed) {
+        q->empty_waits++;
+        prof_cond_wait(&q->not_empty, &q->lock);
+    }
+    int was_full = q->count == q->capacity;
+    size_t n = q->count < max ? q->count : max;
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = q->items[q->head];
+        q->head = (q->head + 1) % q->capacity;
+    }
+    q->count -= n;
+    q->pops += (long long)n;
+    q->batches += n > 0;
+    if (was_full && n > 0)
+        prof_cond_broadcast(&q->not_full);    // full -> not full
+    prof_mutex_unlock(&q->lock);
+    return n;
+}
+
+// No more pushes: wakes every waiter; consumers still drain the remaining items
+static inline void wq_close(work_queue_t *q) {
+    prof_mutex_lock(&q->lock);
+    q->closed = 1;
+    prof_cond_broadcast(&q->not_empty);
+    prof_cond_broadcast(&q->not_full);
+    prof_mutex_unlock(&q->lock);
+}
+
+#endif // WORK_QUEUE_H
@@ -0,0 +1,564 @@
+// ws_runtime.h
+// Small work-stealing task runtime, an alternative backend to OpenMP tasks
+// whose scheduling can be tuned and observed.
+//
+// Every worker owns a Chase-Lev deque (Le et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models", C11 atomics): the owner pushes and
+// takes at the bottom without a CAS except on the last element, thieves CAS
+// the top. The array doubles when full; replaced arrays are kept until the
+// pool is destroyed, since a thief may still be reading one.
+//
+// Tasks are spawned into a frame (the scope a sync waits for, like an OpenMP
+// taskgroup). ws_sync() never blocks the worker: until the frame's children
+// are done it keeps running tasks, its own newest first, then stolen ones, so
+// the code after ws_sync() is the continuation. (Stealing the continuation
+// itself, as Cilk does, needs compiler support; helping keeps every worker
+// busy without it.) ws_submit() additionally takes handles of earlier tasks:
+// the new task is only pushed once all of them have finished, which covers
+// what 'depend' is used for here (in/out chains on one task's result).
+//
+// Idle workers steal from random victims, spinning with pause and then
+// yielding; between ws_run() calls they sleep on a condition variable. Each
+// worker counts tasks, steals, failed steal attempts and the time it had
+// nothing to run; ws_pool_report() prints them per worker.
+//
+// Usage:
+//   ws_pool_t *pool = ws_pool_create(nthreads);
+//   ws_run(pool, root, &arg);                 // caller is worker 0; returns when all tasks are done
+//   // inside a task:
+//   ws_frame_t fr;
+//   ws_frame_init(&fr);
+//   ws_spawn(&fr, fn, &args, sizeof(args));   // args are copied (up to WS_ARG_SIZE bytes)
+//   ws_task_t *t = ws_submit(&fr, fn, &args, sizeof(args), deps, ndeps);   // after deps; a handle
+//   ws_release(t);                            // once no later task needs it as a dependency
+//   ws_sync(&fr);
+//   ws_pool_report(pool, stderr);
+//   ws_pool_destroy(pool);
+//
+// Programs pick the backend with ws_select_runtime(): $TASK_RUNTIME = "omp" or
+// "ws"; the default is "omp", or "ws" when built with -DUSE_WS_RUNTIME.
+
+#ifndef WS_RUNTIME_H
+#define WS_RUNTIME_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define WS_ARG_SIZE 96          // bytes of arguments copied into a task
+#define WS_DEQUE_INIT 256       // initial deque slots (power of two)
+#define WS_DEQUE_GROWTHS 48     // replaced arrays kept per deque
+#define WS_SPIN 128             // failed steal rounds before yielding the CPU
+
+#define TASK_RUNTIME_OMP 0
+#define TASK_RUNTIME_WS 1
+
+typedef void (*ws_fn_t)(void *arg);
+
+typedef struct {
+    atomic_long pending;                // children submitted and not yet finished
+} ws_frame_t;
+
+typedef struct ws_task {
+    ws_fn_t fn;
+    ws_frame_t *frame;
+    atomic_int preds;                   // unfinished dependencies (+1 while being submitted)
+    atomic_int refs;                    // the runtime's, plus the caller's handle
+    atomic_flag lock;                   // guards done / succ
+    int done;
+    struct ws_task **succ;              // tasks waiting for this one
+    int nsucc, succ_cap;
+    _Alignas(16) unsigned char arg[WS_ARG_SIZE];
+} ws_task_t;
+
+typedef struct {
+    long mask;                          // slots - 1
+    _Atomic(ws_task_t *) slot[];
+} ws_array_t;
+
+typedef struct {
+    _Alignas(64) atomic_long top;       // thieves
+    _Alignas(64) atomic_long bottom;    // owner
+    _Atomic(ws_array_t *) array;
+    ws_array_t *retired[WS_DEQUE_GROWTHS];
+    int nretired;
+} ws_deque_t;
+
+struct ws_pool;
+
+typedef struct {
+    ws_deque_t dq;
+    struct ws_pool *pool;
+    int id;
+    pthread_t thread;
+    unsigned seed;                      // victim selection
+    double idle_since;                  // > 0 while it has nothing to run
+    // statistics (owner writes only)
+    long long tasks, steals, steal_fails;
+    double idle_s;
+} ws_worker_t;
+
+typedef struct ws_pool {
+    int nworkers;
+    ws_worker_t *workers;               // [0] is the thread calling ws_run()
+    atomic_long live;                   // tasks submitted and not yet finished
+    atomic_int running;                 // a ws_run() is in progress
+    atomic_int active;                  // workers inside the run loop
+    int shutdown;
+    unsigned generation;                // bumped by every ws_run()
+    pthread_mutex_t lock;               // guards generation / shutdown
+    pthread_cond_t wake;
+    double run_s;                       // wall time inside ws_run()
+} ws_pool_t;
+
+typedef struct {
+    long long tasks, steals, steal_fails;
+    double idle_s, run_s;
+    int workers;
+} ws_stats_t;
+
+static __thread ws_worker_t *ws_self;
+
+static inline double ws_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline void ws_relax(int *spins) {
+    if (++*spins < WS_SPIN) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        __asm__ __volatile__("yield");
+#endif
+    } else {
+        sched_yield();
+    }
+}
+
+// Returns TASK_RUNTIME_OMP or TASK_RUNTIME_WS from $TASK_RUNTIME
+static inline int ws_select_runtime(void) {
+    const char *name = getenv("TASK_RUNTIME");
+    if (name && strcmp(name, "ws") == 0)
+        return TASK_RUNTIME_WS;
+    if (name && strcmp(name, "omp") == 0)
+        return TASK_RUNTIME_OMP;
+#ifdef USE_WS_RUNTIME
+    return TASK_RUNTIME_WS;
+#else
+    return TASK_RUNTIME_OMP;
+#endif
+}
+
+// ---------------- Chase-Lev Deque ----------------
+static inline ws_array_t *ws_array_new(long slots) {
+    ws_array_t *a = malloc(sizeof(*a) + (size_t)slots * sizeof(a->slot[0]));
+    if (a)
+        a->mask = slots - 1;
+    return a;
+}
+
+static inline int ws_deque_init(ws_deque_t *d) {
+    atomic_init(&d->top, 0);
+    atomic_init(&d->bottom, 0);
+    ws_array_t *a = ws_array_new(WS_DEQUE_INIT);
+    atomic_init(&d->array, a);
+    d->nretired = 0;
+    return a ? 0 : -1;
+}
+
+static inline void ws_deque_destroy(ws_deque_t *d) {
+    for (int i = 0; i < d->nretired; ++i)
+        free(d->retired[i]);
+    free(atomic_load(&d->array));
+}
+
+// Owner only
+static inline void ws_deque_push(ws_deque_t *d, ws_task_t *t) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&d->top, memory_order_acquire);
+    ws_array_t *a = atomic_load_explicit(&d->array, memory_order_relaxed);
+    if (b - top > a->mask) {
+        ws_array_t *n = d->nretired < WS_DEQUE_GROWTHS ? ws_array_new((a->mask + 1) * 2) : NULL;
+        if (!n) {
+            perror("ws deque");
+            abort();
+        }
+        for (long i = top; i < b; ++i)
+            atomic_store_explicit(&n->slot[i & n->mask],
+                                  atomic_load_explicit(&a->slot[i & a->mask], memory_order_relaxed),
+                                  memory_order_relaxed);
+        d->retired[d->nretired++] = a;
+        atomic_store_explicit(&d->array, n, memory_order_release);
+        a = n;
+    }
+    atomic_store_explicit(&a->slot[b & a->mask], t, memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_release);   // publishes the task to thieves
+}
+
+// Owner only: newest task, or NULL
+static inline ws_task_t *ws_deque_take(ws_deque_t *d) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    ws_array_t *a = atomic_load_explicit(&d->array, memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long top = atomic_load_explicit(&d->top, memory_order_relaxed);
+    ws_task_t *t = NULL;
+    if (top <= b) {
+        t = atomic_load_explicit(&a->slot[b & a->mask], memory_order_relaxed);
+        if (top == b) {
+            // last one: race the thieves for it
+            if (!atomic_compare_exchange_strong_explicit(&d->top, &top, top + 1, memory_order_seq_cst,
+                                                         memory_order_relaxed))
+                t = NULL;
+            atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return t;
+}
+
+// Any thread: oldest task, or NULL (empty, or lost a race)
+static inline ws_task_t *ws_deque_steal(ws_deque_t *d) {
+    long top = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (top >= b)
+        return NULL;
+    ws_array_t *a = atomic_load_explicit(&d->array, memory_order_acquire);
+    ws_task_t *t = atomic_load_explicit(&a->slot[top & a->mask], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &top, top + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed))
+        return NULL;
+    return t;
+}
+
+// ---------------- Tasks ----------------
+static inline void ws_frame_init(ws_frame_t *fr) {
+    atomic_init(&fr->pending, 0);
+}
+
+static inline int ws_worker_id(void) {
+    return ws_self ? ws_self->id : 0;
+}
+
+// Drops a handle returned by ws_submit()
+static inline void ws_release(ws_task_t *t) {
+    if (t && atomic_fetch_sub_explicit(&t->refs, 1, memory_order_acq_rel) == 1) {
+        free(t->succ);
+        free(t);
+    }
+}
+
+static inline void ws_task_lock(ws_task_t *t) {
+    int spins = 0;
+    while (atomic_flag_test_and_set_explicit(&t->lock, memory_order_acquire))
+        ws_relax(&spins);
+}
+
+static inline void ws_task_unlock(ws_task_t *t) {
+    atomic_flag_clear_explicit(&t->lock, memory_order_release);
+}
+
+// Submits fn(copy of arg) to run once every task in deps (NULL entries are
+// skipped) has finished. Returns a handle for later dependencies if want_handle.
+// Must be called from a task (or the ws_run() root).
+static inline ws_task_t *ws_submit_task(ws_frame_t *fr, ws_fn_t fn, const void *arg, size_t size,
+                                        ws_task_t *const *deps, int ndeps, int want_handle) {
+    ws_worker_t *w = ws_self;
+    ws_task_t *t = malloc(sizeof(*t));
+    if (!t || size > WS_ARG_SIZE || !w) {
+        fprintf(stderr, "ws_submit: %s\n", !w ? "not on a worker" : size > WS_ARG_SIZE ? "arguments too large"
+                                                                                       : "out of memory");
+        abort();
+    }
+    t->fn = fn;
+    t->frame = fr;
+    atomic_init(&t->preds, 1);
+    atomic_init(&t->refs, want_handle ? 2 : 1);
+    atomic_flag_clear(&t->lock);
+    t->done = 0;
+    t->succ = NULL;
+    t->nsucc = t->succ_cap = 0;
+    memcpy(t->arg, arg, size);
+    atomic_fetch_add_explicit(&fr->pending, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&w->pool->live, 1, memory_order_relaxed);
+
+    for (int i = 0; i < ndeps; ++i) {
+        ws_task_t *d = deps[i];
+        if (!d)
+            continue;
+        ws_task_lock(d);
+        if (!d->done) {
+            if (d->nsucc == d->succ_cap) {
+                int cap = d->succ_cap ? d->succ_cap * 2 : 4;
+                ws_task_t **p = realloc(d->succ, (size_t)cap * sizeof(*p));
+                if (!p) {
+                    perror("ws_submit");
+                    abort();
+                }
+                d->succ = p;
+                d->succ_cap = cap;
+            }
+            d->succ[d->nsucc++] = t;
+            atomic_fetch_add_explicit(&t->preds, 1, memory_order_relaxed);
+        }
+        ws_task_unlock(d);
+    }
+    if (atomic_fetch_sub_explicit(&t->preds, 1, memory_order_acq_rel) == 1)
+        ws_deque_push(&w->dq, t);
+    return want_handle ? t : NULL;
+}
+
+static inline ws_task_t *ws_submit(ws_frame_t *fr, ws_fn_t fn, const void *arg, size_t size,
+                                   ws_task_t *const *deps, int ndeps) {
+    return ws_submit_task(fr, fn, arg, size, deps, ndeps, 1);
+}
+
+static inline void ws_spawn(ws_frame_t *fr, ws_fn_t fn, const void *arg, size_t size) {
+    ws_submit_task(fr, fn, arg, size, NULL, 0, 0);
+}
+
+// Runs t, then makes its ready successors runnable on this worker
+static inline void ws_execute(ws_worker_t *w, ws_task_t *t) {
+    w->tasks++;
+    t->fn(t->arg);
+
+    ws_task_lock(t);
+    t->done = 1;
+    ws_task_t **succ = t->succ;
+    int nsucc = t->nsucc;
+    t->succ = NULL;
+    t->nsucc = t->succ_cap = 0;
+    ws_task_unlock(t);
+    for (int i = 0; i < nsucc; ++i)
+        if (atomic_fetch_sub_explicit(&succ[i]->preds, 1, memory_order_acq_rel) == 1)
+            ws_deque_push(&w->dq, succ[i]);
+    free(succ);
+
+    atomic_fetch_sub_explicit(&t->frame->pending, 1, memory_order_release);
+    atomic_fetch_sub_explicit(&w->pool->live, 1, memory_order_release);
+    ws_release(t);
+}
+
+// Own deque first, then one pass over random victims
+static inline ws_task_t *ws_find(ws_worker_t *w) {
+    ws_task_t *t = ws_deque_take(&w->dq);
+    if (t)
+        return t;
+    int n = w->pool->nworkers;
+    for (int k = 1; k < n; ++k) {
+        ws_worker_t *v = &w->pool->workers[(w->id + k + (int)(rand_r(&w->seed) % (unsigned)n)) % n];
+        if (v == w)
+            continue;
+        if ((t = ws_deque_steal(&v->dq))) {
+            w->steals++;
+            return t;
+        }
+        w->steal_fails++;
+    }
+    return NULL;
+}
+
+// One scheduling step: runs a task if there is one, otherwise backs off and
+// accounts the time as idle
+static inline void ws_step(ws_worker_t *w, int *spins) {
+    ws_task_t *t = ws_find(w);
+    if (t) {
+        if (w->idle_since > 0) {
+            w->idle_s += ws_now() - w->idle_since;
+            w->idle_since = 0;
+        }
+        *spins = 0;
+        ws_execute(w, t);
+        return;
+    }
+    if (w->idle_since <= 0)
+        w->idle_since = ws_now();
+    ws_relax(spins);
+}
+
+static inline void ws_idle_end(ws_worker_t *w) {
+    if (w->idle_since > 0) {
+        w->idle_s += ws_now() - w->idle_since;
+        w->idle_since = 0;
+    }
+}
+
+// Runs other tasks until every task submitted into fr has finished
+static inline void ws_sync(ws_frame_t *fr) {
+    ws_worker_t *w = ws_self;
+    int spins = 0;
+    while (atomic_load_explicit(&fr->pending, memory_order_acquire) > 0)
+        ws_step(w, &spins);
+    ws_idle_end(w);
+}
+
+// ---------------- Pool ----------------
+static void *ws_worker_main(void *arg) {
+    ws_worker_t *w = arg;
+    ws_pool_t *pool = w->pool;
+    unsigned seen = 0;
+    ws_self = w;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == seen && !pool->shutdown)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        seen = pool->generation;
+        int stop = pool->shutdown;
+        pthread_mutex_unlock(&pool->lock);
+        if (stop)
+            return NULL;
+
+        atomic_fetch_add(&pool->active, 1);
+        int spins = 0;
+        while (atomic_load_explicit(&pool->running, memory_order_acquire))
+            ws_step(w, &spins);
+        ws_idle_end(w);
+        atomic_fetch_sub(&pool->active, 1);
+    }
+}
+
+// Returns NULL if the workers cannot be started
+static inline ws_pool_t *ws_pool_create(int nworkers) {
+    ws_pool_t *pool = calloc(1, sizeof(*pool));
+    if (nworkers < 1)
+        nworkers = 1;
+    if (!pool || !(pool->workers = aligned_alloc(64, sizeof(ws_worker_t) * (size_t)nworkers))) {
+        free(pool);
+        return NULL;
+    }
+    memset(pool->workers, 0, sizeof(ws_worker_t) * (size_t)nworkers);
+    pool->nworkers = nworkers;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    int started = 0, ok = 1;
+    for (int i = 0; i < nworkers && ok; ++i) {
+        ws_worker_t *w = &pool->workers[i];
+        w->pool = pool;
+        w->id = i;
+        w->seed = 0x9e3779b9u * (unsigned)(i + 1);
+        ok = ws_deque_init(&w->dq) == 0;
+        started = i + 1;
+        if (ok && i > 0)
+            ok = pthread_create(&w->thread, NULL, ws_worker_main, w) == 0;
+    }
+    if (!ok) {
+        pthread_mutex_lock(&pool->lock);
+        pool->shutdown = 1;
+        pthread_cond_broadcast(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+        for (int i = 1; i < started - 1; ++i)
+            pthread_join(pool->workers[i].thread, NULL);
+        for (int i = 0; i < started; ++i)
+            ws_deque_destroy(&pool->workers[i].dq);
+        free(pool->workers);
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+static inline void ws_pool_destroy(ws_pool_t *pool) {
+    if (!pool)
+        return;
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->nworkers; ++i)
+        pthread_join(pool->workers[i].thread, NULL);
+    for (int i = 0; i < pool->nworkers; ++i)
+        ws_deque_destroy(&pool->workers[i].dq);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    free(pool->workers);
+    free(pool);
+}
+
+typedef struct {
+    ws_fn_t fn;
+    void *arg;
+} ws_root_t;
+
+static void ws_root_main(void *p) {
+    ws_root_t *root = p;
+    root->fn(root->arg);
+}
+
+// Runs fn(arg) as the root task, with the calling thread as worker 0, and
+// returns once it and every task submitted since have finished
+static inline void ws_run(ws_pool_t *pool, ws_fn_t fn, void *arg) {
+    ws_worker_t *w = &pool->workers[0];
+    ws_worker_t *outer = ws_self;
+    ws_self = w;
+    double t0 = ws_now();
+
+    atomic_store(&pool->running, 1);
+    pthread_mutex_lock(&pool->lock);
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    // the root gets arg itself, not a copy of what it points to
+    ws_root_t root = { fn, arg };
+    ws_frame_t fr;
+    ws_frame_init(&fr);
+    ws_spawn(&fr, ws_root_main, &root, sizeof(root));
+    int spins = 0;
+    while (atomic_load_explicit(&pool->live, memory_order_acquire) > 0)
+        ws_step(w, &spins);
+    ws_idle_end(w);
+
+    atomic_store(&pool->running, 0);
+    while (atomic_load(&pool->active) > 0)
+        sched_yield();
+    pool->run_s += ws_now() - t0;
+    ws_self = outer;
+}
+
+static inline void ws_pool_stats(const ws_pool_t *pool, ws_stats_t *st) {
+    memset(st, 0, sizeof(*st));
+    st->workers = pool->nworkers;
+    st->run_s = pool->run_s;
+    for (int i = 0; i < pool->nworkers; ++i) {
+        const ws_worker_t *w = &pool->workers[i];
+        st->tasks += w->tasks;
+        st->steals += w->steals;
+        st->steal_fails += w->steal_fails;
+        st->idle_s += w->idle_s;
+    }
+}
+
+static inline void ws_pool_reset_stats(ws_pool_t *pool) {
+    pool->run_s = 0;
+    for (int i = 0; i < pool->nworkers; ++i) {
+        ws_worker_t *w = &pool->workers[i];
+        w->tasks = w->steals = w->steal_fails = 0;
+        w->idle_s = 0;
+    }
+}
+
+// Per-worker table and totals; idle percentages are of the time spent in ws_run()
+static inline void ws_pool_report(const ws_pool_t *pool, FILE *out) {
+    ws_stats_t st;
+    ws_pool_stats(pool, &st);
+    double run = st.run_s > 0 ? st.run_s : 1e-9;
+    fprintf(out, "ws runtime: %d workers, %.3f s in ws_run\n", st.workers, st.run_s);
+    fprintf(out, "  %-6s %12s %10s %12s %10s %6s\n", "worker", "tasks", "steals", "failed", "idle ms", "idle%");
+    for (int i = 0; i < pool->nworkers; ++i) {
+        const ws_worker_t *w = &pool->workers[i];
+        fprintf(out, "  %-6d %12lld %10lld %12lld %10.2f %5.1f%%\n", i, w->tasks, w->steals, w->steal_fails,
+                w->idle_s * 1e3, 100.0 * w->idle_s / run);
+    }
+    fprintf(out, "  %-6s %12lld %10lld %12lld %10.2f %5.1f%%   %.0f tasks/s\n", "total", st.tasks, st.steals,
+            st.steal_fails, st.idle_s * 1e3, 100.0 * st.idle_s / (run * st.workers), st.tasks / run);
+}
+
+#endif // WS_RUNTIME_H
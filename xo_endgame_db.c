@@ -0,0 +1,469 @@
+// xo_endgame_db.c
+// Builds a complete Tic-Tac-Toe endgame database on top of the canonical-key
+// search from parallel_canonical_XO.c: for every reachable canonical position it
+// stores the game-theoretic outcome and a best move, so a lookup at play time is
+// one read from an mmap'd table instead of a search.
+//
+// Build (parallel, OpenMP):
+//   1. reachable positions are enumerated with tasks from the empty board
+//   2. positions are solved level by level (9 pieces down to 0); every position in
+//      a level only depends on the level above, so each level is an omp parallel for
+//   3. the table is written and then checked against a live minimax search
+//
+// File format (little endian):
+//   header  "XODB" | u32 version | u32 entry count (3^9) | u32 reserved
+//   entries one byte per canonical key (base-3 board, cell 0 least significant):
+//           bits 0-1 outcome (0 = not a reachable canonical position, 1 = X wins,
+//                    2 = O wins, 3 = draw), bits 2-5 best move in canonical
+//                    orientation (15 = game over)
+//
+// Compile: gcc -O2 -fopenmp xo_endgame_db.c -o xo_endgame_db
+// Run:     ./xo_endgame_db build [xo_endgame.db]     (build + verify)
+//          ./xo_endgame_db verify [xo_endgame.db]
+//          ./xo_endgame_db query X.O...... [xo_endgame.db]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <omp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define EMPTY 0
+#define X 1
+#define O 2
+
+#define NUM_KEYS 19683            // 3^9
+#define OUT_NONE 0
+#define OUT_X 1
+#define OUT_O 2
+#define OUT_DRAW 3
+#define NO_MOVE 15
+
+#define DB_MAGIC "XODB"
+#define DB_VERSION 1
+#define DB_HEADER_SIZE 16
+#define DEFAULT_DB "xo_endgame.db"
+
+// --- Game Logic Constants ---
+static const int WIN[8][3] = {
+    {0,1,2},{3,4,5},{6,7,8},
+    {0,3,6},{1,4,7},{2,5,8},
+    {0,4,8},{2,4,6}
+};
+
+// Symmetry maps: canonical cell i holds original cell map[s][i]
+static const int SYM[8][9] = {
+    {0,1,2,3,4,5,6,7,8}, // Identity
+    {2,5,8,1,4,7,0,3,6}, // Rot90
+    {8,7,6,5,4,3,2,1,0}, // Rot180
+    {6,3,0,7,4,1,8,5,2}, // Rot270
+    {2,1,0,5,4,3,8,7,6}, // Mirror LR
+    {6,7,8,3,4,5,0,1,2}, // Mirror UD
+    {0,3,6,1,4,7,2,5,8}, // Mirror Main Diag
+    {8,5,2,7,4,1,6,3,0}  // Mirror Anti Diag
+};
+
+// --- Board Helper Functions ---
+
+int check_win(const int b[9]) {
+    for (int i = 0; i < 8; ++i) {
+        if (b[WIN[i][0]] != EMPTY &&
+            b[WIN[i][0]] == b[WIN[i][1]] &&
+            b[WIN[i][0]] == b[WIN[i][2]])
+            return b[WIN[i][0]];
+    }
+    return 0;
+}
+
+int is_full(const int b[9]) {
+    for (int i = 0; i < 9; ++i)
+        if (b[i] == EMPTY)
+            return 0;
+    return 1;
+}
+
+int board_to_int(const int b[9]) {
+    int k = 0, m = 1;
+    for (int i = 0; i < 9; ++i) {
+        k += b[i] * m;
+        m *= 3;
+    }
+    return k;
+}
+
+void int_to_board(int k, int b[9]) {
+    for (int i = 0; i < 9; ++i) {
+        b[i] = k % 3;
+        k /= 3;
+    }
+}
+
+// Minimum key over the 8 symmetries; *sym receives the symmetry that produced it
+int get_canonical_key(const int b[9], int *sym) {
+    int min_key = INT_MAX;
+    for (int s = 0; s < 8; ++s) {
+        int temp_k = 0, m = 1;
+        for (int i = 0; i < 9; ++i) {
+            temp_k += b[SYM[s][i]] * m;
+            m *= 3;
+        }
+        if (temp_k < min_key) {
+            min_key = temp_k;
+            if (sym) *sym = s;
+        }
+    }
+    return min_key;
+}
+
+int side_to_move(const int b[9]) {
+    int x = 0, o = 0;
+    for (int i = 0; i < 9; ++i) {
+        x += b[i] == X;
+        o += b[i] == O;
+    }
+    return x == o ? X : O;
+}
+
+int count_pieces(const int b[9]) {
+    int n = 0;
+    for (int i = 0; i < 9; ++i)
+        n += b[i] != EMPTY;
+    return n;
+}
+
+// --- Reachable Position Enumeration ---
+
+unsigned char reachable[NUM_KEYS];    // Raw (non-canonical) keys of every legal position
+
+void mark_reachable(int board[9], int player, int depth) {
+    int key = board_to_int(board);
+    unsigned char seen;
+    #pragma omp atomic read
+    seen = reachable[key];
+    if (seen)
+        return;              // a transposition already explored this subtree
+    #pragma omp atomic write
+    reachable[key] = 1;
+
+    if (check_win(board) || is_full(board))
+        return;
+
+    for (int i = 0; i < 9; ++i) {
+        if (board[i] != EMPTY)
+            continue;
+        int next_board[9];
+        memcpy(next_board, board, sizeof(next_board));
+        next_board[i] = player;
+        if (depth < 2) {
+            #pragma omp task firstprivate(next_board, player, depth) default(none)
+            mark_reachable(next_board, player == X ? O : X, depth + 1);
+        } else {
+            mark_reachable(next_board, player == X ? O : X, depth + 1);
+        }
+    }
+    #pragma omp taskwait
+}
+
+// --- Parallel Table Build ---
+
+// Ranks an outcome from the point of view of 'player' (higher is better)
+static int outcome_score(int outcome, int player) {
+    if (outcome == OUT_DRAW) return 1;
+    return (outcome == OUT_X) == (player == X) ? 2 : 0;
+}
+
+// Solves one canonical position from the already-solved level above it
+static unsigned char solve_entry(int key, const unsigned char *table) {
+    int b[9];
+    int_to_board(key, b);
+
+    int winner = check_win(b);
+    if (winner)
+        return (unsigned char)((winner == X ? OUT_X : OUT_O) | NO_MOVE << 2);
+    if (is_full(b))
+        return (unsigned char)(OUT_DRAW | NO_MOVE << 2);
+
+    int player = side_to_move(b);
+    int best_out = OUT_NONE, best_move = NO_MOVE, best_score = -1;
+    for (int i = 0; i < 9; ++i) {
+        if (b[i] != EMPTY)
+            continue;
+        b[i] = player;
+        int out = table[get_canonical_key(b, NULL)] & 0x3;
+        b[i] = EMPTY;
+
+        int sc = outcome_score(out, player);
+        if (sc > best_score) {
+            best_score = sc;
+            best_out = out;
+            best_move = i;
+        }
+    }
+    return (unsigned char)(best_out | best_move << 2);
+}
+
+void build_table(unsigned char *table) {
+    memset(reachable, 0, sizeof(reachable));
+    memset(table, 0, NUM_KEYS);
+
+    int root[9] = {0};
+    #pragma omp parallel shared(root) default(none)
+    {
+        #pragma omp single
+        mark_reachable(root, X, 0);
+    }
+
+    // Canonical representatives grouped by piece count
+    static int level_keys[10][NUM_KEYS];
+    int level_size[10] = {0};
+    for (int k = 0; k < NUM_KEYS; ++k) {
+        if (!reachable[k])
+            continue;
+        int b[9];
+        int_to_board(k, b);
+        if (get_canonical_key(b, NULL) == k) {
+            int lvl = count_pieces(b);
+            level_keys[lvl][level_size[lvl]++] = k;
+        }
+    }
+
+    // Deepest level first: each level only reads entries written by the previous one
+    for (int lvl = 9; lvl >= 0; --lvl) {
+        int n = level_size[lvl];
+        #pragma omp parallel for schedule(dynamic, 16) shared(table, level_keys, n, lvl) default(none)
+        for (int j = 0; j < n; ++j) {
+            int key = level_keys[lvl][j];
+            table[key] = solve_entry(key, table);
+        }
+    }
+}
+
+int write_table(const char *path, const unsigned char *table) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror("Failed to create database");
+        return -1;
+    }
+    uint32_t hdr[3] = { DB_VERSION, NUM_KEYS, 0 };
+    fwrite(DB_MAGIC, 1, 4, f);
+    fwrite(hdr, sizeof(uint32_t), 3, f);
+    fwrite(table, 1, NUM_KEYS, f);
+    if (fclose(f) != 0) {
+        perror("Failed to write database");
+        return -1;
+    }
+    return 0;
+}
+
+// --- mmap Lookup API ---
+
+typedef struct {
+    int fd;
+    size_t size;
+    const unsigned char *base;     // whole mapping
+    const unsigned char *entries;  // base + header
+} xo_db_t;
+
+// Maps the database read-only; returns 0 on success
+int xo_db_open(xo_db_t *db, const char *path) {
+    struct stat st;
+    db->fd = open(path, O_RDONLY);
+    if (db->fd < 0) {
+        perror("Failed to open database");
+        return -1;
+    }
+    if (fstat(db->fd, &st) != 0 || (size_t)st.st_size != DB_HEADER_SIZE + NUM_KEYS) {
+        fprintf(stderr, "Database %s has the wrong size\n", path);
+        close(db->fd);
+        return -1;
+    }
+    db->size = (size_t)st.st_size;
+    void *p = mmap(NULL, db->size, PROT_READ, MAP_SHARED, db->fd, 0);
+    if (p == MAP_FAILED) {
+        perror("Failed to map database");
+        close(db->fd);
+        return -1;
+    }
+    db->base = p;
+    db->entries = db->base + DB_HEADER_SIZE;
+
+    uint32_t version;
+    memcpy(&version, db->base + 4, sizeof(version));
+    if (memcmp(db->base, DB_MAGIC, 4) != 0 || version != DB_VERSION) {
+        fprintf(stderr, "Database %s has a bad header\n", path);
+        munmap(p, db->size);
+        close(db->fd);
+        return -1;
+    }
+    return 0;
+}
+
+void xo_db_close(xo_db_t *db) {
+    munmap((void *)db->base, db->size);
+    close(db->fd);
+}
+
+// Looks up any reachable board. Returns the outcome (OUT_*) and stores the best
+// move in the board's own orientation (-1 when the game is over).
+int xo_db_lookup(const xo_db_t *db, const int board[9], int *best_move) {
+    int sym = 0;
+    int key = get_canonical_key(board, &sym);
+    unsigned char e = db->entries[key];         // the single table read
+    int move = e >> 2 & 0xF;
+    if (best_move)
+        *best_move = move == NO_MOVE ? -1 : SYM[sym][move];
+    return e & 0x3;
+}
+
+// --- Verification Against the Live Search ---
+
+// Plain minimax over the full subtree, returns OUT_*
+int live_search(int b[9]) {
+    int winner = check_win(b);
+    if (winner)
+        return winner == X ? OUT_X : OUT_O;
+    if (is_full(b))
+        return OUT_DRAW;
+
+    int player = side_to_move(b);
+    int best_out = OUT_NONE, best_score = -1;
+    for (int i = 0; i < 9; ++i) {
+        if (b[i] != EMPTY)
+            continue;
+        b[i] = player;
+        int out = live_search(b);
+        b[i] = EMPTY;
+        int sc = outcome_score(out, player);
+        if (sc > best_score) {
+            best_score = sc;
+            best_out = out;
+            if (sc == 2)
+                break;
+        }
+    }
+    return best_out;
+}
+
+// Checks every reachable board (all orientations): stored outcome matches the
+// live search, and the stored move really achieves that outcome
+int verify_table(const xo_db_t *db) {
+    int mismatches = 0, checked = 0;
+
+    #pragma omp parallel for schedule(dynamic, 64) reduction(+:mismatches, checked) \
+        shared(db, reachable) default(none)
+    for (int k = 0; k < NUM_KEYS; ++k) {
+        if (!reachable[k])
+            continue;
+        int b[9], move;
+        int_to_board(k, b);
+        int out = xo_db_lookup(db, b, &move);
+        int live = live_search(b);
+        int ok = out == live;
+
+        if (ok && move >= 0) {
+            if (b[move] != EMPTY) {
+                ok = 0;
+            } else {
+                b[move] = side_to_move(b);
+                ok = live_search(b) == out;
+                b[move] = EMPTY;
+            }
+        } else if (ok && !check_win(b) && !is_full(b)) {
+            ok = 0;   // a live position must have a move
+        }
+
+        checked++;
+        if (!ok)
+            mismatches++;
+    }
+
+    printf("Verified %d reachable positions against live search: %d mismatches\n",
+           checked, mismatches);
+    return mismatches;
+}
+
+// Fills reachable[] without building (verify/query on an existing file)
+void enumerate_reachable(void) {
+    memset(reachable, 0, sizeof(reachable));
+    int root[9] = {0};
+    #pragma omp parallel shared(root) default(none)
+    {
+        #pragma omp single
+        mark_reachable(root, X, 0);
+    }
+}
+
+// --- Main Execution ---
+
+static const char *outcome_name(int out) {
+    switch (out) {
+        case OUT_X: return "X wins";
+        case OUT_O: return "O wins";
+        case OUT_DRAW: return "Draw";
+        default: return "not a reachable position";
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *mode = argc > 1 ? argv[1] : "build";
+
+    if (strcmp(mode, "build") == 0 || strcmp(mode, "verify") == 0) {
+        const char *path = argc > 2 ? argv[2] : DEFAULT_DB;
+
+        if (strcmp(mode, "build") == 0) {
+            static unsigned char table[NUM_KEYS];
+            double t0 = omp_get_wtime();
+            build_table(table);
+            int entries = 0;
+            for (int k = 0; k < NUM_KEYS; ++k)
+                entries += table[k] != 0;
+            printf("Built %d canonical positions in %.4fs (%d threads)\n",
+                   entries, omp_get_wtime() - t0, omp_get_max_threads());
+            if (write_table(path, table) != 0)
+                return 1;
+            printf("Wrote %s (%d bytes)\n", path, DB_HEADER_SIZE + NUM_KEYS);
+        } else {
+            enumerate_reachable();
+        }
+
+        xo_db_t db;
+        if (xo_db_open(&db, path) != 0)
+            return 1;
+        int bad = verify_table(&db);
+        int move;
+        int root[9] = {0};
+        int out = xo_db_lookup(&db, root, &move);
+        printf("Empty board: %s, best move %d\n", outcome_name(out), move);
+        xo_db_close(&db);
+        return bad ? 1 : 0;
+    }
+
+    if (strcmp(mode, "query") == 0 && argc > 2 && strlen(argv[2]) == 9) {
+        const char *path = argc > 3 ? argv[3] : DEFAULT_DB;
+        int b[9];
+        for (int i = 0; i < 9; ++i)
+            b[i] = argv[2][i] == 'X' ? X : argv[2][i] == 'O' ? O : EMPTY;
+
+        xo_db_t db;
+        if (xo_db_open(&db, path) != 0)
+            return 1;
+        int move;
+        int out = xo_db_lookup(&db, b, &move);
+        printf("%s: %s", argv[2], outcome_name(out));
+        if (out != OUT_NONE && move >= 0)
+            printf(", %c to move, best move %d (row %d, col %d)",
+                   side_to_move(b) == X ? 'X' : 'O', move, move / 3, move % 3);
+        printf("\n");
+        xo_db_close(&db);
+        return 0;
+    }
+
+    fprintf(stderr, "Usage: %s build|verify [db]  |  %s query <9 cells of X/O/.> [db]\n",
+            argv[0], argv[0]);
+    return 1;
+}